@@ -0,0 +1,695 @@
+/** @file
+ * dali-bench - an HTTP/1.1 load generator.
+ *
+ * Usage: dali-bench [-a ADDRESS] [-p PORT] [-c CONNECTIONS] [-d SECONDS]
+ * [-r RATE] [-P DEPTH] [-C] [-u URL_FILE] [-o RESULTS [-n NAME]] [PATH...]
+ *
+ * \li -a ADDRESS : the IPv4 address of the server (default: 127.0.0.1)
+ * \li -p PORT : the port of the server (default: 8088)
+ * \li -c CONNECTIONS : the number of connections (default: 8)
+ * \li -d SECONDS : the duration (default: 5)
+ * \li -r RATE : sends RATE requests per second in total at fixed intervals,
+ * whether or not the responses arrive in time. 0, the default, sends the next
+ * request as soon as a response arrives.
+ * \li -P DEPTH : pipelines up to DEPTH requests on a connection (default: 1)
+ * \li -C : closes the connection after each request, instead of keep-alive.
+ * \li -u URL_FILE : reads paths with their weights, "[WEIGHT] PATH" per line.
+ * \li -o RESULTS : appends the metrics NAME.throughput, NAME.latency_p50,
+ * NAME.latency_p99 and NAME.latency_p999 to RESULTS, sampled every second,
+ * for dali-benchcmp.
+ * \li -n NAME : the prefix of the metrics (default: bench)
+ *
+ * Paths are chosen at random in proportion to their weights, with a fixed
+ * seed, so that runs are reproducible. The default path is "/".
+ *
+ * With -r, the latency of a request is measured from the time it is
+ * scheduled, not from the time it is sent, so that a stalled server is not
+ * hidden by the requests which are not sent meanwhile (coordinated
+ * omission). The latency from the time it is sent is reported as well.
+ */
+#include "histogram.h"
+#include "main.h"
+#include "stats.h"
+#include "util.h"
+
+#include <arpa/inet.h>   // inet_pton(3)
+#include <ctype.h>       // isdigit(3)
+#include <errno.h>       // errno
+#include <fcntl.h>       // fcntl(2)
+#include <netinet/in.h>  // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <poll.h>        // poll(2)
+#include <signal.h>      // signal(2)
+#include <stdio.h>       // printf(3)
+#include <stdlib.h>      // strtol(3)
+#include <string.h>      // strcmp(3)
+#include <strings.h>     // strncasecmp(3)
+#include <sys/socket.h>  // socket(2)
+#include <unistd.h>      // read(2)
+
+// clang-format off
+#define BENCH_MAX_DEPTH   64          ///< the maximum of -P
+#define BENCH_REQUEST_MAX 2048        ///< bytes of a request
+#define BENCH_HEADER_MAX  (16 * 1024) ///< bytes of headers of a response
+// clang-format on
+
+typedef struct {
+    char *prog_name;
+    char *address;
+    int port;
+    int connections;
+    int duration;
+    double rate;
+    int depth;
+    bool close;
+    char *output;
+    char *name;
+    Vector *paths;   // char *
+    Vector *weights; // int *, cumulative
+} BenchOption;
+
+/// state of parsing a response
+typedef enum {
+    RS_HEADERS,
+    RS_BODY,        ///< Content-Length bytes
+    RS_BODY_EOF,    ///< until the connection is closed
+    RS_CHUNK_SIZE,  ///< the line of a chunk size
+    RS_CHUNK_DATA,  ///< the data of a chunk, and CRLF
+    RS_CHUNK_TRAIL, ///< the trailer section
+} ResponseState;
+
+typedef struct {
+    int fd;
+    uint64_t next_at; // the time to schedule the next request, with -r
+
+    // requests in flight, oldest first
+    uint64_t scheduled_at[BENCH_MAX_DEPTH];
+    uint64_t sent_at[BENCH_MAX_DEPTH];
+    int head;
+    int nflight;
+
+    char out[BENCH_MAX_DEPTH * BENCH_REQUEST_MAX];
+    size_t out_len;
+    size_t out_off;
+
+    char in[BENCH_HEADER_MAX];
+    size_t in_len;
+
+    ResponseState state;
+    int64_t remaining; // bytes left of the body or the chunk
+    int status;
+    bool close; // the server closes the connection after the response
+} Connection;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t connect_errors;
+    uint64_t read_errors;
+    uint64_t status_errors; // not 2xx or 3xx
+    Histogram latency;      // ns from the scheduled time
+    Histogram service_time; // ns from the time sent
+
+    // sampled every second, for -o
+    uint64_t interval_requests;
+    Histogram interval_latency;
+    Metric throughput;
+    Metric p50, p99, p999;
+} BenchResult;
+
+static BenchOption *Opt;
+static BenchResult *Result;
+static struct sockaddr_in Addr;
+static uint64_t Random = 0x9e3779b97f4a7c15; // xorshift64, fixed seed
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr,
+            "%s [-a ADDRESS] [-p PORT] [-c CONNECTIONS] [-d SECONDS] "
+            "[-r RATE] [-P DEPTH] [-C] [-u URL_FILE] [-o RESULTS [-n NAME]] "
+            "[PATH...]\n",
+            prog_name);
+}
+
+static void add_path(BenchOption *opts, const char *path, int weight) {
+    int total = opts->weights->len > 0 ? *(int *)Vector_last(opts->weights)
+                                       : 0;
+    Vector_push(opts->paths, strdup(path));
+    Vector_push(opts->weights, intdup(total + weight));
+}
+
+/// reads "[WEIGHT] PATH" per line, skipping blank lines and comments
+static void read_url_file(BenchOption *opts, const char *file, Exception *ex) {
+    FILE *in = fopen(file, "r");
+    if (in == NULL) {
+        ex->ty = E_Failure;
+        ex->msg = "fopen";
+        return;
+    }
+
+    char line[BENCH_REQUEST_MAX];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *p = line + strspn(line, " \t");
+        p[strcspn(p, "\r\n")] = '\0';
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        int weight = 1;
+        if (isdigit((unsigned char)*p)) {
+            weight = strtol(p, &p, 10);
+            p += strspn(p, " \t");
+        }
+        if (*p != '/' || weight <= 0) {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "bad line in URL file";
+            break;
+        }
+        add_path(opts, p, weight);
+    }
+    fclose(in);
+}
+
+/// returns the argument of the option as a positive integer, or 0
+static int int_arg(ArgsIter *iter, Exception *ex, char *msg) {
+    if (!ArgsIter_hasNext(iter)) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = msg;
+        return 0;
+    }
+    return atoi(ArgsIter_next(iter));
+}
+
+static BenchOption *BenchOption_parse(int argc, char **argv, Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    BenchOption *opts = calloc(1, sizeof(BenchOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->address = "127.0.0.1";
+    opts->port = DEFAULT_PORT;
+    opts->connections = 8;
+    opts->duration = 5;
+    opts->depth = 1;
+    opts->name = "bench";
+    opts->paths = new_Vector();
+    opts->weights = new_Vector();
+
+    while (ArgsIter_hasNext(iter) && ex->ty == E_Okay) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-a") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'a'";
+                break;
+            }
+            opts->address = ArgsIter_next(iter);
+            continue;
+        }
+        if (strcmp(arg, "-p") == 0) {
+            opts->port =
+                int_arg(iter, ex, "option require an argument -- 'p'");
+            continue;
+        }
+        if (strcmp(arg, "-c") == 0) {
+            opts->connections =
+                int_arg(iter, ex, "option require an argument -- 'c'");
+            continue;
+        }
+        if (strcmp(arg, "-d") == 0) {
+            opts->duration =
+                int_arg(iter, ex, "option require an argument -- 'd'");
+            continue;
+        }
+        if (strcmp(arg, "-r") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'r'";
+                break;
+            }
+            opts->rate = atof(ArgsIter_next(iter));
+            continue;
+        }
+        if (strcmp(arg, "-P") == 0) {
+            opts->depth =
+                int_arg(iter, ex, "option require an argument -- 'P'");
+            continue;
+        }
+        if (strcmp(arg, "-C") == 0) {
+            opts->close = true;
+            continue;
+        }
+        if (strcmp(arg, "-u") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'u'";
+                break;
+            }
+            read_url_file(opts, ArgsIter_next(iter), ex);
+            continue;
+        }
+        if (strcmp(arg, "-o") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'o'";
+                break;
+            }
+            opts->output = ArgsIter_next(iter);
+            continue;
+        }
+        if (strcmp(arg, "-n") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'n'";
+                break;
+            }
+            opts->name = ArgsIter_next(iter);
+            continue;
+        }
+        if (arg[0] == '-') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+            break;
+        }
+        if (arg[0] != '/') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "a path must start with '/'";
+            break;
+        }
+        add_path(opts, arg, 1);
+    }
+    delete_ArgsIter(iter);
+
+    if (ex->ty != E_Okay)
+        return opts;
+    if (opts->connections <= 0 || opts->duration <= 0 || opts->rate < 0 ||
+        opts->depth <= 0 || opts->depth > BENCH_MAX_DEPTH) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "an argument is out of range";
+        return opts;
+    }
+    for (int i = 0; i < opts->paths->len; i++) {
+        if (strlen(opts->paths->data[i]) > BENCH_REQUEST_MAX / 2) {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "a path is too long";
+            return opts;
+        }
+    }
+    if (opts->close)
+        opts->depth = 1; // a request per connection
+    if (opts->paths->len == 0)
+        add_path(opts, "/", 1);
+
+    return opts;
+}
+
+/// chooses a path in proportion to the weights
+static char *choose_path() {
+    Random ^= Random << 13;
+    Random ^= Random >> 7;
+    Random ^= Random << 17;
+
+    int total = *(int *)Vector_last(Opt->weights);
+    int r = Random % total;
+    for (int i = 0; i < Opt->weights->len; i++)
+        if (r < *(int *)Opt->weights->data[i])
+            return Opt->paths->data[i];
+    return Vector_last(Opt->paths);
+}
+
+static void conn_open(Connection *c) {
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c->fd == -1 ||
+        connect(c->fd, (struct sockaddr *)&Addr, sizeof(Addr)) == -1) {
+        Result->connect_errors++;
+        if (c->fd != -1)
+            close(c->fd);
+        c->fd = -1;
+        return;
+    }
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+}
+
+/// closes the connection, and drops the requests in flight
+static void conn_reset(Connection *c, bool error) {
+    if (error)
+        Result->read_errors += c->nflight;
+    if (c->fd != -1)
+        close(c->fd);
+    c->fd = -1;
+    c->head = c->nflight = 0;
+    c->out_len = c->out_off = c->in_len = 0;
+    c->state = RS_HEADERS;
+}
+
+/// queues a request scheduled at the time
+static void conn_send(Connection *c, uint64_t scheduled_at, uint64_t now) {
+    int i = (c->head + c->nflight) % BENCH_MAX_DEPTH;
+    c->scheduled_at[i] = scheduled_at;
+    c->sent_at[i] = now;
+    c->nflight++;
+
+    // keeps only the bytes not written, of the requests in flight
+    memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+    c->out_len -= c->out_off;
+    c->out_off = 0;
+
+    c->out_len += snprintf(c->out + c->out_len, BENCH_REQUEST_MAX,
+                           "GET %s HTTP/1.1\r\n"
+                           "Host: %s:%d\r\n"
+                           "User-Agent: dali-bench\r\n"
+                           "%s"
+                           "\r\n",
+                           choose_path(), Opt->address, Opt->port,
+                           Opt->close ? "Connection: close\r\n" : "");
+}
+
+/// counts the response of the oldest request
+static void conn_complete(Connection *c, uint64_t now) {
+    Result->requests++;
+    if (c->status < 200 || c->status >= 400)
+        Result->status_errors++;
+    Histogram_record(&Result->latency, now - c->scheduled_at[c->head]);
+    Histogram_record(&Result->interval_latency,
+                     now - c->scheduled_at[c->head]);
+    Result->interval_requests++;
+    Histogram_record(&Result->service_time, now - c->sent_at[c->head]);
+    c->head = (c->head + 1) % BENCH_MAX_DEPTH;
+    c->nflight--;
+    c->state = RS_HEADERS;
+
+    if (c->close || Opt->close)
+        conn_reset(c, c->nflight > 0);
+}
+
+/// parses the status line and the headers from start to end
+static void parse_headers(Connection *c, char *start, char *end) {
+    c->status = 0;
+    c->close = false;
+    c->state = RS_BODY_EOF;
+    sscanf(start, "HTTP/%*d.%*d %d", &c->status);
+
+    for (char *p = strstr(start, "\r\n"); p != NULL && p < end;
+         p = strstr(p + 2, "\r\n")) {
+        char *h = p + 2;
+        if (strncasecmp(h, "Content-Length:", 15) == 0) {
+            c->state = RS_BODY;
+            c->remaining = strtoll(h + 15, NULL, 10);
+        } else if (strncasecmp(h, "Transfer-Encoding:", 18) == 0 &&
+                   strstr(h, "chunked") != NULL) {
+            c->state = RS_CHUNK_SIZE;
+        } else if (strncasecmp(h, "Connection:", 11) == 0 &&
+                   strncasecmp(h + 11 + strspn(h + 11, " "), "close", 5) ==
+                       0) {
+            c->close = true;
+        }
+    }
+}
+
+/**
+ * Consumes the bytes read, and completes responses.
+ *
+ * @return false if a response is malformed
+ */
+static bool conn_parse(Connection *c, uint64_t now) {
+    size_t off = 0;
+
+    while (off < c->in_len || (c->state == RS_BODY && c->remaining == 0)) {
+        char *p = c->in + off;
+        size_t len = c->in_len - off;
+        char *eol;
+
+        switch (c->state) {
+        case RS_HEADERS:
+            eol = strstr(p, "\r\n\r\n");
+            if (eol == NULL)
+                goto incomplete;
+            if (c->nflight == 0)
+                return false; // not requested
+            parse_headers(c, p, eol);
+            off = eol + 4 - c->in;
+            continue;
+        case RS_BODY:
+            if ((int64_t)len >= c->remaining) {
+                off += c->remaining;
+                conn_complete(c, now);
+                if (c->fd == -1)
+                    return true;
+                continue;
+            }
+            c->remaining -= len;
+            off += len;
+            continue;
+        case RS_BODY_EOF:
+            off += len; // completed when closed
+            continue;
+        case RS_CHUNK_SIZE:
+            eol = strstr(p, "\r\n");
+            if (eol == NULL)
+                goto incomplete;
+            c->remaining = strtoll(p, NULL, 16) + 2; // with CRLF
+            c->state = c->remaining == 2 ? RS_CHUNK_TRAIL : RS_CHUNK_DATA;
+            off = eol + 2 - c->in;
+            continue;
+        case RS_CHUNK_DATA:
+            if ((int64_t)len >= c->remaining) {
+                off += c->remaining;
+                c->state = RS_CHUNK_SIZE;
+                continue;
+            }
+            c->remaining -= len;
+            off += len;
+            continue;
+        case RS_CHUNK_TRAIL:
+            eol = strstr(p, "\r\n");
+            if (eol == NULL)
+                goto incomplete;
+            off = eol + 2 - c->in;
+            if (eol == p) { // the empty line
+                conn_complete(c, now);
+                if (c->fd == -1)
+                    return true;
+            }
+            continue;
+        }
+    }
+
+incomplete:
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+    // headers must fit in the buffer, with the terminating NUL
+    return c->in_len < sizeof(c->in) - 1;
+}
+
+static void conn_read(Connection *c, uint64_t now) {
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - 1 - c->in_len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0) {
+        if (c->state == RS_BODY_EOF && c->nflight > 0) {
+            conn_complete(c, now);
+            conn_reset(c, c->nflight > 0);
+            return;
+        }
+        conn_reset(c, c->nflight > 0);
+        return;
+    }
+
+    Result->bytes += n;
+    c->in_len += n;
+    c->in[c->in_len] = '\0'; // for strstr(3) on headers and chunk sizes
+    if (!conn_parse(c, now))
+        conn_reset(c, true);
+}
+
+static void conn_write(Connection *c) {
+    ssize_t n = write(c->fd, c->out + c->out_off, c->out_len - c->out_off);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n < 0) {
+        conn_reset(c, true);
+        return;
+    }
+    c->out_off += n;
+}
+
+/**
+ * Schedules requests until the pipeline is full, or until the next one is
+ * due with -r.
+ *
+ * @return the time of the next request scheduled, with -r
+ */
+static uint64_t conn_fill(Connection *c, uint64_t now) {
+    uint64_t interval = Opt->rate > 0 ? Opt->connections * 1e9 / Opt->rate : 0;
+
+    while (c->nflight < Opt->depth) {
+        if (interval > 0 && c->next_at > now)
+            break;
+        if (c->fd == -1) {
+            conn_open(c);
+            if (c->fd == -1)
+                break;
+        }
+        conn_send(c, interval > 0 ? c->next_at : now, now);
+        c->next_at += interval;
+    }
+    return c->next_at;
+}
+
+/// samples the metrics of the last second
+static void sample_interval() {
+    BenchResult *r = Result;
+    if (r->throughput.n == METRIC_SAMPLES_MAX)
+        return;
+
+    r->throughput.samples[r->throughput.n++] = r->interval_requests;
+    r->p50.samples[r->p50.n++] =
+        Histogram_percentile(&r->interval_latency, 50) / 1e6;
+    r->p99.samples[r->p99.n++] =
+        Histogram_percentile(&r->interval_latency, 99) / 1e6;
+    r->p999.samples[r->p999.n++] =
+        Histogram_percentile(&r->interval_latency, 99.9) / 1e6;
+
+    r->interval_requests = 0;
+    memset(&r->interval_latency, 0, sizeof(Histogram));
+}
+
+static void run(Connection *conns, int n) {
+    uint64_t start = monotonic_ns();
+    uint64_t end = start + Opt->duration * 1000000000ull;
+    uint64_t interval_end = start + 1000000000;
+    struct pollfd *pfds = calloc(n, sizeof(struct pollfd));
+
+    for (int i = 0; i < n; i++) {
+        conns[i].fd = -1;
+        // spread the schedules of connections over an interval
+        conns[i].next_at =
+            Opt->rate > 0 ? start + (uint64_t)(i * 1e9 / Opt->rate) : start;
+    }
+
+    for (uint64_t now = start; now < end; now = monotonic_ns()) {
+        if (now >= interval_end) {
+            sample_interval();
+            interval_end += 1000000000;
+        }
+
+        uint64_t next = interval_end < end ? interval_end : end;
+        for (int i = 0; i < n; i++) {
+            uint64_t t = conn_fill(&conns[i], now);
+            // a full pipeline waits for a response, however late its
+            // schedule is, not to spin on poll(2) without timeout
+            if (Opt->rate > 0 && conns[i].nflight < Opt->depth && t < next)
+                next = t;
+
+            pfds[i].fd = conns[i].fd;
+            pfds[i].events = POLLIN;
+            if (conns[i].out_off < conns[i].out_len)
+                pfds[i].events |= POLLOUT;
+        }
+
+        int timeout = next > now ? (next - now + 999999) / 1000000 : 0;
+        if (poll(pfds, n, timeout) <= 0)
+            continue;
+
+        now = monotonic_ns();
+        for (int i = 0; i < n; i++) {
+            if (pfds[i].revents & POLLOUT)
+                conn_write(&conns[i]);
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR) &&
+                conns[i].fd != -1)
+                conn_read(&conns[i], now);
+        }
+    }
+
+    sample_interval(); // the last second
+
+    for (int i = 0; i < n; i++)
+        if (conns[i].fd != -1)
+            close(conns[i].fd);
+    free(pfds);
+}
+
+/// appends the metrics to Opt->output
+static void write_metrics() {
+    FILE *out = fopen(Opt->output, "a");
+    if (out == NULL)
+        error("Error: fopen: %s: %s", Opt->output, strerror(errno));
+
+    struct {
+        Metric *m;
+        const char *name;
+        const char *unit;
+    } metrics[] = {
+        {&Result->throughput, "throughput", "requests/s"},
+        {&Result->p50, "latency_p50", "ms"},
+        {&Result->p99, "latency_p99", "ms"},
+        {&Result->p999, "latency_p999", "ms"},
+    };
+    for (int i = 0; i < 4; i++) {
+        Metric *m = metrics[i].m;
+        snprintf(m->name, sizeof(m->name), "%s.%s", Opt->name,
+                 metrics[i].name);
+        snprintf(m->unit, sizeof(m->unit), "%s", metrics[i].unit);
+        m->higher_is_better = m == &Result->throughput;
+        Metric_write(m, out);
+    }
+    fclose(out);
+}
+
+static void print_latency(const char *name, Histogram *h) {
+    printf("%-14s p50 %.3f, p90 %.3f, p99 %.3f, p99.9 %.3f, max %.3f ms\n",
+           name, Histogram_percentile(h, 50) / 1e6,
+           Histogram_percentile(h, 90) / 1e6, Histogram_percentile(h, 99) / 1e6,
+           Histogram_percentile(h, 99.9) / 1e6, h->max / 1e6);
+}
+
+static void print_result() {
+    double sec = Opt->duration;
+
+    printf("%d connections, %d s, ", Opt->connections, Opt->duration);
+    if (Opt->rate > 0)
+        printf("%g requests/s scheduled, ", Opt->rate);
+    printf("pipeline depth %d, %s\n", Opt->depth,
+           Opt->close ? "close" : "keep-alive");
+    printf("requests:      %ju, %.1f requests/s, %.2f MB/s\n",
+           (uintmax_t)Result->requests, Result->requests / sec,
+           Result->bytes / sec / 1e6);
+    printf("errors:        connect %ju, read %ju, status %ju\n",
+           (uintmax_t)Result->connect_errors, (uintmax_t)Result->read_errors,
+           (uintmax_t)Result->status_errors);
+    print_latency("latency:", &Result->latency);
+    if (Opt->rate > 0)
+        print_latency("service time:", &Result->service_time);
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    Opt = BenchOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(Opt->prog_name);
+        return EXIT_FAILURE;
+    }
+
+    Addr.sin_family = AF_INET;
+    Addr.sin_port = htons(Opt->port);
+    if (inet_pton(AF_INET, Opt->address, &Addr.sin_addr) != 1)
+        error("Error: bad address: %s", Opt->address);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    Result = calloc(1, sizeof(BenchResult));
+    Connection *conns = calloc(Opt->connections, sizeof(Connection));
+    run(conns, Opt->connections);
+    print_result();
+    if (Opt->output != NULL)
+        write_metrics();
+
+    int status = Result->requests > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    free(conns);
+    free(Result);
+    free(ex);
+    return status;
+}
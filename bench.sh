@@ -0,0 +1,78 @@
+#!/bin/bash
+#
+# Starts the server on a generated document root, and loads it with
+# dali-bench: closed loop, pipelined, and open loop at a fixed rate.
+#
+# BENCH_PORT, BENCH_CONNECTIONS, BENCH_DURATION and BENCH_RATE override the
+# defaults. BENCH_OUTPUT writes the results of passes into the file, which is
+# compared with BENCH_BASELINE if it is given.
+
+set -o nounset
+
+prog=./httpd
+bench=./dali-bench
+PORT=${BENCH_PORT:-8090}
+CONNECTIONS=${BENCH_CONNECTIONS:-8}
+DURATION=${BENCH_DURATION:-5}
+RATE=${BENCH_RATE:-2000}
+OUTPUT=${BENCH_OUTPUT:-}
+BASELINE=${BENCH_BASELINE:-}
+
+function error() {
+    echo "$@" >&2
+    exit 1
+}
+
+root=$(mktemp -d) || error "$LINENO"
+trap 'kill $server 2>/dev/null; wait $server 2>/dev/null; rm -rf "$root"' EXIT
+
+# document root: files of typical sizes, with fixed contents
+mkdir "$root/www"
+head -c 1024 /dev/zero | tr '\0' 'a' > "$root/www/index.html"
+head -c 8192 /dev/zero | tr '\0' 'b' > "$root/www/style.css"
+head -c 65536 /dev/zero > "$root/www/image.png"
+head -c 1048576 /dev/zero > "$root/www/large.bin"
+
+cat > "$root/urls" <<URLS
+# weight path
+60 /index.html
+25 /style.css
+10 /image.png
+4 /not_found
+1 /large.bin
+URLS
+
+$prog -r "$root/www" -l "$root/access.log" -p $PORT > /dev/null 2>&1 &
+server=$!
+
+# waits for the server to listen, and fails if it exits or never listens
+listening=false
+for i in $(seq 50); do
+    kill -0 $server 2>/dev/null || error "$LINENO: $prog exited"
+    if (echo -n > /dev/tcp/127.0.0.1/$PORT) 2>/dev/null; then
+        listening=true
+        break
+    fi
+    sleep 0.1
+done
+$listening || error "$LINENO: $prog does not listen on $PORT"
+
+opts="-p $PORT -c $CONNECTIONS -d $DURATION -u $root/urls"
+if [[ -n $OUTPUT ]]; then
+    : > "$OUTPUT"
+    opts="$opts -o $OUTPUT"
+fi
+
+echo "== closed loop, keep-alive"
+$bench $opts -n closed || error "$LINENO"
+echo
+echo "== closed loop, pipelined"
+$bench $opts -n pipelined -P 8 || error "$LINENO"
+echo
+echo "== open loop, $RATE requests/s"
+$bench $opts -n open -r $RATE || error "$LINENO"
+
+if [[ -n $OUTPUT && -n $BASELINE ]]; then
+    echo
+    ./dali-benchcmp "$BASELINE" "$OUTPUT"
+fi
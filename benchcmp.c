@@ -0,0 +1,209 @@
+/** @file
+ * dali-benchcmp - compares results of benchmarks with a baseline.
+ *
+ * Usage: dali-benchcmp [-x] [-a ALPHA] [-t PERCENT] [-e EPSILON] BASELINE
+ *        RESULTS
+ *
+ * \li -x : regard exact metrics only. times are compared and reported, but
+ * never regress, as they depend on the machine.
+ * \li -a ALPHA : the significance level of Welch's t-test (default: 0.01)
+ * \li -t PERCENT : the least change of the mean to regard (default: 5)
+ * \li -e EPSILON : the least change of an exact metric to regard
+ * (default: 0.1)
+ *
+ * A metric of RESULTS regresses if its mean is worse than the one of
+ * BASELINE by more than PERCENT, and the difference is significant at ALPHA.
+ * A metric of a single sample is exact, e.g. allocations per operation, and
+ * regresses if worse by more than EPSILON. Metrics not in BASELINE are
+ * reported as new.
+ *
+ * Exits with 1 if any metric regresses, 2 on error.
+ */
+#include "stats.h"
+#include "util.h"
+
+#include <errno.h>  // errno
+#include <math.h>   // fabs(3)
+#include <stdio.h>  // printf(3)
+#include <stdlib.h> // atof(3)
+#include <string.h> // strcmp(3)
+
+typedef struct {
+    char *prog_name;
+    double alpha;
+    double threshold; // ratio
+    double epsilon;
+    bool exact_only; // times never regress
+    char *baseline;
+    char *results;
+} BenchcmpOption;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr,
+            "%s [-x] [-a ALPHA] [-t PERCENT] [-e EPSILON] BASELINE "
+            "RESULTS\n",
+            prog_name);
+}
+
+static BenchcmpOption *BenchcmpOption_parse(int argc, char **argv,
+                                            Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    BenchcmpOption *opts = calloc(1, sizeof(BenchcmpOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->alpha = 0.01;
+    opts->threshold = 0.05;
+    opts->epsilon = 0.1;
+
+    while (ArgsIter_hasNext(iter)) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-x") == 0) {
+            opts->exact_only = true;
+            continue;
+        }
+        if (strcmp(arg, "-a") == 0 || strcmp(arg, "-t") == 0 ||
+            strcmp(arg, "-e") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument";
+                break;
+            }
+            double v = atof(ArgsIter_next(iter));
+            if (arg[1] == 'a')
+                opts->alpha = v;
+            else if (arg[1] == 't')
+                opts->threshold = v / 100;
+            else
+                opts->epsilon = v;
+            continue;
+        }
+        if (arg[0] == '-') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+            break;
+        }
+        if (opts->baseline == NULL)
+            opts->baseline = arg;
+        else if (opts->results == NULL)
+            opts->results = arg;
+        else {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "too many arguments";
+            break;
+        }
+    }
+    delete_ArgsIter(iter);
+
+    if (ex->ty == E_Okay && opts->results == NULL) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "BASELINE and RESULTS are required";
+    }
+    return opts;
+}
+
+/// reads the metrics of the file into a Vector of Metric
+static Vector *read_metrics(const char *path) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    Vector *metrics = new_Vector();
+
+    FILE *in = fopen(path, "r");
+    if (in == NULL)
+        error("Error: fopen: %s: %s", path, strerror(errno));
+
+    Metric *m = malloc(sizeof(Metric));
+    while (Metric_read(m, in, ex)) {
+        Vector_push(metrics, m);
+        m = malloc(sizeof(Metric));
+    }
+    free(m);
+    if (ex->ty != E_Okay)
+        error("Error: %s: %s", path, ex->msg);
+
+    fclose(in);
+    free(ex);
+    return metrics;
+}
+
+static Metric *find(Vector *metrics, const char *name) {
+    for (int i = 0; i < metrics->len; i++) {
+        Metric *m = metrics->data[i];
+        if (strcmp(m->name, name) == 0)
+            return m;
+    }
+    return NULL;
+}
+
+/**
+ * Compares the metric with the one of the baseline, and prints a line.
+ *
+ * @return true if it regresses
+ */
+static bool compare(BenchcmpOption *opt, Metric *base, Metric *cur) {
+    double mb = stats_mean(base->samples, base->n);
+    double mc = stats_mean(cur->samples, cur->n);
+    double change = mb != 0 ? (mc - mb) / fabs(mb) : 0;
+    bool worse = cur->higher_is_better ? mc < mb : mc > mb;
+    bool regress;
+
+    printf("%-32s %12.3f %12.3f %+8.1f%% ", cur->name, mb, mc, change * 100);
+    if (base->n < 2 || cur->n < 2) {
+        regress = worse && fabs(mc - mb) > opt->epsilon;
+        printf("%8s", "exact");
+    } else {
+        WelchTest w = stats_welch(base->samples, base->n, cur->samples,
+                                  cur->n);
+        regress = worse && fabs(change) > opt->threshold && w.p < opt->alpha;
+        printf("%8.4f", w.p);
+        if (regress && opt->exact_only) {
+            printf(" %s  slower (advisory)\n", cur->unit);
+            return false;
+        }
+    }
+    printf(" %s%s\n", cur->unit, regress ? "  REGRESSION" : "");
+    return regress;
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    BenchcmpOption *opt = BenchcmpOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(opt->prog_name);
+        return 2;
+    }
+
+    Vector *baseline = read_metrics(opt->baseline);
+    Vector *results = read_metrics(opt->results);
+    int regressions = 0;
+
+    printf("%-32s %12s %12s %9s %8s\n", "name", "baseline", "current",
+           "change", "p");
+    for (int i = 0; i < results->len; i++) {
+        Metric *cur = results->data[i];
+        Metric *base = find(baseline, cur->name);
+        if (base == NULL) {
+            printf("%-32s %12s %12.3f %9s %8s %s\n", cur->name, "-",
+                   stats_mean(cur->samples, cur->n), "new", "-", cur->unit);
+            continue;
+        }
+        if (compare(opt, base, cur))
+            regressions++;
+    }
+    for (int i = 0; i < baseline->len; i++) {
+        Metric *base = baseline->data[i];
+        if (find(results, base->name) == NULL)
+            printf("%-32s %12.3f %12s %9s\n", base->name,
+                   stats_mean(base->samples, base->n), "-", "missing");
+    }
+
+    if (regressions > 0)
+        printf("%d regression(s) against %s\n", regressions, opt->baseline);
+
+    delete_Vector(baseline);
+    delete_Vector(results);
+    free(ex);
+    return regressions > 0 ? 1 : 0;
+}
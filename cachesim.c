@@ -0,0 +1,821 @@
+/** @file
+ * dali-cachesim - simulates caches of files over access logs.
+ *
+ * Usage: dali-cachesim [-s SIZES] [-w WORKERS] [FILE...]
+ *        dali-cachesim -test
+ *
+ * \li -s SIZES : the capacities of a cache in bytes, separated by commas,
+ * with the suffixes K, M and G, e.g. 64K,1M,8M (default: powers of two from
+ * 64K up to the total size of the files)
+ * \li -w WORKERS : deals the requests in turn to the caches of WORKERS
+ * workers, each of a capacity (default: 1), as each worker of the server has
+ * a cache of its own.
+ * \li -test : runs the unit tests of the policies.
+ *
+ * Logs are read in the formats of the server, binary or combined, see
+ * LogReader. The standard input is read if no file is given.
+ *
+ * The requests of GET and HEAD which succeeded (200, 206 and 304) are
+ * replayed through LRU, CLOCK, ARC and W-TinyLFU, and the hit ratio and the
+ * byte hit ratio are printed for each capacity. A file is identified by the
+ * path of the URI, without the query, and its size is the largest
+ * body_bytes_sent of 200. A file larger than the capacity is never cached.
+ *
+ * The policies are sized in bytes instead of entries:
+ *
+ * \li LRU evicts the least recently used files, as ContentCache does.
+ * \li CLOCK gives the files referenced since they were passed a second
+ * chance.
+ * \li ARC balances recency (T1) and frequency (T2) with the ghost lists of
+ * evicted files (B1 and B2), adapting the target size of T1 in bytes.
+ * \li W-TinyLFU admits a file to the main SLRU (20% probation, 80% protected)
+ * from a 1% LRU window only if its frequency, estimated by a count-min
+ * sketch of 4-bit counters halved periodically, exceeds that of the victim.
+ */
+#include "log.h"
+#include "util.h"
+
+#include <errno.h>  // errno
+#include <stdint.h> // int64_t
+#include <stdio.h>  // printf(3)
+#include <stdlib.h> // strtod(3)
+#include <string.h> // strcmp(3)
+
+// clang-format off
+#define CACHESIM_MIN_SIZE    (64 * 1024) ///< the least capacity by default
+#define CACHESIM_MAX_SIZES   64          ///< capacities of -s
+#define CACHESIM_MAX_WORKERS 1024        ///< the maximum of -w
+// clang-format on
+
+typedef struct {
+    char *prog_name;
+    int64_t sizes[CACHESIM_MAX_SIZES];
+    int nsizes;
+    int workers;
+    bool test;
+    Vector *files;
+} CachesimOption;
+
+static CachesimOption *Opt;
+
+// the trace: requests as ids of files
+static int *Trace;
+static long TraceLen;
+static long TraceCap;
+
+// files, by id
+static char **Keys;
+static int64_t *Sizes;
+static int NFiles;
+static int FilesCap;
+
+// the hash table of Keys, of ids + 1, 0 if empty
+static int *Table;
+static int TableCap;
+
+static void run_all_test_cachesim();
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "%s [-s SIZES] [-w WORKERS] [FILE...]\n", prog_name);
+    fprintf(stderr, "%s -test\n", prog_name);
+}
+
+/// parses a size with the suffix K, M or G, returns -1 if malformed
+static int64_t parse_size(const char *str) {
+    char *end;
+    double v = strtod(str, &end);
+
+    switch (*end) {
+    case 'K':
+        v *= 1024;
+        end++;
+        break;
+    case 'M':
+        v *= 1024 * 1024;
+        end++;
+        break;
+    case 'G':
+        v *= 1024 * 1024 * 1024;
+        end++;
+        break;
+    }
+    if (end == str || *end != '\0' || v <= 0)
+        return -1;
+    return (int64_t)v;
+}
+
+static void parse_sizes(CachesimOption *opts, char *arg, Exception *ex) {
+    for (char *p = strtok(arg, ","); p != NULL; p = strtok(NULL, ",")) {
+        int64_t size = parse_size(p);
+        if (size < 0 || opts->nsizes == CACHESIM_MAX_SIZES) {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "bad SIZES";
+            return;
+        }
+        opts->sizes[opts->nsizes++] = size;
+    }
+}
+
+static CachesimOption *CachesimOption_parse(int argc, char **argv,
+                                            Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    CachesimOption *opts = calloc(1, sizeof(CachesimOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->workers = 1;
+    opts->files = new_Vector();
+
+    while (ex->ty == E_Okay && ArgsIter_hasNext(iter)) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-s") == 0 || strcmp(arg, "-w") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument";
+                break;
+            }
+            if (arg[1] == 's')
+                parse_sizes(opts, ArgsIter_next(iter), ex);
+            else
+                opts->workers = atoi(ArgsIter_next(iter));
+        } else if (strcmp(arg, "-test") == 0) {
+            opts->test = true;
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+        } else {
+            Vector_push(opts->files, arg);
+        }
+    }
+    delete_ArgsIter(iter);
+
+    if (ex->ty == E_Okay &&
+        (opts->workers <= 0 || opts->workers > CACHESIM_MAX_WORKERS)) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "bad WORKERS";
+    }
+    return opts;
+}
+
+//
+// trace
+//
+
+static unsigned hash(const char *str) {
+    unsigned h = 2166136261u; // FNV-1a
+    for (; *str; str++)
+        h = (h ^ (unsigned char)*str) * 16777619u;
+    return h;
+}
+
+/// doubles the hash table
+static void grow_table() {
+    int cap = TableCap == 0 ? 1024 : TableCap * 2;
+    int *table = calloc(cap, sizeof(int));
+
+    for (int id = 0; id < NFiles; id++) {
+        unsigned i = hash(Keys[id]) & (cap - 1);
+        while (table[i] != 0)
+            i = (i + 1) & (cap - 1);
+        table[i] = id + 1;
+    }
+    free(Table);
+    Table = table;
+    TableCap = cap;
+}
+
+/// returns the id of the file, added if new
+static int intern(const char *key) {
+    if (NFiles * 2 >= TableCap)
+        grow_table();
+
+    unsigned i = hash(key) & (TableCap - 1);
+    for (; Table[i] != 0; i = (i + 1) & (TableCap - 1))
+        if (strcmp(Keys[Table[i] - 1], key) == 0)
+            return Table[i] - 1;
+
+    if (NFiles == FilesCap) {
+        FilesCap = FilesCap == 0 ? 1024 : FilesCap * 2;
+        Keys = realloc(Keys, FilesCap * sizeof(char *));
+        Sizes = realloc(Sizes, FilesCap * sizeof(int64_t));
+    }
+    Keys[NFiles] = strdup(key);
+    Sizes[NFiles] = 0;
+    Table[i] = NFiles + 1;
+    return NFiles++;
+}
+
+/// appends the request to the trace, if it is of a file
+static void add_request(LogEntry *e) {
+    int status = atoi(e->status);
+    if (status != 200 && status != 206 && status != 304)
+        return;
+
+    const char *r = e->request;
+    size_t mlen = strcspn(r, " ");
+    if (!((mlen == 3 && strncmp(r, "GET", 3) == 0) ||
+          (mlen == 4 && strncmp(r, "HEAD", 4) == 0)) ||
+        r[mlen] != ' ')
+        return;
+
+    char key[LOG_STR_MAX];
+    const char *uri = r + mlen + 1;
+    size_t len = strcspn(uri, " ?");
+    if (len >= sizeof(key))
+        len = sizeof(key) - 1;
+    memcpy(key, uri, len);
+    key[len] = '\0';
+
+    int id = intern(key);
+    if (status == 200 && strcmp(e->body_bytes_sent, "-") != 0) {
+        int64_t bytes = strtoll(e->body_bytes_sent, NULL, 10);
+        if (bytes > Sizes[id])
+            Sizes[id] = bytes;
+    }
+
+    if (TraceLen == TraceCap) {
+        TraceCap = TraceCap == 0 ? 4096 : TraceCap * 2;
+        Trace = realloc(Trace, TraceCap * sizeof(int));
+    }
+    Trace[TraceLen++] = id;
+}
+
+/// forgets the trace and the files
+static void clear_trace() {
+    for (int id = 0; id < NFiles; id++)
+        free(Keys[id]);
+    free(Keys);
+    free(Sizes);
+    free(Table);
+    free(Trace);
+    Keys = NULL;
+    Sizes = NULL;
+    Table = NULL;
+    Trace = NULL;
+    NFiles = FilesCap = TableCap = 0;
+    TraceLen = TraceCap = 0;
+}
+
+static void read_log(FILE *in, const char *name) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogReader *reader = new_LogReader(in);
+    LogEntry e;
+
+    while (LogReader_next(reader, &e, ex))
+        add_request(&e);
+    if (ex->ty != E_Okay)
+        fprintf(stderr, "%s: %s\n", name, ex->msg);
+    if (reader->skipped > 0)
+        fprintf(stderr, "%s: %ld malformed lines skipped\n", name,
+                reader->skipped);
+
+    delete_LogReader(reader);
+    free(ex);
+}
+
+//
+// caches
+//
+
+/// lists of files in a cache, the most recently used first
+typedef struct {
+    int head; ///< -1 if empty
+    int tail; ///< -1 if empty
+    int64_t bytes;
+} List;
+
+/// the list which a file is in. the names of a policy share the values.
+typedef enum {
+    IN_NONE = 0,
+    IN_LRU = 1,
+    IN_CLOCK = 1,
+    IN_T1 = 1,
+    IN_T2 = 2,
+    IN_B1 = 3, ///< evicted from T1, a ghost
+    IN_B2 = 4, ///< evicted from T2, a ghost
+    IN_WINDOW = 1,
+    IN_PROBATION = 2,
+    IN_PROTECTED = 3,
+    IN_NLISTS = 5,
+} ListId;
+
+typedef struct Sim Sim;
+
+typedef struct {
+    const char *name;
+    bool (*access)(Sim *, int id); ///< returns true on a hit
+} Policy;
+
+/** @struct Sim
+ * @brief A simulated cache of a policy. Files are linked into lists by their
+ * ids.
+ */
+struct Sim {
+    int64_t capacity;
+    int64_t used; ///< bytes of the files cached, without ghosts
+    List lists[IN_NLISTS];
+    int *prev;
+    int *next;
+    unsigned char *in; ///< ListId
+    unsigned char *ref; ///< CLOCK: referenced since the last pass
+
+    double p; ///< ARC: the target bytes of T1
+
+    unsigned char *sketch; ///< W-TinyLFU: 4 rows of counters
+    int width;             ///< W-TinyLFU: counters per row, a power of two
+    long samples;          ///< W-TinyLFU: increments since the last halving
+};
+
+static Sim *new_Sim(int64_t capacity) {
+    Sim *s = calloc(1, sizeof(Sim));
+    s->capacity = capacity;
+    for (int l = 0; l < IN_NLISTS; l++)
+        s->lists[l].head = s->lists[l].tail = -1;
+    s->prev = malloc(NFiles * sizeof(int));
+    s->next = malloc(NFiles * sizeof(int));
+    s->in = calloc(NFiles, 1);
+    s->ref = calloc(NFiles, 1);
+
+    for (s->width = 16; s->width < NFiles; s->width *= 2)
+        ;
+    s->sketch = calloc(4 * s->width, 1);
+    return s;
+}
+
+static void delete_Sim(Sim *s) {
+    free(s->prev);
+    free(s->next);
+    free(s->in);
+    free(s->ref);
+    free(s->sketch);
+    free(s);
+}
+
+/// pushes the file at the head of the list
+static void push(Sim *s, ListId l, int id) {
+    List *list = &s->lists[l];
+    s->prev[id] = -1;
+    s->next[id] = list->head;
+    if (list->head != -1)
+        s->prev[list->head] = id;
+    list->head = id;
+    if (list->tail == -1)
+        list->tail = id;
+    list->bytes += Sizes[id];
+    s->in[id] = l;
+}
+
+/// removes the file from its list
+static void unlink_file(Sim *s, int id) {
+    List *list = &s->lists[s->in[id]];
+    if (s->prev[id] != -1)
+        s->next[s->prev[id]] = s->next[id];
+    else
+        list->head = s->next[id];
+    if (s->next[id] != -1)
+        s->prev[s->next[id]] = s->prev[id];
+    else
+        list->tail = s->prev[id];
+    list->bytes -= Sizes[id];
+    s->in[id] = IN_NONE;
+}
+
+/// moves the file to the head of the list, e.g. its own list
+static void move(Sim *s, ListId l, int id) {
+    unlink_file(s, id);
+    push(s, l, id);
+}
+
+static void evict(Sim *s, int id) {
+    unlink_file(s, id);
+    s->used -= Sizes[id];
+}
+
+static void admit(Sim *s, ListId l, int id) {
+    push(s, l, id);
+    s->used += Sizes[id];
+}
+
+static bool lru_access(Sim *s, int id) {
+    if (s->in[id] == IN_LRU) {
+        move(s, IN_LRU, id);
+        return true;
+    }
+    if (Sizes[id] > s->capacity)
+        return false;
+    while (s->used + Sizes[id] > s->capacity)
+        evict(s, s->lists[IN_LRU].tail);
+    admit(s, IN_LRU, id);
+    return false;
+}
+
+/**
+ * CLOCK as a FIFO queue whose tail is the hand: a referenced file at the
+ * tail is cleared and moved to the head instead of evicted.
+ */
+static bool clock_access(Sim *s, int id) {
+    if (s->in[id] == IN_CLOCK) {
+        s->ref[id] = 1;
+        return true;
+    }
+    if (Sizes[id] > s->capacity)
+        return false;
+    while (s->used + Sizes[id] > s->capacity) {
+        int hand = s->lists[IN_CLOCK].tail;
+        if (s->ref[hand]) {
+            s->ref[hand] = 0;
+            move(s, IN_CLOCK, hand);
+        } else {
+            evict(s, hand);
+        }
+    }
+    s->ref[id] = 0;
+    admit(s, IN_CLOCK, id);
+    return false;
+}
+
+/// ARC: evicts from T1 or T2 into their ghost lists to fit the file
+static void arc_replace(Sim *s, int id, bool in_b2) {
+    while (s->used + Sizes[id] > s->capacity) {
+        List *t1 = &s->lists[IN_T1];
+        int victim;
+        ListId ghost;
+        if (t1->head != -1 &&
+            (t1->bytes > s->p || (in_b2 && t1->bytes >= s->p) ||
+             s->lists[IN_T2].head == -1)) {
+            victim = t1->tail;
+            ghost = IN_B1;
+        } else {
+            victim = s->lists[IN_T2].tail;
+            ghost = IN_B2;
+        }
+        evict(s, victim);
+        push(s, ghost, victim);
+    }
+}
+
+static bool arc_access(Sim *s, int id) {
+    List *b1 = &s->lists[IN_B1], *b2 = &s->lists[IN_B2];
+    double c = s->capacity;
+
+    switch (s->in[id]) {
+    case IN_T1:
+    case IN_T2:
+        unlink_file(s, id);
+        push(s, IN_T2, id);
+        return true;
+    case IN_B1: { // recency would have hit, T1 grows
+        double ratio = b1->bytes > 0 ? (double)b2->bytes / b1->bytes : 1;
+        s->p = s->p + Sizes[id] * (ratio > 1 ? ratio : 1);
+        if (s->p > c)
+            s->p = c;
+        unlink_file(s, id);
+        if (Sizes[id] > s->capacity)
+            return false;
+        arc_replace(s, id, false);
+        admit(s, IN_T2, id);
+        return false;
+    }
+    case IN_B2: { // frequency would have hit, T2 grows
+        double ratio = b2->bytes > 0 ? (double)b1->bytes / b2->bytes : 1;
+        s->p = s->p - Sizes[id] * (ratio > 1 ? ratio : 1);
+        if (s->p < 0)
+            s->p = 0;
+        unlink_file(s, id);
+        if (Sizes[id] > s->capacity)
+            return false;
+        arc_replace(s, id, true);
+        admit(s, IN_T2, id);
+        return false;
+    }
+    }
+
+    if (Sizes[id] > s->capacity)
+        return false;
+    // T1 and B1 hold up to c bytes, and all lists up to 2c bytes
+    List *t1 = &s->lists[IN_T1];
+    while (t1->bytes + b1->bytes + Sizes[id] > c && b1->tail != -1)
+        unlink_file(s, b1->tail);
+    while (t1->bytes + Sizes[id] > c)
+        evict(s, t1->tail);
+    while (s->used + b1->bytes + b2->bytes + Sizes[id] > 2 * c &&
+           b2->tail != -1)
+        unlink_file(s, b2->tail);
+    arc_replace(s, id, false);
+    admit(s, IN_T1, id);
+    return false;
+}
+
+static unsigned sketch_index(Sim *s, int id, int row) {
+    static const uint64_t seeds[] = {0x9e3779b97f4a7c15, 0xbf58476d1ce4e5b9,
+                                     0x94d049bb133111eb, 0xd6e8feb86659fd93};
+    uint64_t h = ((uint64_t)id + 1) * seeds[row];
+    return row * s->width + ((h >> 32) & (s->width - 1));
+}
+
+static int frequency(Sim *s, int id) {
+    int freq = 15;
+    for (int row = 0; row < 4; row++) {
+        int v = s->sketch[sketch_index(s, id, row)];
+        if (v < freq)
+            freq = v;
+    }
+    return freq;
+}
+
+/// counts the access, and halves the counters every 10 accesses per counter
+static void sketch_increment(Sim *s, int id) {
+    for (int row = 0; row < 4; row++) {
+        unsigned char *v = &s->sketch[sketch_index(s, id, row)];
+        if (*v < 15)
+            (*v)++;
+    }
+    if (++s->samples >= 10L * s->width) {
+        for (int i = 0; i < 4 * s->width; i++)
+            s->sketch[i] >>= 1;
+        s->samples /= 2;
+    }
+}
+
+/// the least recently used file of the main SLRU, or the window
+static int tinylfu_victim(Sim *s) {
+    if (s->lists[IN_PROBATION].tail != -1)
+        return s->lists[IN_PROBATION].tail;
+    if (s->lists[IN_PROTECTED].tail != -1)
+        return s->lists[IN_PROTECTED].tail;
+    return s->lists[IN_WINDOW].tail;
+}
+
+static bool tinylfu_access(Sim *s, int id) {
+    int64_t window_cap = s->capacity / 100;
+    int64_t protected_cap = (s->capacity - window_cap) * 8 / 10;
+
+    sketch_increment(s, id);
+    switch (s->in[id]) {
+    case IN_WINDOW:
+        move(s, IN_WINDOW, id);
+        return true;
+    case IN_PROBATION:
+        move(s, IN_PROTECTED, id);
+        while (s->lists[IN_PROTECTED].bytes > protected_cap)
+            move(s, IN_PROBATION, s->lists[IN_PROTECTED].tail);
+        return true;
+    case IN_PROTECTED:
+        move(s, IN_PROTECTED, id);
+        return true;
+    }
+    if (Sizes[id] > s->capacity)
+        return false;
+
+    // the files out of the window are candidates at the head of probation
+    admit(s, IN_WINDOW, id);
+    int candidates = 0;
+    while (s->lists[IN_WINDOW].bytes > window_cap) {
+        move(s, IN_PROBATION, s->lists[IN_WINDOW].tail);
+        candidates++;
+    }
+
+    // each candidate, oldest first, competes with the victims to stay
+    int candidate = candidates > 0 ? s->lists[IN_PROBATION].head : -1;
+    for (int i = 1; i < candidates; i++)
+        candidate = s->next[candidate];
+    while (s->used > s->capacity) {
+        int victim = tinylfu_victim(s);
+        if (candidate == -1 || victim == candidate) {
+            if (victim == candidate)
+                candidate = --candidates > 0 ? s->prev[victim] : -1;
+            evict(s, victim);
+            continue;
+        }
+        if (frequency(s, candidate) > frequency(s, victim)) {
+            evict(s, victim);
+        } else {
+            int loser = candidate;
+            candidate = --candidates > 0 ? s->prev[loser] : -1;
+            evict(s, loser);
+        }
+    }
+    return false;
+}
+
+static const Policy Policies[] = {
+    {"LRU", lru_access},
+    {"CLOCK", clock_access},
+    {"ARC", arc_access},
+    {"W-TinyLFU", tinylfu_access},
+};
+#define NPOLICIES ((int)(sizeof(Policies) / sizeof(Policies[0])))
+
+/// the ratios of a policy at a capacity
+typedef struct {
+    double hit;
+    double byte_hit;
+} Ratio;
+
+/// replays the trace through the caches of the workers
+static Ratio simulate(const Policy *policy, int64_t capacity) {
+    Sim **sims = calloc(Opt->workers, sizeof(Sim *));
+    uint64_t hits = 0, bytes = 0, byte_hits = 0;
+
+    for (int w = 0; w < Opt->workers; w++)
+        sims[w] = new_Sim(capacity);
+    for (long i = 0; i < TraceLen; i++) {
+        int id = Trace[i];
+        bytes += Sizes[id];
+        if (policy->access(sims[i % Opt->workers], id)) {
+            hits++;
+            byte_hits += Sizes[id];
+        }
+    }
+    for (int w = 0; w < Opt->workers; w++)
+        delete_Sim(sims[w]);
+    free(sims);
+
+    return (Ratio){
+        .hit = TraceLen > 0 ? (double)hits / TraceLen : 0,
+        .byte_hit = bytes > 0 ? (double)byte_hits / bytes : 0,
+    };
+}
+
+static char *format_size(int64_t size, char *buf, int len) {
+    const char *units = "KMG";
+    int u = -1;
+    while (u < 2 && size >= 1024 && size % 1024 == 0) {
+        size /= 1024;
+        u++;
+    }
+    if (u < 0)
+        snprintf(buf, len, "%jd", (intmax_t)size);
+    else
+        snprintf(buf, len, "%jd%c", (intmax_t)size, units[u]);
+    return buf;
+}
+
+static void print_result() {
+    int64_t total = 0;
+    char buf[32];
+
+    for (int id = 0; id < NFiles; id++)
+        total += Sizes[id];
+    printf("%ld requests, %d files, %.2f MB, %d worker(s)\n", TraceLen, NFiles,
+           total / 1e6, Opt->workers);
+
+    printf("%-8s", "size");
+    for (int p = 0; p < NPOLICIES; p++)
+        printf(" %15s", Policies[p].name);
+    printf("\n%-8s", "");
+    for (int p = 0; p < NPOLICIES; p++)
+        printf(" %7s %7s", "hit", "byte");
+    printf("\n");
+
+    for (int i = 0; i < Opt->nsizes; i++) {
+        printf("%-8s", format_size(Opt->sizes[i], buf, sizeof(buf)));
+        for (int p = 0; p < NPOLICIES; p++) {
+            Ratio r = simulate(&Policies[p], Opt->sizes[i]);
+            printf(" %6.2f%% %6.2f%%", r.hit * 100, r.byte_hit * 100);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    Opt = CachesimOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(Opt->prog_name);
+        return EXIT_FAILURE;
+    }
+
+    if (Opt->test) {
+        run_all_test_cachesim();
+        printf(" All unit tests passed.\n");
+        free(ex);
+        return EXIT_SUCCESS;
+    }
+
+    if (Opt->files->len == 0)
+        read_log(stdin, "-");
+    for (int i = 0; i < Opt->files->len; i++) {
+        char *path = Opt->files->data[i];
+        FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+        if (in == NULL) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            continue;
+        }
+        read_log(in, path);
+        if (in != stdin)
+            fclose(in);
+    }
+    if (TraceLen == 0)
+        error("Error: no requests of files in the log");
+
+    if (Opt->nsizes == 0) {
+        int64_t total = 0;
+        for (int id = 0; id < NFiles; id++)
+            total += Sizes[id];
+        for (int64_t size = CACHESIM_MIN_SIZE;
+             Opt->nsizes < CACHESIM_MAX_SIZES; size *= 2) {
+            Opt->sizes[Opt->nsizes++] = size;
+            if (size >= total)
+                break;
+        }
+    }
+    print_result();
+
+    clear_trace();
+    free(ex);
+    return EXIT_SUCCESS;
+}
+
+//
+// tests
+//
+
+/// appends a request of GET which succeeded with the size to the trace
+static void add_get(const char *uri, int64_t bytes) {
+    char request[LOG_STR_MAX], bytes_sent[32];
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1", uri);
+    snprintf(bytes_sent, sizeof(bytes_sent), "%jd", (intmax_t)bytes);
+    LogEntry e = {
+        .request = request, .status = "200", .body_bytes_sent = bytes_sent};
+    add_request(&e);
+}
+
+/// counts the hits of the policy over the trace, in a cache
+static int count_hits(const Policy *policy, int64_t capacity) {
+    Sim *s = new_Sim(capacity);
+    int hits = 0;
+    for (long i = 0; i < TraceLen; i++)
+        if (policy->access(s, Trace[i]))
+            hits++;
+    delete_Sim(s);
+    return hits;
+}
+
+static void test_add_request() {
+    LogEntry e = {.request = "GET /a?x=1 HTTP/1.1",
+                  .status = "200",
+                  .body_bytes_sent = "10"};
+    add_request(&e);
+    e.request = "HEAD /a HTTP/1.1";
+    e.status = "304";
+    e.body_bytes_sent = "0";
+    add_request(&e);
+    e.request = "GET /a HTTP/1.1";
+    e.status = "200";
+    e.body_bytes_sent = "20";
+    add_request(&e);
+    e.request = "POST /a HTTP/1.1"; // not of a file
+    add_request(&e);
+    e.request = "GET /b HTTP/1.1"; // failed
+    e.status = "404";
+    add_request(&e);
+
+    expect(__LINE__, 3, TraceLen);
+    expect(__LINE__, 1, NFiles);
+    expect_str(__LINE__, "/a", Keys[0]);
+    expect(__LINE__, 20, Sizes[0]);
+    clear_trace();
+}
+
+/**
+ * Replays a short trace of files of a byte through caches of 3 bytes. The
+ * hits are counted by hand:
+ *
+ * \li LRU hits the 4th, 6th and 9th A and the 10th B.
+ * \li CLOCK gives A a second chance twice, and hits as LRU does.
+ * \li ARC moves A to T2 and evicts it to B2 for E, as B back from B1 takes
+ * T2 too, so the 9th A misses.
+ * \li W-TinyLFU rejects D and E, as their frequency does not exceed that of
+ * the victims B and C in probation, and keeps A and B.
+ */
+static void test_policies() {
+    static const int expected[NPOLICIES] = {4, 4, 3, 5};
+    for (const char *p = "ABCADABEAB"; *p != '\0'; p++) {
+        char uri[] = {'/', *p, '\0'};
+        add_get(uri, 1);
+    }
+    for (int p = 0; p < NPOLICIES; p++)
+        expect(__LINE__, expected[p], count_hits(&Policies[p], 3));
+    clear_trace();
+}
+
+static void test_large_file() {
+    add_get("/small", 1);
+    add_get("/large", 4);
+    add_get("/large", 4);
+    add_get("/small", 1);
+    for (int p = 0; p < NPOLICIES; p++)
+        expect(__LINE__, 1, count_hits(&Policies[p], 3));
+    clear_trace();
+}
+
+static void run_all_test_cachesim() {
+    test_add_request();
+    test_policies();
+    test_large_file();
+}
@@ -0,0 +1,448 @@
+#include "compress.h"
+#include "util.h"
+
+#include <stdlib.h>  // getloadavg(3)
+#include <string.h>  // strdup(3)
+#include <strings.h> // strncasecmp(3)
+#include <unistd.h>  // sysconf(3)
+#include <zlib.h>    // deflate(3)
+
+//
+// content negotiation
+//
+
+/**
+ * Selects a content-coding from the field-value of Accept-Encoding.
+ *
+ * gzip is preferred to deflate if both have the same qvalue.
+ * codings with "q=0" are never selected.
+ *
+ * @return the selected content-coding, CE_IDENTITY if none is acceptable.
+ * @param field_value the field-value of Accept-Encoding, or NULL
+ */
+ContentEncoding accept_encoding(const char *field_value) {
+    double q_gzip = -1, q_deflate = -1, q_any = -1;
+
+    if (field_value == NULL)
+        return CE_IDENTITY;
+
+    const char *p = field_value;
+    while (*p) {
+        // coding
+        while (*p == ' ' || *p == ',')
+            p++;
+        const char *name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ')
+            p++;
+        int name_len = p - name;
+
+        // qvalue
+        double q = 1;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                p++;
+                while (*p == ' ')
+                    p++;
+                if (p[0] == 'q' && p[1] == '=')
+                    q = strtod(p + 2, NULL);
+            }
+            if (*p && *p != ',')
+                p++;
+        }
+
+        if (name_len == 4 && strncasecmp(name, "gzip", 4) == 0)
+            q_gzip = q;
+        else if (name_len == 7 && strncasecmp(name, "deflate", 7) == 0)
+            q_deflate = q;
+        else if (name_len == 1 && *name == '*')
+            q_any = q;
+    }
+
+    if (q_gzip < 0)
+        q_gzip = q_any;
+    if (q_deflate < 0)
+        q_deflate = q_any;
+
+    if (q_gzip > 0 && q_gzip >= q_deflate)
+        return CE_GZIP;
+    if (q_deflate > 0)
+        return CE_DEFLATE;
+    return CE_IDENTITY;
+}
+
+/**
+ * Returns the name of the content-coding used in Content-Encoding.
+ *
+ * @return the name of the content-coding
+ * @param enc content-coding
+ */
+const char *ContentEncoding_name(ContentEncoding enc) {
+    switch (enc) {
+    case CE_GZIP:
+        return "gzip";
+    case CE_DEFLATE:
+        return "deflate";
+    default:
+        return "identity";
+    }
+}
+
+/**
+ * Returns true if the media type is worth compressing.
+ *
+ * @return true if the media type is in the allowlist, or is text, XML or JSON
+ * by its structured syntax suffix, e.g. "application/atom+xml".
+ * @param mime_type media type such as "text/html"
+ */
+bool compressible_type(const char *mime_type) {
+    static const char *allowlist[] = {
+        "application/javascript",
+        "application/json",
+        "application/wasm",
+        "application/xml",
+    };
+    size_t len = strlen(mime_type);
+
+    if (strncmp(mime_type, "text/", strlen("text/")) == 0)
+        return true;
+    if ((len > 4 && strcmp(mime_type + len - 4, "+xml") == 0) ||
+        (len > 5 && strcmp(mime_type + len - 5, "+json") == 0))
+        return true;
+    for (int i = 0; i < sizeof(allowlist) / sizeof(*allowlist); i++) {
+        if (strcmp(mime_type, allowlist[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Returns the compression level for the current CPU load.
+ *
+ * The level drops toward 1 as the 1-minute load average approaches the number
+ * of online processors, so that compression does not starve request handling.
+ *
+ * @return compression level between 1 and COMPRESS_LEVEL
+ */
+int compress_level() {
+    double load;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (getloadavg(&load, 1) != 1 || ncpu <= 0)
+        return COMPRESS_LEVEL;
+    if (load >= ncpu)
+        return 1;
+
+    int level = COMPRESS_LEVEL - (int)(COMPRESS_LEVEL * load / ncpu);
+    return level < 1 ? 1 : level;
+}
+
+/**
+ * Compresses the buffer.
+ *
+ * caller must free the allocated memory stores the compressed data.
+ *
+ * @return compressed data, or NULL if error occurred
+ * @param src data to compress
+ * @param len length of src
+ * @param enc CE_GZIP or CE_DEFLATE
+ * @param level compression level
+ * @param out_len length of compressed data
+ */
+char *compress_buf(const char *src, int len, ContentEncoding enc, int level,
+                   int *out_len) {
+    z_stream zs = {0};
+    int window_bits = (enc == CE_GZIP) ? 15 + 16 : 15;
+
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return NULL;
+
+    int siz = deflateBound(&zs, len);
+    char *dest = malloc(siz);
+
+    zs.next_in = (Bytef *)src;
+    zs.avail_in = len;
+    zs.next_out = (Bytef *)dest;
+    zs.avail_out = siz;
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        free(dest);
+        return NULL;
+    }
+
+    *out_len = zs.total_out;
+    deflateEnd(&zs);
+
+    return dest;
+}
+
+//
+// ContentCache
+//
+
+static unsigned hash(const char *path, time_t mtime, ContentEncoding enc) {
+    unsigned h = 2166136261u; // FNV-1a
+
+    for (const char *p = path; *p; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    h = (h ^ (unsigned)mtime) * 16777619u;
+    h = (h ^ (unsigned)enc) * 16777619u;
+
+    return h;
+}
+
+static void lru_unlink(ContentCache *cache, CacheEntry *e) {
+    if (e->_lru_prev)
+        e->_lru_prev->_lru_next = e->_lru_next;
+    else
+        cache->_lru_head = e->_lru_next;
+    if (e->_lru_next)
+        e->_lru_next->_lru_prev = e->_lru_prev;
+    else
+        cache->_lru_tail = e->_lru_prev;
+}
+
+static void lru_push_front(ContentCache *cache, CacheEntry *e) {
+    e->_lru_prev = NULL;
+    e->_lru_next = cache->_lru_head;
+    if (cache->_lru_head)
+        cache->_lru_head->_lru_prev = e;
+    cache->_lru_head = e;
+    if (cache->_lru_tail == NULL)
+        cache->_lru_tail = e;
+}
+
+static void evict(ContentCache *cache, CacheEntry *e) {
+    CacheEntry **pp =
+        &cache->_buckets[hash(e->path, e->mtime, e->enc) % cache->_nbuckets];
+    while (*pp != e)
+        pp = &(*pp)->_next;
+    *pp = e->_next;
+
+    lru_unlink(cache, e);
+    cache->size -= e->len;
+
+    free(e->path);
+    free(e->data);
+    free(e);
+}
+
+static CacheEntry *find(ContentCache *cache, const char *path, time_t mtime,
+                        ContentEncoding enc) {
+    CacheEntry *e = cache->_buckets[hash(path, mtime, enc) % cache->_nbuckets];
+
+    for (; e != NULL; e = e->_next)
+        if (e->mtime == mtime && e->enc == enc && strcmp(e->path, path) == 0)
+            return e;
+    return NULL;
+}
+
+/**
+ * Creates a new ContentCache object.
+ *
+ * @return a pointer to a new ContentCache object
+ * @param capacity upper bound of the total size of cached data in bytes
+ */
+ContentCache *new_ContentCache(long capacity) {
+    ContentCache *cache = calloc(1, sizeof(ContentCache));
+
+    cache->capacity = capacity;
+    cache->_nbuckets = 256;
+    cache->_buckets = calloc(cache->_nbuckets, sizeof(CacheEntry *));
+
+    return cache;
+}
+
+/**
+ * Destroys the ContentCache object and all its entries.
+ *
+ * @param cache
+ */
+void delete_ContentCache(ContentCache *cache) {
+    while (cache->_lru_head)
+        evict(cache, cache->_lru_head);
+    free(cache->_buckets);
+    free(cache);
+}
+
+/**
+ * Returns the cached variant, or NULL if the cache has no variant for the
+ * key.
+ *
+ * @return the cached entry, or NULL
+ * @param cache
+ * @param path
+ * @param mtime last modification time of the file
+ * @param enc content-coding of the variant
+ */
+CacheEntry *ContentCache_get(ContentCache *cache, const char *path,
+                             time_t mtime, ContentEncoding enc) {
+    CacheEntry *e = find(cache, path, mtime, enc);
+
+    if (e == NULL) {
+        cache->misses++;
+        return NULL;
+    }
+    lru_unlink(cache, e);
+    lru_push_front(cache, e);
+    cache->hits++;
+    return e;
+}
+
+/**
+ * Stores the variant to the cache, evicting least recently used entries if
+ * the cache is full. The cache takes ownership of data. If the variant is
+ * already cached, the entry is kept and data is freed.
+ *
+ * @return the new or the cached entry, or NULL if data is larger than the
+ * capacity (data is freed in that case).
+ * @param cache
+ * @param path
+ * @param mtime last modification time of the file
+ * @param enc content-coding of the variant
+ * @param data compressed data
+ * @param len length of data
+ */
+CacheEntry *ContentCache_put(ContentCache *cache, const char *path,
+                             time_t mtime, ContentEncoding enc, char *data,
+                             int len) {
+    CacheEntry *e = find(cache, path, mtime, enc);
+    if (e != NULL || len > cache->capacity) {
+        free(data);
+        return e;
+    }
+    while (cache->size + len > cache->capacity)
+        evict(cache, cache->_lru_tail);
+
+    e = calloc(1, sizeof(CacheEntry));
+    e->path = strdup(path);
+    e->mtime = mtime;
+    e->enc = enc;
+    e->data = data;
+    e->len = len;
+
+    CacheEntry **bucket =
+        &cache->_buckets[hash(path, mtime, enc) % cache->_nbuckets];
+    e->_next = *bucket;
+    *bucket = e;
+    lru_push_front(cache, e);
+    cache->size += len;
+
+    return e;
+}
+
+static void test_accept_encoding() {
+    // clang-format off
+    expect(__LINE__, CE_IDENTITY, accept_encoding(NULL));
+    expect(__LINE__, CE_IDENTITY, accept_encoding(""));
+    expect(__LINE__, CE_IDENTITY, accept_encoding("br"));
+    expect(__LINE__, CE_GZIP,     accept_encoding("gzip"));
+    expect(__LINE__, CE_GZIP,     accept_encoding("deflate, gzip"));
+    expect(__LINE__, CE_GZIP,     accept_encoding("GZIP"));
+    expect(__LINE__, CE_DEFLATE,  accept_encoding("deflate"));
+    expect(__LINE__, CE_DEFLATE,  accept_encoding("gzip;q=0.5, deflate"));
+    expect(__LINE__, CE_DEFLATE,  accept_encoding("gzip;q=0, *"));
+    expect(__LINE__, CE_IDENTITY, accept_encoding("gzip;q=0, deflate; q=0"));
+    expect(__LINE__, CE_GZIP,     accept_encoding("*"));
+    expect(__LINE__, CE_IDENTITY, accept_encoding("*;q=0"));
+    expect(__LINE__, CE_IDENTITY, accept_encoding("gzipx, xdeflate"));
+    // clang-format on
+}
+
+static void test_compressible_type() {
+    // clang-format off
+    expect_bool(__LINE__, true,  compressible_type("text/html"));
+    expect_bool(__LINE__, true,  compressible_type("text/plain"));
+    expect_bool(__LINE__, true,  compressible_type("image/svg+xml"));
+    expect_bool(__LINE__, true,  compressible_type("application/ld+json"));
+    expect_bool(__LINE__, false, compressible_type("+json"));
+    expect_bool(__LINE__, false, compressible_type("image/png"));
+    expect_bool(__LINE__, false, compressible_type("video/x-ms-wmv"));
+    // clang-format on
+}
+
+static void test_compress_buf() {
+    char src[1000], dest[1000];
+    int len;
+
+    memset(src, 'a', sizeof(src));
+
+    // gzip
+    char *gz = compress_buf(src, sizeof(src), CE_GZIP, 6, &len);
+    expect_bool(__LINE__, true, len < sizeof(src));
+    expect(__LINE__, 0x1f, (unsigned char)gz[0]); // magic number
+    expect(__LINE__, 0x8b, (unsigned char)gz[1]);
+
+    z_stream zs = {0};
+    inflateInit2(&zs, 15 + 16);
+    zs.next_in = (Bytef *)gz;
+    zs.avail_in = len;
+    zs.next_out = (Bytef *)dest;
+    zs.avail_out = sizeof(dest);
+    expect(__LINE__, Z_STREAM_END, inflate(&zs, Z_FINISH));
+    expect(__LINE__, sizeof(src), zs.total_out);
+    expect(__LINE__, 0, memcmp(src, dest, sizeof(src)));
+    inflateEnd(&zs);
+    free(gz);
+
+    // deflate
+    char *df = compress_buf(src, sizeof(src), CE_DEFLATE, 1, &len);
+    uLongf dest_len = sizeof(dest);
+    expect(__LINE__, Z_OK,
+           uncompress((Bytef *)dest, &dest_len, (Bytef *)df, len));
+    expect(__LINE__, sizeof(src), dest_len);
+    free(df);
+}
+
+static void test_compress_level() {
+    int level = compress_level();
+    expect_bool(__LINE__, true, 1 <= level && level <= COMPRESS_LEVEL);
+}
+
+static void test_ContentCache() {
+    ContentCache *cache = new_ContentCache(10);
+
+    expect_ptr(__LINE__, NULL, ContentCache_get(cache, "a", 1, CE_GZIP));
+    expect(__LINE__, 1, cache->misses);
+
+    ContentCache_put(cache, "a", 1, CE_GZIP, strdup("aaaa"), 4);
+    ContentCache_put(cache, "b", 1, CE_GZIP, strdup("bbbb"), 4);
+    expect(__LINE__, 8, cache->size);
+    CacheEntry *e = ContentCache_get(cache, "a", 1, CE_GZIP);
+    expect_str(__LINE__, "aaaa", e->data);
+    expect(__LINE__, 1, cache->hits);
+
+    // key is path, mtime and encoding
+    expect_ptr(__LINE__, NULL, ContentCache_get(cache, "a", 2, CE_GZIP));
+    expect_ptr(__LINE__, NULL, ContentCache_get(cache, "a", 1, CE_DEFLATE));
+
+    // "b" is the least recently used
+    ContentCache_put(cache, "c", 1, CE_GZIP, strdup("cccc"), 4);
+    expect(__LINE__, 8, cache->size);
+    expect_ptr(__LINE__, NULL, ContentCache_get(cache, "b", 1, CE_GZIP));
+    expect_bool(__LINE__, true, ContentCache_get(cache, "a", 1, CE_GZIP));
+    expect_bool(__LINE__, true, ContentCache_get(cache, "c", 1, CE_GZIP));
+
+    // already cached
+    e = ContentCache_get(cache, "a", 1, CE_GZIP);
+    expect_ptr(__LINE__, e,
+               ContentCache_put(cache, "a", 1, CE_GZIP, strdup("AAAA"), 4));
+    expect_str(__LINE__, "aaaa", e->data);
+    expect(__LINE__, 8, cache->size);
+
+    // larger than the capacity
+    expect_ptr(__LINE__, NULL,
+               ContentCache_put(cache, "d", 1, CE_GZIP,
+                                strdup("dddddddddddd"), 12));
+    expect(__LINE__, 8, cache->size);
+
+    delete_ContentCache(cache);
+}
+
+void run_all_test_compress() {
+    test_accept_encoding();
+    test_compressible_type();
+    test_compress_buf();
+    test_compress_level();
+    test_ContentCache();
+}
@@ -0,0 +1,76 @@
+/** @file
+ * provides on-the-fly content compression and a cache of compressed variants.
+ */
+#pragma once
+
+#include <stdbool.h> // bool
+#include <time.h>    // time_t
+
+// clang-format off
+#define COMPRESS_MIN_SIZE   256               ///< smaller bodies are sent as is
+#define COMPRESS_MAX_SIZE   (16 * 1024 * 1024) ///< larger bodies are sent as is
+#define COMPRESS_CACHE_SIZE (8 * 1024 * 1024)  ///< capacity of ContentCache
+#define COMPRESS_LEVEL      6                  ///< level used when CPU is idle
+// clang-format on
+
+/// content-coding
+typedef enum {
+    CE_IDENTITY, ///< identity
+    CE_GZIP,     ///< gzip
+    CE_DEFLATE,  ///< deflate (zlib format)
+} ContentEncoding;
+
+ContentEncoding accept_encoding(const char *field_value);
+const char *ContentEncoding_name(ContentEncoding enc);
+bool compressible_type(const char *mime_type);
+int compress_level();
+char *compress_buf(const char *src, int len, ContentEncoding enc, int level,
+                   int *out_len);
+
+typedef struct CacheEntry CacheEntry;
+
+/** @struct CacheEntry
+ * a compressed variant of a file.
+ */
+struct CacheEntry {
+    char *path;
+    time_t mtime;
+    ContentEncoding enc;
+
+    char *data;
+    int len;
+
+    CacheEntry *_next;      // for internal: next entry in the same bucket
+    CacheEntry *_lru_prev;  // for internal: more recently used entry
+    CacheEntry *_lru_next;  // for internal: less recently used entry
+};
+
+/** @struct ContentCache
+ * @brief A bounded cache of compressed variants keyed by path, mtime and
+ * encoding. the least recently used entries are evicted first.
+ *
+ * \li new_ContentCache()
+ * \li delete_ContentCache()
+ * \li ContentCache_get()
+ * \li ContentCache_put()
+ */
+typedef struct {
+    long capacity; ///< upper bound of the total size of data in bytes
+    long size;     ///< total size of data in bytes
+    long hits;
+    long misses;
+
+    CacheEntry **_buckets;
+    int _nbuckets;
+    CacheEntry *_lru_head;
+    CacheEntry *_lru_tail;
+} ContentCache;
+
+ContentCache *new_ContentCache(long capacity);
+void delete_ContentCache(ContentCache *);
+CacheEntry *ContentCache_get(ContentCache *, const char *path, time_t mtime,
+                             ContentEncoding enc);
+CacheEntry *ContentCache_put(ContentCache *, const char *path, time_t mtime,
+                             ContentEncoding enc, char *data, int len);
+
+void run_all_test_compress();
@@ -2,12 +2,19 @@
 #include "util.h"
 
 #include <dirent.h>    // opendir(3)
+#include <errno.h>     // errno
+#include <fcntl.h>     // open(2)
+#include <stdio.h>     // snprintf(3)
 #include <stdlib.h>    // malloc(3)
 #include <string.h>    // strdup(3)
 #include <sys/stat.h>  // stat(2)
 #include <sys/types.h> // stat(2)
+#include <time.h>      // strftime(3)
 #include <unistd.h>    // stat(2)
 
+/// sets the type, the length and the validators of the file from st
+static void set_stat(File *file, const struct stat *st);
+
 /**
  * Creates a new File object from the path string.
  *
@@ -27,8 +34,38 @@ File *new_File(const char *path) {
     // File.path
     file->path = strdup(path);
 
+    set_stat(file, &st);
+    return file;
+}
+
+/**
+ * Opens the file to read, and updates the type, the length and the
+ * validators of the File object from the open file, as the file may have
+ * been replaced or changed since it was looked up.
+ *
+ * @return the file descriptor, or -1 with errno if error occurred
+ * @param file
+ */
+int File_open(File *file) {
+    struct stat st;
+    int fd = open(file->path, O_RDONLY);
+
+    if (fd == -1)
+        return -1;
+    if (fstat(fd, &st) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    set_stat(file, &st);
+    return fd;
+}
+
+static void set_stat(File *file, const struct stat *st) {
     // File.ty
-    switch (st.st_mode & S_IFMT) {
+    switch (st->st_mode & S_IFMT) {
     case S_IFDIR:
         file->ty = F_DIR;
         break;
@@ -40,9 +77,22 @@ File *new_File(const char *path) {
     }
 
     // File.len
-    file->len = st.st_size;
+    file->len = st->st_size;
 
-    return file;
+    // File.mtime
+    file->mtime = st->st_mtime;
+
+    // File.ino
+    file->ino = st->st_ino;
+
+    // File.etag, File.last_modified
+    struct tm mtime_tm;
+    gmtime_r(&file->mtime, &mtime_tm);
+    snprintf(file->etag, sizeof(file->etag), "\"%lx-%lx-%lx\"",
+             (unsigned long)file->ino, (unsigned long)file->len,
+             (unsigned long)file->mtime);
+    strftime(file->last_modified, sizeof(file->last_modified),
+             "%a, %d %b %Y %H:%M:%S GMT", &mtime_tm);
 }
 
 /**
@@ -58,6 +108,237 @@ void delete_File(File *file) {
     free(file);
 }
 
+//
+// FileCache
+//
+
+static unsigned hash(const char *path) {
+    unsigned h = 2166136261u; // FNV-1a
+
+    for (const char *p = path; *p; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+
+    return h;
+}
+
+static void lru_unlink(FileCache *cache, FileEntry *e) {
+    if (e->_lru_prev)
+        e->_lru_prev->_lru_next = e->_lru_next;
+    else
+        cache->_lru_head = e->_lru_next;
+    if (e->_lru_next)
+        e->_lru_next->_lru_prev = e->_lru_prev;
+    else
+        cache->_lru_tail = e->_lru_prev;
+}
+
+static void lru_push_front(FileCache *cache, FileEntry *e) {
+    e->_lru_prev = NULL;
+    e->_lru_next = cache->_lru_head;
+    if (cache->_lru_head)
+        cache->_lru_head->_lru_prev = e;
+    cache->_lru_head = e;
+    if (cache->_lru_tail == NULL)
+        cache->_lru_tail = e;
+}
+
+static void evict(FileCache *cache, FileEntry *e) {
+    FileEntry **pp =
+        &cache->_buckets[hash(e->path) & (cache->_nbuckets - 1)];
+    while (*pp != e)
+        pp = &(*pp)->_next;
+    *pp = e->_next;
+
+    lru_unlink(cache, e);
+    cache->len--;
+
+    free(e->path);
+    delete_File(e->file);
+    free(e);
+}
+
+/**
+ * Creates a new FileCache object.
+ *
+ * @return a pointer to a new FileCache object
+ * @param capacity upper bound of the number of entries
+ * @param ttl seconds an entry is fresh for
+ */
+FileCache *new_FileCache(int capacity, int ttl) {
+    FileCache *cache = calloc(1, sizeof(FileCache));
+
+    cache->capacity = capacity;
+    cache->ttl = ttl;
+    // a bucket per entry, so that chains are short
+    cache->_nbuckets = 1;
+    while (cache->_nbuckets < capacity)
+        cache->_nbuckets *= 2;
+    cache->_buckets = calloc(cache->_nbuckets, sizeof(FileEntry *));
+
+    return cache;
+}
+
+/**
+ * Destroys the FileCache object and all its entries.
+ *
+ * @param cache
+ */
+void delete_FileCache(FileCache *cache) {
+    while (cache->_lru_head)
+        evict(cache, cache->_lru_head);
+    free(cache->_buckets);
+    free(cache);
+}
+
+/**
+ * Returns the fresh entry of the path. A stale entry is evicted.
+ *
+ * @return the cached entry, or NULL if the cache has no fresh entry of the
+ * path
+ * @param cache
+ * @param path
+ * @param now the current time
+ */
+FileEntry *FileCache_get(FileCache *cache, const char *path, time_t now) {
+    FileEntry *e = cache->_buckets[hash(path) & (cache->_nbuckets - 1)];
+
+    for (; e != NULL; e = e->_next) {
+        if (strcmp(e->path, path) != 0)
+            continue;
+        if (now >= e->expires) {
+            evict(cache, e);
+            break;
+        }
+        lru_unlink(cache, e);
+        lru_push_front(cache, e);
+        cache->hits++;
+        return e;
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+/**
+ * Stores the file resolved from the path to the cache, evicting the least
+ * recently used entry if the cache is full. The path must not be in the
+ * cache. The cache takes ownership of file.
+ *
+ * @return the new entry
+ * @param cache
+ * @param path
+ * @param file the file, or NULL if the path is not found
+ * @param now the current time
+ */
+FileEntry *FileCache_put(FileCache *cache, const char *path, File *file,
+                         time_t now) {
+    if (cache->len >= cache->capacity)
+        evict(cache, cache->_lru_tail);
+
+    FileEntry *e = calloc(1, sizeof(FileEntry));
+    e->path = strdup(path);
+    e->file = file;
+    e->expires = now + cache->ttl;
+
+    FileEntry **bucket = &cache->_buckets[hash(path) & (cache->_nbuckets - 1)];
+    e->_next = *bucket;
+    *bucket = e;
+    lru_push_front(cache, e);
+    cache->len++;
+
+    return e;
+}
+
+/**
+ * Removes the entry of the path from the cache if any, e.g. when the file is
+ * found gone before the entry is stale. The file of the entry is deleted.
+ *
+ * @param cache
+ * @param path
+ */
+void FileCache_remove(FileCache *cache, const char *path) {
+    FileEntry *e = cache->_buckets[hash(path) & (cache->_nbuckets - 1)];
+
+    for (; e != NULL; e = e->_next) {
+        if (strcmp(e->path, path) == 0) {
+            evict(cache, e);
+            return;
+        }
+    }
+}
+
+/**
+ * Joins the child path to the parent path into the buffer, as is without a
+ * separator, e.g. "www" and "/index.html".
+ *
+ * @return the length of the joined path, or -1 if it does not fit in the
+ * buffer
+ * @param buf the buffer, e.g. of PATH_MAX bytes on the stack
+ * @param size the size of the buffer
+ * @param parent the parent path
+ * @param child the child path
+ */
+int path_join(char *buf, size_t size, const char *parent, const char *child) {
+    size_t parent_len = strlen(parent);
+    size_t child_len = strlen(child);
+
+    if (parent_len + child_len >= size)
+        return -1;
+    memcpy(buf, parent, parent_len);
+    memcpy(buf + parent_len, child, child_len + 1);
+    return parent_len + child_len;
+}
+
+/**
+ * Returns the path to the parent directory as a slice of the path, without
+ * copying it.
+ *
+ * @return the slice of the parent path, of length 0 if the path has no '/'
+ * @param path string
+ */
+PathSlice parent_path_slice(const char *path) {
+    const char *p = strrchr(path, '/');
+
+    return (PathSlice){.off = 0, .len = p != NULL ? p - path : 0};
+}
+
+/**
+ * Returns the filename component of the path as a slice of the path, without
+ * copying it.
+ *
+ * @return the slice of the filename, to the end of the path
+ * @param path
+ */
+PathSlice filename_slice(const char *path) {
+    const char *p = strrchr(path, '/');
+    int off = p != NULL ? p + 1 - path : 0;
+
+    return (PathSlice){.off = off, .len = strlen(path + off)};
+}
+
+/**
+ * Returns the extension component of the path, after the last '.' of the
+ * filename, as a slice of the path, without copying it.
+ *
+ * @return the slice of the extension, to the end of the path, or of offset -1
+ * if the filename has no '.'
+ * @param path
+ */
+PathSlice extension_slice(const char *path) {
+    const char *dot = NULL, *p;
+
+    // a single pass, for mime_type() on every response
+    for (p = path; *p != '\0'; p++) {
+        if (*p == '/')
+            dot = NULL;
+        else if (*p == '.')
+            dot = p;
+    }
+    if (dot == NULL)
+        return (PathSlice){.off = -1, .len = 0};
+    return (PathSlice){.off = dot + 1 - path, .len = p - dot - 1};
+}
+
 /**
  * Returns the path to the parent directory.
  *
@@ -67,17 +348,8 @@ void delete_File(File *file) {
  * @param path string
  */
 char *parent_path(const char *path) {
-    char *ret = strdup(path);
-
-    for (char *p = ret + strlen(ret); p >= ret; p--) {
-        if (*p == '/') {
-            *p = '\0';
-            return ret;
-        }
-    }
-
-    *ret = '\0';
-    return ret;
+    PathSlice s = parent_path_slice(path);
+    return strndup(path + s.off, s.len);
 }
 
 /**
@@ -89,11 +361,8 @@ char *parent_path(const char *path) {
  * @param path
  */
 char *filename(const char *path) {
-    char *p = strrchr(path, '/');
-    if (p == NULL)
-        return strdup(path);
-
-    return strdup(p + 1);
+    PathSlice s = filename_slice(path);
+    return strndup(path + s.off, s.len);
 }
 
 /**
@@ -101,16 +370,12 @@ char *filename(const char *path) {
  *
  * caller must free the allocated memory stores the extension
  *
- * @return extension
+ * @return extension, or NULL if the filename has no '.'
  * @param path
  */
 char *extension(const char *path) {
-    char *fname = filename(path);
-    char *p = strrchr(fname, '.');
-    if (p == NULL)
-        return NULL;
-
-    return strdup(p + 1);
+    PathSlice s = extension_slice(path);
+    return s.off != -1 ? strndup(path + s.off, s.len) : NULL;
 }
 
 static void test_new_File() {
@@ -121,6 +386,10 @@ static void test_new_File() {
     expect(__LINE__, 1064, file->len);
     expect(__LINE__, F_FILE, file->ty);
     expect_str(__LINE__, "LICENSE", file->path);
+    expect(__LINE__, '"', file->etag[0]);
+    expect(__LINE__, '"', file->etag[strlen(file->etag) - 1]);
+    expect(__LINE__, strlen("Sun, 06 Nov 1994 08:49:37 GMT"),
+           strlen(file->last_modified));
     delete_File(file);
 
     // file not found
@@ -129,6 +398,83 @@ static void test_new_File() {
     delete_File(file);
 }
 
+static void test_File_open() {
+    char path[] = "/tmp/dali_file_XXXXXX";
+    int fd = mkstemp(path);
+    expect(__LINE__, 0, ftruncate(fd, 5000));
+    close(fd);
+
+    File *file = new_File(path);
+    char etag[sizeof(file->etag)];
+    strcpy(etag, file->etag);
+
+    // changed since new_File()
+    expect(__LINE__, 0, truncate(path, 10));
+    fd = File_open(file);
+    expect_bool(__LINE__, true, fd != -1);
+    expect(__LINE__, 10, file->len);
+    expect_bool(__LINE__, true, strcmp(etag, file->etag) != 0);
+    close(fd);
+
+    // removed since new_File()
+    unlink(path);
+    expect(__LINE__, -1, File_open(file));
+    expect(__LINE__, ENOENT, errno);
+    delete_File(file);
+}
+
+static void test_FileCache() {
+    FileCache *cache = new_FileCache(2, 1);
+
+    // found, and not found
+    expect_ptr(__LINE__, NULL, FileCache_get(cache, "LICENSE", 100));
+    FileEntry *e = FileCache_put(cache, "LICENSE", new_File("LICENSE"), 100);
+    expect_ptr(__LINE__, e, FileCache_get(cache, "LICENSE", 100));
+    expect(__LINE__, 1064, e->file->len);
+    e = FileCache_put(cache, "LICENSE.", new_File("LICENSE."), 100);
+    expect_ptr(__LINE__, e, FileCache_get(cache, "LICENSE.", 100));
+    expect_ptr(__LINE__, NULL, e->file);
+    expect(__LINE__, 2, cache->hits);
+    expect(__LINE__, 1, cache->misses);
+
+    // stale after the ttl
+    expect_ptr(__LINE__, NULL, FileCache_get(cache, "LICENSE", 101));
+    expect(__LINE__, 1, cache->len);
+
+    delete_FileCache(cache);
+
+    // the least recently used is evicted
+    cache = new_FileCache(2, 1);
+    FileCache_put(cache, "LICENSE", new_File("LICENSE"), 100);
+    FileCache_put(cache, "LICENSE.", NULL, 100);
+    FileCache_get(cache, "LICENSE", 100);
+    FileCache_put(cache, "Makefile", new_File("Makefile"), 100);
+    expect(__LINE__, 2, cache->len);
+    expect_ptr(__LINE__, NULL, FileCache_get(cache, "LICENSE.", 100));
+    expect_bool(__LINE__, true, FileCache_get(cache, "LICENSE", 100) != NULL);
+    expect_bool(__LINE__, true, FileCache_get(cache, "Makefile", 100) != NULL);
+
+    // removed before stale
+    FileCache_remove(cache, "LICENSE");
+    FileCache_remove(cache, "LICENSE"); // not in the cache
+    expect(__LINE__, 1, cache->len);
+    expect_ptr(__LINE__, NULL, FileCache_get(cache, "LICENSE", 100));
+    expect_bool(__LINE__, true, FileCache_get(cache, "Makefile", 100) != NULL);
+    delete_FileCache(cache);
+}
+
+static void test_path_join() {
+    char buf[16];
+
+    expect(__LINE__, 14, path_join(buf, sizeof(buf), "www", "/index.html"));
+    expect_str(__LINE__, "www/index.html", buf);
+    expect(__LINE__, 15, path_join(buf, sizeof(buf), "www", "/index.html5"));
+    expect_str(__LINE__, "www/index.html5", buf);
+    expect(__LINE__, -1, path_join(buf, sizeof(buf), "www", "/index.html55"));
+    expect(__LINE__, 0, path_join(buf, sizeof(buf), "", ""));
+    expect_str(__LINE__, "", buf);
+}
+
 static void test_parent_path() {
     // clang-format off
     // absolute path
@@ -151,6 +497,22 @@ static void test_filename() {
     // clang-format on
 }
 
+static void test_slice() {
+    const char *path = "/java/net/URL.java";
+
+    // clang-format off
+    expect(__LINE__, 0,  parent_path_slice(path).off);
+    expect(__LINE__, 9,  parent_path_slice(path).len);
+    expect(__LINE__, 10, filename_slice(path).off);
+    expect(__LINE__, 8,  filename_slice(path).len);
+    expect(__LINE__, 14, extension_slice(path).off);
+    expect(__LINE__, 4,  extension_slice(path).len);
+    expect(__LINE__, -1, extension_slice("dir.name/foo").off);
+    expect(__LINE__, 0,  extension_slice("foo.").len);
+    expect(__LINE__, 0,  parent_path_slice("www").len);
+    // clang-format on
+}
+
 static void test_extension() {
     // clang-format off
     expect_str(__LINE__, "ext", extension("dir/foo.ext"));
@@ -161,7 +523,11 @@ static void test_extension() {
 
 void run_all_test_file() {
     test_new_File();
+    test_File_open();
+    test_FileCache();
+    test_path_join();
     test_parent_path();
     test_filename();
     test_extension();
+    test_slice();
 }
@@ -3,6 +3,15 @@
  */
 #pragma once
 
+#include <stddef.h>    // size_t
+#include <sys/types.h> // ino_t, off_t
+#include <time.h>      // time_t
+
+// clang-format off
+#define FILE_CACHE_SIZE 1024 ///< capacity of FileCache in entries
+#define FILE_CACHE_TTL  1    ///< seconds a FileEntry is fresh for
+// clang-format on
+
 /// file type
 typedef enum {
     F_DIR,   ///< directory
@@ -13,11 +22,76 @@ typedef enum {
 typedef struct {
     FileType ty;
     char *path;
-    int len;
+    off_t len;
+    time_t mtime; ///< time of last modification
+    ino_t ino;    ///< inode number
+
+    // validators of the file
+    char etag[3 * 16 + 4 + 1];  ///< "ino-len-mtime" in hex
+    char last_modified[29 + 1]; ///< IMF-fixdate of mtime
 } File;
 
 File *new_File(const char *path);
 void delete_File(File *file);
+int File_open(File *file);
+
+typedef struct FileEntry FileEntry;
+
+/** @struct FileEntry
+ * a path resolved in the file system, found or not.
+ */
+struct FileEntry {
+    char *path;
+    File *file;     ///< the file, or NULL if the path is not found
+    time_t expires; ///< the entry is stale from this time
+
+    FileEntry *_next;     // for internal: next entry in the same bucket
+    FileEntry *_lru_prev; // for internal: more recently used entry
+    FileEntry *_lru_next; // for internal: less recently used entry
+};
+
+/** @struct FileCache
+ * @brief A bounded cache of files resolved by path, so that a path is looked
+ * up with stat(2) once in a while, instead of on every request. Paths not
+ * found are cached too. The least recently used entries are evicted first.
+ *
+ * \li new_FileCache()
+ * \li delete_FileCache()
+ * \li FileCache_get()
+ * \li FileCache_put()
+ * \li FileCache_remove()
+ */
+typedef struct {
+    int capacity; ///< upper bound of the number of entries
+    int len;      ///< the number of entries
+    int ttl;      ///< seconds an entry is fresh for
+    long hits;
+    long misses;
+
+    FileEntry **_buckets;
+    int _nbuckets; // a power of 2
+    FileEntry *_lru_head;
+    FileEntry *_lru_tail;
+} FileCache;
+
+FileCache *new_FileCache(int capacity, int ttl);
+void delete_FileCache(FileCache *);
+FileEntry *FileCache_get(FileCache *, const char *path, time_t now);
+FileEntry *FileCache_put(FileCache *, const char *path, File *file,
+                         time_t now);
+void FileCache_remove(FileCache *, const char *path);
+
+/// a component of a path, by the offset and the length in the path
+typedef struct {
+    int off;
+    int len;
+} PathSlice;
+
+int path_join(char *buf, size_t size, const char *parent, const char *child);
+
+PathSlice parent_path_slice(const char *path);
+PathSlice filename_slice(const char *path);
+PathSlice extension_slice(const char *path);
 
 char *parent_path(const char *path);
 char *filename(const char *path);
@@ -0,0 +1,184 @@
+#include "histogram.h"
+#include "util.h"
+
+#include <stdlib.h> // calloc(3)
+
+/**
+ * Returns the index of the bucket of the value.
+ *
+ * @return 0 to HIST_BUCKETS - 1
+ * @param value
+ */
+int histogram_index(uint64_t value) {
+    if (value < HIST_SUB_BUCKETS)
+        return value;
+
+    int msb = 63 - __builtin_clzll(value);
+    if (msb >= HIST_MAX_BITS)
+        return HIST_BUCKETS - 1;
+
+    int shift = msb - HIST_SUB_BITS;
+    int sub = (value >> shift) & (HIST_SUB_BUCKETS - 1);
+    return HIST_SUB_BUCKETS + shift * HIST_SUB_BUCKETS + sub;
+}
+
+/**
+ * Returns the lowest value counted in the bucket.
+ *
+ * @param index
+ */
+uint64_t histogram_lowest(int index) {
+    if (index < HIST_SUB_BUCKETS)
+        return index;
+
+    int shift = (index - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS;
+    int sub = (index - HIST_SUB_BUCKETS) % HIST_SUB_BUCKETS;
+    return (uint64_t)(HIST_SUB_BUCKETS + sub) << shift;
+}
+
+/**
+ * Returns the highest value counted in the bucket, not counting the values
+ * beyond HIST_MAX_BITS in the last bucket.
+ *
+ * @param index
+ */
+uint64_t histogram_highest(int index) {
+    if (index < HIST_SUB_BUCKETS)
+        return index;
+
+    int shift = (index - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS;
+    return histogram_lowest(index) + ((uint64_t)1 << shift) - 1;
+}
+
+/**
+ * Counts the value.
+ *
+ * @param h
+ * @param value
+ */
+void Histogram_record(Histogram *h, uint64_t value) {
+    h->counts[histogram_index(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+}
+
+/**
+ * Adds the counts of src to dest.
+ *
+ * @param dest
+ * @param src
+ */
+void Histogram_merge(Histogram *dest, const Histogram *src) {
+    if (src->count == 0)
+        return;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        dest->counts[i] += src->counts[i];
+    dest->count += src->count;
+    dest->sum += src->sum;
+    if (src->max > dest->max)
+        dest->max = src->max;
+}
+
+/**
+ * Returns the value at the percentile.
+ *
+ * @return the highest value of the bucket of the percentile, but not greater
+ * than the max, 0 if empty
+ * @param h
+ * @param percentile 0.0 to 100.0
+ */
+uint64_t Histogram_percentile(const Histogram *h, double percentile) {
+    if (h->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = histogram_highest(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * Returns the mean of values.
+ *
+ * @return the mean, 0 if empty
+ * @param h
+ */
+uint64_t Histogram_mean(const Histogram *h) {
+    return h->count > 0 ? h->sum / h->count : 0;
+}
+
+static void test_histogram_index() {
+    // exact
+    for (int v = 0; v < HIST_SUB_BUCKETS * 2; v++) {
+        expect(__LINE__, v, histogram_index(v));
+        expect(__LINE__, v, histogram_lowest(v));
+        expect(__LINE__, v, histogram_highest(v));
+    }
+
+    // buckets are contiguous and the relative width is bounded
+    for (int i = 1; i < HIST_BUCKETS; i++) {
+        expect_bool(__LINE__, true,
+                    histogram_lowest(i) == histogram_highest(i - 1) + 1);
+        expect(__LINE__, i, histogram_index(histogram_lowest(i)));
+        expect(__LINE__, i, histogram_index(histogram_highest(i)));
+        uint64_t width = histogram_highest(i) - histogram_lowest(i) + 1;
+        expect_bool(__LINE__, true,
+                    width * HIST_SUB_BUCKETS <= histogram_lowest(i) ||
+                        width == 1);
+    }
+
+    // overflow
+    expect(__LINE__, HIST_BUCKETS - 1, histogram_index(UINT64_MAX));
+    expect(__LINE__, HIST_BUCKETS - 1,
+           histogram_index((uint64_t)1 << HIST_MAX_BITS));
+    expect(__LINE__, HIST_BUCKETS - 1,
+           histogram_index(((uint64_t)1 << HIST_MAX_BITS) - 1));
+}
+
+static void test_Histogram() {
+    Histogram *h = calloc(1, sizeof(Histogram));
+    Histogram *h2 = calloc(1, sizeof(Histogram));
+
+    expect(__LINE__, 0, Histogram_percentile(h, 50));
+    expect(__LINE__, 0, Histogram_mean(h));
+
+    // 1..1000
+    for (int v = 1; v <= 1000; v++)
+        Histogram_record(h, v);
+    expect(__LINE__, 1000, h->count);
+    expect(__LINE__, 1000, h->max);
+    expect(__LINE__, 500, Histogram_mean(h));
+    expect(__LINE__, 1, Histogram_percentile(h, 0));
+    expect(__LINE__, 1000, Histogram_percentile(h, 100));
+
+    uint64_t p50 = Histogram_percentile(h, 50);
+    expect_bool(__LINE__, true, 500 <= p50 && p50 < 500 * 1.04);
+    uint64_t p99 = Histogram_percentile(h, 99);
+    expect_bool(__LINE__, true, 990 <= p99 && p99 < 990 * 1.04);
+
+    // a tail
+    Histogram_record(h2, 1000000000);
+    Histogram_merge(h, h2);
+    expect(__LINE__, 1001, h->count);
+    expect(__LINE__, 1000000000, Histogram_percentile(h, 100));
+    expect_bool(__LINE__, true, Histogram_percentile(h, 99.9) < 1000 * 1.04);
+
+    free(h);
+    free(h2);
+}
+
+void run_all_test_histogram() {
+    test_histogram_index();
+    test_Histogram();
+}
@@ -0,0 +1,52 @@
+/** @file
+ * provides log-linear histograms of non-negative integers, in the manner of
+ * HdrHistogram.
+ *
+ * A value is counted in a bucket whose width is 1/HIST_SUB_BUCKETS of its
+ * power of two, so the relative error of percentiles is less than
+ * 1/HIST_SUB_BUCKETS whatever the magnitude. Values less than
+ * HIST_SUB_BUCKETS are exact, values of HIST_MAX_BITS bits or more are
+ * counted in the last bucket.
+ */
+#pragma once
+
+#include <stdint.h> // uint64_t
+
+// clang-format off
+#define HIST_SUB_BITS    5                    ///< log2 of HIST_SUB_BUCKETS
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS) ///< buckets per power of two
+#define HIST_MAX_BITS    44                   ///< 2^44 ns is about 4.9 hours
+#define HIST_BUCKETS                                                           \
+    (HIST_SUB_BUCKETS * (HIST_MAX_BITS - HIST_SUB_BITS + 1))
+// clang-format on
+
+/** @struct Histogram
+ * @brief A histogram of fixed size, which needs no allocation and can be
+ * placed in shared memory.
+ *
+ * It is updated with plain increments by a single writer. A reader in
+ * another process may see a record half done, which is off by one count.
+ *
+ * \li Histogram_record()
+ * \li Histogram_merge()
+ * \li Histogram_percentile() returns the highest value equivalent to the
+ * percentile.
+ * \li Histogram_mean()
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t counts[HIST_BUCKETS];
+} Histogram;
+
+int histogram_index(uint64_t value);
+uint64_t histogram_lowest(int index);
+uint64_t histogram_highest(int index);
+
+void Histogram_record(Histogram *, uint64_t value);
+void Histogram_merge(Histogram *dest, const Histogram *src);
+uint64_t Histogram_percentile(const Histogram *, double percentile);
+uint64_t Histogram_mean(const Histogram *);
+
+void run_all_test_histogram();
@@ -0,0 +1,1164 @@
+#include "log.h"
+#include "util.h"
+
+#include <arpa/inet.h> // inet_pton(3)
+#include <ctype.h>     // isdigit(3)
+#include <errno.h>     // EINTR
+#include <fcntl.h>     // open(2)
+#include <stdio.h>     // fopen(3)
+#include <stdlib.h>    // malloc(3)
+#include <string.h>    // strdup(3)
+#include <sys/stat.h>  // fstat(2)
+#include <unistd.h>    // write(2)
+
+//
+// LogFormat
+//
+
+static const struct {
+    const char *name;
+    LogOpType ty;
+} Variables[] = {
+    {"remote_addr", LF_REMOTE_ADDR},
+    {"time_local", LF_TIME_LOCAL},
+    {"request", LF_REQUEST},
+    {"status", LF_STATUS},
+    {"body_bytes_sent", LF_BODY_BYTES_SENT},
+    {"http_referer", LF_HTTP_REFERER},
+    {"http_user_agent", LF_HTTP_USER_AGENT},
+    {"request_time", LF_REQUEST_TIME},
+    {"upstream_response_time", LF_UPSTREAM_RESPONSE_TIME},
+    {"parse_time", LF_PARSE_TIME},
+    {"build_time", LF_BUILD_TIME},
+    {"first_byte_time", LF_FIRST_BYTE_TIME},
+    {"send_time", LF_SEND_TIME},
+};
+
+static bool is_name_char(char c) {
+    return ('a' <= c && c <= 'z') || c == '_';
+}
+
+/**
+ * Compiles the format into operations. A variable is '$' followed by its
+ * name, and the other characters are copied as is.
+ *
+ * @return a pointer to a new LogFormat object
+ * @param fmt the format, or "combined" or "common"
+ * @param ex a pointer to Exception, O_IllegalArgument if the format has an
+ * unknown variable
+ */
+LogFormat *LogFormat_compile(const char *fmt, Exception *ex) {
+    if (strcmp(fmt, "combined") == 0)
+        fmt = LOG_FORMAT_COMBINED;
+    else if (strcmp(fmt, "common") == 0)
+        fmt = LOG_FORMAT_COMMON;
+
+    LogFormat *format = calloc(1, sizeof(LogFormat));
+    format->_src = strdup(fmt);
+    format->ops = calloc(strlen(fmt) + 1, sizeof(LogOp)); // enough
+
+    const char *p = format->_src;
+    while (*p) {
+        LogOp *op = &format->ops[format->nops++];
+
+        if (*p != '$' || !is_name_char(p[1])) {
+            op->ty = LF_LITERAL;
+            op->str = p;
+            for (p++; *p && !(*p == '$' && is_name_char(p[1])); p++)
+                ;
+            op->len = p - op->str;
+            continue;
+        }
+
+        const char *name = ++p;
+        while (is_name_char(*p))
+            p++;
+
+        int i;
+        for (i = 0; i < sizeof(Variables) / sizeof(*Variables); i++) {
+            if (strlen(Variables[i].name) == p - name &&
+                strncmp(Variables[i].name, name, p - name) == 0)
+                break;
+        }
+        if (i == sizeof(Variables) / sizeof(*Variables)) {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown variable in log format";
+            return format;
+        }
+        op->ty = Variables[i].ty;
+    }
+
+    return format;
+}
+
+/**
+ * Destroys the LogFormat object.
+ *
+ * @param format
+ */
+void delete_LogFormat(LogFormat *format) {
+    free(format->ops);
+    free(format->_src);
+    free(format);
+}
+
+static char *put(char *dest, char *end, const char *src, int len) {
+    if (dest == NULL || end - dest < len)
+        return NULL;
+    memcpy(dest, src, len);
+    return dest + len;
+}
+
+static char *put_str(char *dest, char *end, const char *str) {
+    return put(dest, end, str, str != NULL ? strlen(str) : 0);
+}
+
+/**
+ * puts the duration in seconds with the digits of fraction, e.g. "0.012" with
+ * 3 digits.
+ */
+static char *put_seconds(char *dest, char *end, uint64_t ns, int digits) {
+    char buf[32];
+    char *p = buf + sizeof(buf);
+    uint64_t n = ns;
+
+    for (int i = digits; i < 9; i++)
+        n /= 10;
+    for (int i = 0; i < digits; i++, n /= 10)
+        *--p = '0' + n % 10;
+    *--p = '.';
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+
+    return put(dest, end, p, buf + sizeof(buf) - p);
+}
+
+/// puts the duration between the phases in microseconds, or "-" if unknown
+static char *put_phase(char *dest, char *end, uint64_t from, uint64_t to) {
+    if (from == 0 || to < from)
+        return put(dest, end, "-", 1);
+    return put_seconds(dest, end, to - from, 6);
+}
+
+/**
+ * Renders the line into dest by running the operations.
+ *
+ * @return the end of the line, or NULL if the line does not fit in
+ */
+static char *render(LogFormat *format, LogEntry *e, char *dest, char *end) {
+    for (int i = 0; i < format->nops; i++) {
+        LogOp *op = &format->ops[i];
+        switch (op->ty) {
+        case LF_LITERAL:
+            dest = put(dest, end, op->str, op->len);
+            break;
+        case LF_REMOTE_ADDR:
+            dest = put_str(dest, end, e->remote_addr);
+            break;
+        case LF_TIME_LOCAL:
+            dest = put_str(dest, end, e->time_local);
+            break;
+        case LF_REQUEST:
+            dest = put_str(dest, end, e->request);
+            break;
+        case LF_STATUS:
+            dest = put_str(dest, end, e->status);
+            break;
+        case LF_BODY_BYTES_SENT:
+            dest = put_str(dest, end, e->body_bytes_sent);
+            break;
+        case LF_HTTP_REFERER:
+            dest = put_str(dest, end, e->http_referer);
+            break;
+        case LF_HTTP_USER_AGENT:
+            dest = put_str(dest, end, e->http_user_agent);
+            break;
+        case LF_REQUEST_TIME:
+            dest = put_seconds(dest, end, e->request_time, 3);
+            break;
+        case LF_UPSTREAM_RESPONSE_TIME: // no upstream
+            dest = put(dest, end, "-", 1);
+            break;
+        case LF_PARSE_TIME:
+            dest = put_phase(dest, end, e->phases.received, e->phases.parsed);
+            break;
+        case LF_BUILD_TIME:
+            dest = put_phase(dest, end, e->phases.parsed, e->phases.built);
+            break;
+        case LF_FIRST_BYTE_TIME:
+            dest = put_phase(dest, end, e->phases.received,
+                             e->phases.first_sent);
+            break;
+        case LF_SEND_TIME:
+            dest =
+                put_phase(dest, end, e->phases.first_sent, e->phases.last_sent);
+            break;
+        }
+    }
+    return put(dest, end, "\n", 1);
+}
+
+/**
+ * Renders the line into buf.
+ *
+ * @return the length of the line, or -1 if the line does not fit in
+ * @param format
+ * @param e the values of fields
+ * @param buf
+ * @param size the size of buf
+ */
+int LogFormat_render(LogFormat *format, LogEntry *e, char *buf, int size) {
+    char *p = render(format, e, buf, buf + size);
+    return p != NULL ? p - buf : -1;
+}
+
+//
+// binary records
+//
+
+#define LOG_RECORD_VERSION 1
+#define LOG_HEADER_SIZE    (3 + 13)
+#define LOG_REQUEST_SIZE   (3 + 40)
+#define LOG_STRING_SIZE    (3 + 6 + LOG_STR_MAX)
+
+/// strings sent by a worker, an open addressing hash table
+struct LogDict {
+    pid_t pid;
+    int len;
+    struct {
+        char *str;
+        uint16_t id;
+    } slots[LOG_DICT_SIZE * 2];
+};
+
+static char *put_u16(char *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static char *put_u32(char *p, uint32_t v) {
+    p = put_u16(p, v);
+    return put_u16(p, v >> 16);
+}
+
+static char *put_u64(char *p, uint64_t v) {
+    p = put_u32(p, v);
+    return put_u32(p, v >> 32);
+}
+
+static uint16_t get_u16(const unsigned char *p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+/// puts the length and the type, the length is filled by end_record()
+static char *begin_record(char *p, LogRecordType ty) {
+    p[2] = ty;
+    return p + 3;
+}
+
+static char *end_record(char *rec, char *end) {
+    put_u16(rec, end - rec - 2);
+    return end;
+}
+
+/**
+ * Clears the dictionary and puts a LR_HEADER record which tells readers to
+ * do so.
+ */
+static char *reset_dict(LogDict *dict, char *p) {
+    for (int i = 0; i < LOG_DICT_SIZE * 2; i++) {
+        free(dict->slots[i].str);
+        dict->slots[i].str = NULL;
+    }
+    dict->len = 0;
+    dict->pid = getpid();
+
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    char *q = begin_record(p, LR_HEADER);
+    memcpy(q, "DLOG", 4);
+    q += 4;
+    *q++ = LOG_RECORD_VERSION;
+    q = put_u32(q, dict->pid);
+    q = put_u32(q, (int32_t)tm.tm_gmtoff);
+    return end_record(p, q);
+}
+
+/**
+ * Looks up the id of the string, adding a LR_STRING record if it is new.
+ *
+ * @return the end of the records put
+ */
+static char *intern(LogDict *dict, const char *str, uint16_t *id, char *p) {
+    if (str == NULL)
+        str = "";
+    int len = strnlen(str, LOG_STR_MAX);
+
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++)
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+
+    int i = h % (LOG_DICT_SIZE * 2);
+    for (; dict->slots[i].str != NULL; i = (i + 1) % (LOG_DICT_SIZE * 2)) {
+        if (strlen(dict->slots[i].str) == len &&
+            memcmp(dict->slots[i].str, str, len) == 0) {
+            *id = dict->slots[i].id;
+            return p;
+        }
+    }
+    dict->slots[i].str = strndup(str, len);
+    dict->slots[i].id = *id = dict->len++;
+
+    char *q = begin_record(p, LR_STRING);
+    q = put_u32(q, dict->pid);
+    q = put_u16(q, *id);
+    memcpy(q, str, len);
+    return end_record(p, q + len);
+}
+
+/**
+ * Puts the records of the request.
+ *
+ * @return the end of the records
+ * @param dict
+ * @param e
+ * @param p enough space, see LOG_ENTRY_SIZE_MAX
+ */
+static char *encode(LogDict *dict, LogEntry *e, char *p) {
+    if (dict->pid != getpid() || dict->len + 3 > LOG_DICT_SIZE)
+        p = reset_dict(dict, p);
+
+    uint16_t request, referer, user_agent;
+    p = intern(dict, e->request, &request, p);
+    p = intern(dict, e->http_referer, &referer, p);
+    p = intern(dict, e->http_user_agent, &user_agent, p);
+
+    char addr[4] = {0};
+    if (e->remote_addr != NULL)
+        inet_pton(AF_INET, e->remote_addr, addr);
+
+    int64_t bytes = -1;
+    if (e->body_bytes_sent != NULL && '0' <= e->body_bytes_sent[0] &&
+        e->body_bytes_sent[0] <= '9')
+        bytes = strtoll(e->body_bytes_sent, NULL, 10);
+
+    char *q = begin_record(p, LR_REQUEST);
+    q = put_u32(q, dict->pid);
+    q = put_u64(q, e->time);
+    q = put_u64(q, e->request_time);
+    memcpy(q, addr, 4);
+    q += 4;
+    q = put_u16(q, e->status != NULL ? atoi(e->status) : 0);
+    q = put_u64(q, bytes);
+    q = put_u16(q, request);
+    q = put_u16(q, referer);
+    q = put_u16(q, user_agent);
+    return end_record(p, q);
+}
+
+/// the largest size of records of a request
+#define LOG_ENTRY_SIZE_MAX                                                     \
+    (LOG_HEADER_SIZE + 3 * LOG_STRING_SIZE + LOG_REQUEST_SIZE)
+
+static LogDict *new_LogDict() {
+    LogDict *dict = calloc(1, sizeof(LogDict));
+    dict->pid = -1;
+    return dict;
+}
+
+static void delete_LogDict(LogDict *dict) {
+    for (int i = 0; i < LOG_DICT_SIZE * 2; i++)
+        free(dict->slots[i].str);
+    free(dict);
+}
+
+static const char *const Months[] = {"Jan", "Feb", "Mar", "Apr",
+                                     "May", "Jun", "Jul", "Aug",
+                                     "Sep", "Oct", "Nov", "Dec"};
+
+/**
+ * Parses $time_local, e.g. "15/Oct/2020:13:58:36 +0900".
+ *
+ * @return true if parsed
+ */
+static bool parse_time_local(const char *str, time_t *t) {
+    struct tm tm = {0};
+    char mon[4], sign;
+    int off;
+
+    if (sscanf(str, "%2d/%3s/%4d:%2d:%2d:%2d %c%4d", &tm.tm_mday, mon,
+               &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &sign,
+               &off) != 8 ||
+        (sign != '+' && sign != '-'))
+        return false;
+    for (tm.tm_mon = 0; tm.tm_mon < 12; tm.tm_mon++)
+        if (strcmp(mon, Months[tm.tm_mon]) == 0)
+            break;
+    if (tm.tm_mon == 12)
+        return false;
+    tm.tm_year -= 1900;
+
+    off = (off / 100 * 60 + off % 100) * 60;
+    *t = timegm(&tm) - (sign == '-' ? -off : off);
+    return true;
+}
+
+/// the status and a space follow the request
+static bool is_status(const char *p) {
+    return isdigit(p[0]) && isdigit(p[1]) && isdigit(p[2]) && p[3] == ' ';
+}
+
+/**
+ * Parses a line of LOG_FORMAT_COMBINED or LOG_FORMAT_COMMON. The line is
+ * modified, and the strings of the entry point to it. $request ends at the
+ * last '"' before the status, as it is written without escapes. The fields
+ * absent from the common format are "-".
+ *
+ * @return true if parsed, false if malformed
+ * @param e the values of fields of the line
+ * @param line
+ */
+bool LogEntry_parse(LogEntry *e, char *line) {
+    char *p, *q;
+
+    *e = (LogEntry){0};
+    line[strcspn(line, "\r\n")] = '\0';
+
+    // $remote_addr - - [$time_local]
+    if ((p = strchr(line, ' ')) == NULL)
+        return false;
+    *p++ = '\0';
+    e->remote_addr = line;
+    if ((p = strchr(p, '[')) == NULL || (q = strchr(p, ']')) == NULL)
+        return false;
+    *q = '\0';
+    e->time_local = p + 1;
+    if (!parse_time_local(e->time_local, &e->time))
+        return false;
+
+    // "$request" $status
+    if (strncmp(q + 1, " \"", 2) != 0)
+        return false;
+    p = q + 3;
+    for (q = strstr(p, "\" "); q != NULL && !is_status(q + 2);
+         q = strstr(q + 1, "\" "))
+        ;
+    if (q == NULL)
+        return false;
+    *q = '\0';
+    e->request = p;
+    p = q + 2;
+    p[3] = '\0';
+    e->status = p;
+
+    // $body_bytes_sent, which is "\"-\"" if unknown
+    p += 4;
+    q = p + strcspn(p, " ");
+    bool combined = *q != '\0';
+    *q = '\0';
+    e->body_bytes_sent = isdigit(*p) ? p : "-";
+    if (!combined) {
+        e->http_referer = e->http_user_agent = "-";
+        return true;
+    }
+
+    // "$http_referer" "$http_user_agent"
+    p = q + 1;
+    if (*p != '"' || (q = strstr(p + 1, "\" \"")) == NULL)
+        return false;
+    *q = '\0';
+    e->http_referer = p + 1;
+    p = q + 3;
+    if ((q = strrchr(p, '"')) == NULL)
+        return false;
+    *q = '\0';
+    e->http_user_agent = p;
+    return true;
+}
+
+/// a dictionary of a worker on reading
+typedef struct {
+    uint32_t pid;
+    int32_t gmtoff;
+    char *strs[LOG_DICT_SIZE];
+} ReaderDict;
+
+/**
+ * Creates a new LogReader object.
+ *
+ * @return a pointer to a new LogReader object
+ * @param in a log, in binary or text
+ */
+LogReader *new_LogReader(FILE *in) {
+    LogReader *reader = calloc(1, sizeof(LogReader));
+    reader->in = in;
+    reader->_dicts = new_Vector();
+    return reader;
+}
+
+static void clear_ReaderDict(ReaderDict *dict) {
+    for (int i = 0; i < LOG_DICT_SIZE; i++) {
+        free(dict->strs[i]);
+        dict->strs[i] = NULL;
+    }
+}
+
+/**
+ * Destroys the LogReader object. The stream is not closed.
+ *
+ * @param reader
+ */
+void delete_LogReader(LogReader *reader) {
+    for (int i = 0; i < reader->_dicts->len; i++)
+        clear_ReaderDict(reader->_dicts->data[i]);
+    delete_Vector(reader->_dicts);
+    free(reader);
+}
+
+static ReaderDict *find_dict(LogReader *reader, uint32_t pid) {
+    for (int i = 0; i < reader->_dicts->len; i++) {
+        ReaderDict *dict = reader->_dicts->data[i];
+        if (dict->pid == pid)
+            return dict;
+    }
+    return NULL;
+}
+
+static const char *lookup(ReaderDict *dict, uint16_t id) {
+    if (id >= LOG_DICT_SIZE || dict->strs[id] == NULL)
+        return "-";
+    return dict->strs[id];
+}
+
+/// reads lines up to the next well-formed line
+static bool next_line(LogReader *reader, LogEntry *e, Exception *ex) {
+    char *line = (char *)reader->_rec;
+
+    while (fgets(line, sizeof(reader->_rec), reader->in) != NULL) {
+        if (strchr(line, '\n') == NULL && !feof(reader->in)) {
+            // too long, skips the rest
+            int c;
+            while ((c = getc(reader->in)) != EOF && c != '\n')
+                ;
+            reader->skipped++;
+            continue;
+        }
+        if (line[strspn(line, " \t\r\n")] == '\0') // blank
+            continue;
+        if (LogEntry_parse(e, line))
+            return true;
+        reader->skipped++;
+    }
+
+    if (ferror(reader->in)) {
+        ex->ty = E_Failure;
+        ex->msg = "fread";
+    }
+    return false;
+}
+
+/**
+ * Reads the next request: records up to the next LR_REQUEST record of a
+ * binary log, or the next line.
+ *
+ * @return true if a request is read, false on the end of the log or an error
+ * @param reader
+ * @param e the values of fields of the request
+ * @param ex a pointer to Exception, E_Failure if the log is broken
+ */
+bool LogReader_next(LogReader *reader, LogEntry *e, Exception *ex) {
+    unsigned char *rec = reader->_rec;
+    unsigned char head[2];
+
+    if (!reader->_detected) {
+        int c = getc(reader->in);
+        if (c != EOF)
+            ungetc(c, reader->in);
+        reader->text = c != EOF && (c >= ' ' || c == '\n');
+        reader->_detected = true;
+    }
+    if (reader->text)
+        return next_line(reader, e, ex);
+
+    while (fread(head, 1, 2, reader->in) == 2) {
+        uint16_t len = get_u16(head);
+        if (len == 0 || fread(rec, 1, len, reader->in) != len) {
+            ex->ty = E_Failure;
+            ex->msg = "truncated record";
+            return false;
+        }
+        if (len < 5) // type and pid
+            continue;
+
+        uint32_t pid = get_u32(rec + 1);
+        ReaderDict *dict = find_dict(reader, pid);
+
+        switch (rec[0]) {
+        case LR_HEADER:
+            if (len < 14 || memcmp(rec + 1, "DLOG", 4) != 0) {
+                ex->ty = E_Failure;
+                ex->msg = "bad header";
+                return false;
+            }
+            pid = get_u32(rec + 6);
+            dict = find_dict(reader, pid);
+            if (dict == NULL) {
+                dict = calloc(1, sizeof(ReaderDict));
+                dict->pid = pid;
+                Vector_push(reader->_dicts, dict);
+            }
+            clear_ReaderDict(dict);
+            dict->gmtoff = (int32_t)get_u32(rec + 10);
+            break;
+        case LR_STRING:
+            if (dict == NULL || len < 7 || get_u16(rec + 5) >= LOG_DICT_SIZE)
+                break;
+            uint16_t id = get_u16(rec + 5);
+            free(dict->strs[id]);
+            dict->strs[id] = strndup((char *)rec + 7, len - 7);
+            break;
+        case LR_REQUEST:
+            if (dict == NULL || len < 41)
+                break;
+            e->time = (time_t)get_u64(rec + 5);
+            e->request_time = get_u64(rec + 13);
+            inet_ntop(AF_INET, rec + 21, reader->_remote_addr,
+                      sizeof(reader->_remote_addr));
+            e->remote_addr = reader->_remote_addr;
+
+            time_t t = e->time + dict->gmtoff;
+            struct tm tm;
+            gmtime_r(&t, &tm);
+            int n = strftime(reader->_time_local, sizeof(reader->_time_local),
+                             "%d/%b/%Y:%H:%M:%S", &tm);
+            int off = dict->gmtoff / 60;
+            snprintf(reader->_time_local + n, sizeof(reader->_time_local) - n,
+                     " %c%02d%02d", off < 0 ? '-' : '+', abs(off) / 60,
+                     abs(off) % 60);
+            e->time_local = reader->_time_local;
+
+            snprintf(reader->_status, sizeof(reader->_status), "%u",
+                     get_u16(rec + 25));
+            e->status = reader->_status;
+
+            int64_t bytes = (int64_t)get_u64(rec + 27);
+            if (bytes < 0)
+                strcpy(reader->_body_bytes, "-");
+            else
+                snprintf(reader->_body_bytes, sizeof(reader->_body_bytes),
+                         "%jd", (intmax_t)bytes);
+            e->body_bytes_sent = reader->_body_bytes;
+
+            e->request = lookup(dict, get_u16(rec + 35));
+            e->http_referer = lookup(dict, get_u16(rec + 37));
+            e->http_user_agent = lookup(dict, get_u16(rec + 39));
+            return true;
+        default: // unknown records are skipped
+            break;
+        }
+    }
+
+    if (ferror(reader->in)) {
+        ex->ty = E_Failure;
+        ex->msg = "fread";
+    } else if (!feof(reader->in)) {
+        ex->ty = E_Failure;
+        ex->msg = "truncated record";
+    }
+    return false;
+}
+
+//
+// AccessLog
+//
+
+/**
+ * Creates a new AccessLog object. The file is created if it does not exist.
+ *
+ * @return a pointer to a new AccessLog object
+ * @param path the path to the log file
+ * @param ex a pointer to Exception
+ */
+AccessLog *new_AccessLog(const char *path, Exception *ex) {
+    AccessLog *log = calloc(1, sizeof(AccessLog));
+
+    log->path = strdup(path);
+    log->format = LogFormat_compile(LOG_FORMAT_COMBINED, ex);
+    log->_dict = new_LogDict();
+    log->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (log->fd == -1) {
+        ex->ty = E_Failure;
+        ex->msg = "open";
+        return log;
+    }
+    log->flushed_at = time(NULL);
+
+    return log;
+}
+
+/**
+ * Flushes the buffer and destroys the AccessLog object.
+ *
+ * @param log
+ */
+void delete_AccessLog(AccessLog *log) {
+    if (log->fd != -1) {
+        AccessLog_flush(log);
+        close(log->fd);
+    }
+    delete_LogFormat(log->format);
+    delete_LogDict(log->_dict);
+    free(log->path);
+    free(log);
+}
+
+static void write_all(int fd, const char *buf, int len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= n;
+    }
+}
+
+/**
+ * Appends the lines in the buffer to the file.
+ *
+ * @param log
+ */
+void AccessLog_flush(AccessLog *log) {
+    write_all(log->fd, log->buf, log->len);
+    log->len = 0;
+    log->flushed_at = time(NULL);
+}
+
+/**
+ * Flushes the buffer if LOG_FLUSH_INTERVAL has passed since the last flush.
+ *
+ * @param log
+ * @param now the current time
+ */
+void AccessLog_flushIfDue(AccessLog *log, time_t now) {
+    if (log->len > 0 && now - log->flushed_at >= LOG_FLUSH_INTERVAL)
+        AccessLog_flush(log);
+}
+
+/**
+ * Flushes the buffer to the current file, then opens the path again. The
+ * current file is kept if the path cannot be opened. A binary log starts a
+ * new dictionary in the new file.
+ *
+ * @param log
+ * @param ex a pointer to Exception, E_Failure if the path cannot be opened
+ */
+void AccessLog_reopen(AccessLog *log, Exception *ex) {
+    int fd = open(log->path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        ex->ty = E_Failure;
+        ex->msg = "open";
+        return;
+    }
+
+    AccessLog_flush(log);
+    close(log->fd);
+    log->fd = fd;
+    log->_dict->pid = -1;
+}
+
+/**
+ * Replaces the format of the log.
+ *
+ * @param log
+ * @param fmt the format, see LogFormat_compile(), or LOG_FORMAT_BINARY
+ * @param ex a pointer to Exception
+ */
+void AccessLog_setFormat(AccessLog *log, const char *fmt, Exception *ex) {
+    log->binary = strcmp(fmt, LOG_FORMAT_BINARY) == 0;
+    if (log->binary)
+        return;
+
+    LogFormat *format = LogFormat_compile(fmt, ex);
+    if (ex->ty != E_Okay) {
+        delete_LogFormat(format);
+        return;
+    }
+    delete_LogFormat(log->format);
+    log->format = format;
+}
+
+/**
+ * Renders a line into the buffer. The buffer is flushed first if the line
+ * does not fit in, and flushed after if it is due. A line longer than the
+ * buffer is truncated.
+ *
+ * @return the length of the line, or of the records in binary
+ * @param log
+ * @param e the values of fields
+ * @param now the current time
+ */
+int AccessLog_write(AccessLog *log, LogEntry *e, time_t now) {
+    if (log->binary) {
+        if (log->len + LOG_ENTRY_SIZE_MAX > sizeof(log->buf))
+            AccessLog_flush(log);
+        char *p = log->buf + log->len;
+        int len = encode(log->_dict, e, p) - p;
+        log->len += len;
+        AccessLog_flushIfDue(log, now);
+        return len;
+    }
+
+    char *end = log->buf + sizeof(log->buf);
+    char *p = render(log->format, e, log->buf + log->len, end);
+
+    if (p == NULL) {
+        AccessLog_flush(log);
+        p = render(log->format, e, log->buf, end);
+        if (p == NULL) {
+            p = end;
+            p[-1] = '\n';
+        }
+    }
+    int len = p - (log->buf + log->len);
+    log->len += len;
+
+    AccessLog_flushIfDue(log, now);
+
+    return len;
+}
+
+static off_t file_size(const char *path) {
+    struct stat st;
+    stat(path, &st);
+    return st.st_size;
+}
+
+static void test_LogFormat() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogFormat *format;
+    char buf[256];
+    LogEntry e = {
+        .remote_addr = "127.0.0.1",
+        .time_local = "15/Oct/2020:13:58:36 +0900",
+        .request = "GET / HTTP/1.1",
+        .status = "200",
+        .body_bytes_sent = "199",
+        .http_referer = "-",
+        .http_user_agent = "curl",
+        .request_time = 1234567890,
+    };
+
+    format = LogFormat_compile("$remote_addr [$time_local] $status", ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect(__LINE__, 5, format->nops);
+    expect(__LINE__, LF_REMOTE_ADDR, format->ops[0].ty);
+    expect(__LINE__, LF_LITERAL, format->ops[1].ty);
+    expect(__LINE__, 2, format->ops[1].len);
+    expect(__LINE__, LF_TIME_LOCAL, format->ops[2].ty);
+    expect(__LINE__, LF_LITERAL, format->ops[3].ty);
+    expect(__LINE__, LF_STATUS, format->ops[4].ty);
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__, "127.0.0.1 [15/Oct/2020:13:58:36 +0900] 200\n", buf);
+    delete_LogFormat(format);
+
+    format = LogFormat_compile("combined", ex);
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__,
+               "127.0.0.1 - - [15/Oct/2020:13:58:36 +0900] "
+               "\"GET / HTTP/1.1\" 200 199 \"-\" \"curl\"\n",
+               buf);
+    expect_ptr(__LINE__, NULL, render(format, &e, buf, buf + 10));
+    delete_LogFormat(format);
+
+    // durations, literal '$'
+    format = LogFormat_compile("$ $request_time $upstream_response_time$", ex);
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__, "$ 1.234 -$\n", buf);
+    e.request_time = 999999;
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__, "$ 0.000 -$\n", buf);
+    delete_LogFormat(format);
+
+    // phases
+    format = LogFormat_compile(
+        "$parse_time $build_time $first_byte_time $send_time", ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__, "- - - -\n", buf);
+    e.phases = (PhaseTimes){
+        .received = 1000000000,
+        .parsed = 1000012345,
+        .built = 1000020000,
+        .first_sent = 1000030000,
+        .last_sent = 3500030000,
+    };
+    *render(format, &e, buf, buf + sizeof(buf)) = '\0';
+    expect_str(__LINE__, "0.000012 0.000007 0.000030 2.500000\n", buf);
+    delete_LogFormat(format);
+
+    // unknown variable
+    format = LogFormat_compile("$remote_addr $foo", ex);
+    expect(__LINE__, O_IllegalArgument, ex->ty);
+    delete_LogFormat(format);
+
+    free(ex);
+}
+
+static void test_AccessLog() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    char path[] = "/tmp/dali_log_XXXXXX";
+    close(mkstemp(path));
+
+    AccessLog *log = new_AccessLog(path, ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    AccessLog_setFormat(log, "$status", ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    time_t now = log->flushed_at;
+    LogEntry e = {.status = "one"};
+
+    // buffered
+    expect(__LINE__, 4, AccessLog_write(log, &e, now));
+    e.status = "two";
+    expect(__LINE__, 4, AccessLog_write(log, &e, now));
+    expect(__LINE__, 8, log->len);
+    expect(__LINE__, 0, file_size(path));
+
+    // flushed by interval
+    AccessLog_flushIfDue(log, now + LOG_FLUSH_INTERVAL - 1);
+    expect(__LINE__, 0, file_size(path));
+    AccessLog_flushIfDue(log, now + LOG_FLUSH_INTERVAL);
+    expect(__LINE__, 8, file_size(path));
+    expect(__LINE__, 0, log->len);
+
+    // flushed by size, lines are not torn
+    now = log->flushed_at;
+    e.status = "000000000";
+    int n = 0;
+    while (log->len + 10 < LOG_BUF_SIZE)
+        n += AccessLog_write(log, &e, now);
+    expect(__LINE__, 8, file_size(path));
+    n += AccessLog_write(log, &e, now);
+    expect(__LINE__, 10, log->len);
+    expect(__LINE__, 8 + n - 10, file_size(path));
+    expect(__LINE__, 0, (file_size(path) - 8) % 10);
+
+    // flushed on close
+    delete_AccessLog(log);
+    expect(__LINE__, 8 + n, file_size(path));
+
+    FILE *f = fopen(path, "r");
+    char buf[16];
+    expect_str(__LINE__, "one\n", fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "two\n", fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "000000000\n", fgets(buf, sizeof(buf), f));
+    fclose(f);
+
+    // invalid format is not set
+    log = new_AccessLog(path, ex);
+    LogFormat *format = log->format;
+    AccessLog_setFormat(log, "$foo", ex);
+    expect(__LINE__, O_IllegalArgument, ex->ty);
+    expect_ptr(__LINE__, format, log->format);
+    delete_AccessLog(log);
+
+    // reopened after rotation, lines are not lost
+    ex->ty = E_Okay;
+    log = new_AccessLog(path, ex);
+    AccessLog_setFormat(log, "$status", ex);
+    e.status = "old";
+    AccessLog_write(log, &e, now);
+    char rotated[sizeof(path) + 2];
+    snprintf(rotated, sizeof(rotated), "%s.1", path);
+    rename(path, rotated);
+    AccessLog_reopen(log, ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect(__LINE__, 8 + n + 4, file_size(rotated));
+    expect(__LINE__, 0, file_size(path));
+    e.status = "new";
+    AccessLog_write(log, &e, now);
+    delete_AccessLog(log);
+    expect(__LINE__, 4, file_size(path));
+    unlink(rotated);
+
+    // error
+    log = new_AccessLog("/not_exist/access.log", ex);
+    expect(__LINE__, E_Failure, ex->ty);
+    delete_AccessLog(log);
+
+    unlink(path);
+    free(ex);
+}
+
+static void test_binary() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    char path[] = "/tmp/dali_log_XXXXXX";
+    close(mkstemp(path));
+    LogEntry e = {
+        .time = 1602737916,
+        .remote_addr = "192.168.0.1",
+        .time_local = "15/Oct/2020:13:58:36 +0900",
+        .request = "GET / HTTP/1.1",
+        .status = "200",
+        .body_bytes_sent = "199",
+        .http_referer = "-",
+        .http_user_agent = "curl",
+        .request_time = 1234567890,
+    };
+
+    AccessLog *log = new_AccessLog(path, ex);
+    AccessLog_setFormat(log, LOG_FORMAT_BINARY, ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect_bool(__LINE__, true, log->binary);
+
+    // header, strings and request
+    expect(__LINE__, LOG_HEADER_SIZE + 3 * 9 + 14 + 1 + 4 + LOG_REQUEST_SIZE,
+           AccessLog_write(log, &e, e.time));
+    // strings are sent once
+    expect(__LINE__, LOG_REQUEST_SIZE, AccessLog_write(log, &e, e.time));
+    e.body_bytes_sent = "\"-\"";
+    e.http_user_agent = "wget";
+    expect(__LINE__, 3 + 6 + 4 + LOG_REQUEST_SIZE,
+           AccessLog_write(log, &e, e.time));
+    // the new file starts with a new dictionary
+    char rotated[sizeof(path) + 2];
+    snprintf(rotated, sizeof(rotated), "%s.1", path);
+    rename(path, rotated);
+    AccessLog_reopen(log, ex);
+    expect(__LINE__, LOG_HEADER_SIZE + 3 * 9 + 14 + 1 + 4 + LOG_REQUEST_SIZE,
+           AccessLog_write(log, &e, e.time));
+    delete_AccessLog(log);
+    unlink(path);
+    rename(rotated, path);
+
+    FILE *f = fopen(path, "r");
+    LogReader *reader = new_LogReader(f);
+    LogEntry d;
+
+    expect_bool(__LINE__, true, LogReader_next(reader, &d, ex));
+    expect(__LINE__, 1602737916, d.time);
+    expect(__LINE__, 1234567890, d.request_time);
+    expect_str(__LINE__, "192.168.0.1", d.remote_addr);
+    expect_str(__LINE__, "GET / HTTP/1.1", d.request);
+    expect_str(__LINE__, "200", d.status);
+    expect_str(__LINE__, "199", d.body_bytes_sent);
+    expect_str(__LINE__, "-", d.http_referer);
+    expect_str(__LINE__, "curl", d.http_user_agent);
+
+    expect_bool(__LINE__, true, LogReader_next(reader, &d, ex));
+    expect_str(__LINE__, "curl", d.http_user_agent);
+    expect_bool(__LINE__, true, LogReader_next(reader, &d, ex));
+    expect_str(__LINE__, "-", d.body_bytes_sent);
+    expect_str(__LINE__, "wget", d.http_user_agent);
+    expect_bool(__LINE__, false, LogReader_next(reader, &d, ex));
+    expect(__LINE__, E_Okay, ex->ty);
+    delete_LogReader(reader);
+    fclose(f);
+
+    // a truncated record
+    truncate(path, file_size(path) - 1);
+    f = fopen(path, "r");
+    reader = new_LogReader(f);
+    expect_bool(__LINE__, true, LogReader_next(reader, &d, ex));
+    expect_bool(__LINE__, true, LogReader_next(reader, &d, ex));
+    expect_bool(__LINE__, false, LogReader_next(reader, &d, ex));
+    expect(__LINE__, E_Failure, ex->ty);
+    expect_bool(__LINE__, false, reader->text);
+    delete_LogReader(reader);
+    fclose(f);
+
+    unlink(path);
+    free(ex);
+}
+
+static void test_text() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogEntry e;
+    char line[512];
+
+    strcpy(line, "192.168.0.1 - - [15/Oct/2020:13:58:36 +0900] "
+                 "\"GET /a\"b HTTP/1.1\" 200 199 \"http://x/\" "
+                 "\"curl \"7\"\"\r\n");
+    expect_bool(__LINE__, true, LogEntry_parse(&e, line));
+    expect(__LINE__, 1602737916, e.time);
+    expect_str(__LINE__, "192.168.0.1", e.remote_addr);
+    expect_str(__LINE__, "15/Oct/2020:13:58:36 +0900", e.time_local);
+    expect_str(__LINE__, "GET /a\"b HTTP/1.1", e.request);
+    expect_str(__LINE__, "200", e.status);
+    expect_str(__LINE__, "199", e.body_bytes_sent);
+    expect_str(__LINE__, "http://x/", e.http_referer);
+    expect_str(__LINE__, "curl \"7\"", e.http_user_agent);
+
+    // common, "-" as body_bytes_sent
+    strcpy(line, "::1 - - [01/Jan/2021:00:00:00 -0130] \"HEAD / HTTP/1.1\" "
+                 "304 \"-\"");
+    expect_bool(__LINE__, true, LogEntry_parse(&e, line));
+    expect(__LINE__, 1609464600, e.time);
+    expect_str(__LINE__, "304", e.status);
+    expect_str(__LINE__, "-", e.body_bytes_sent);
+    expect_str(__LINE__, "-", e.http_referer);
+    expect_str(__LINE__, "-", e.http_user_agent);
+
+    // malformed
+    strcpy(line, "::1 - - [01/Foo/2021:00:00:00 +0000] \"GET /\" 200 1");
+    expect_bool(__LINE__, false, LogEntry_parse(&e, line));
+    strcpy(line, "::1 - - [01/Jan/2021:00:00:00 +0000] \"GET /\" 2000 1");
+    expect_bool(__LINE__, false, LogEntry_parse(&e, line));
+    strcpy(line, "::1 - - [01/Jan/2021:00:00:00 +0000] \"GET /\" 200 1 \"-");
+    expect_bool(__LINE__, false, LogEntry_parse(&e, line));
+
+    // lines rendered in the combined format are read back
+    LogFormat *format = LogFormat_compile(LOG_FORMAT_COMBINED, ex);
+    LogEntry w = {
+        .remote_addr = "127.0.0.1",
+        .time_local = "19/Oct/2026:05:58:46 +0000",
+        .request = "GET /index.html HTTP/1.1",
+        .status = "200",
+        .body_bytes_sent = "1024",
+        .http_referer = "-",
+        .http_user_agent = "dali-bench",
+    };
+    char buf[1024];
+    int len = LogFormat_render(format, &w, buf, sizeof(buf));
+    len += snprintf(buf + len, sizeof(buf) - len, "\nbroken\n\n");
+    len += LogFormat_render(format, &w, buf + len, sizeof(buf) - len);
+    delete_LogFormat(format);
+
+    FILE *f = fmemopen(buf, len, "r");
+    LogReader *reader = new_LogReader(f);
+    expect_bool(__LINE__, true, LogReader_next(reader, &e, ex));
+    expect_bool(__LINE__, true, reader->text);
+    expect(__LINE__, 1792389526, e.time);
+    expect_str(__LINE__, "GET /index.html HTTP/1.1", e.request);
+    expect_str(__LINE__, "dali-bench", e.http_user_agent);
+    expect_bool(__LINE__, true, LogReader_next(reader, &e, ex));
+    expect_str(__LINE__, "1024", e.body_bytes_sent);
+    expect_bool(__LINE__, false, LogReader_next(reader, &e, ex));
+    expect(__LINE__, E_Okay, ex->ty);
+    expect(__LINE__, 1, reader->skipped);
+    delete_LogReader(reader);
+    fclose(f);
+
+    free(ex);
+}
+
+void run_all_test_log() {
+    test_LogFormat();
+    test_AccessLog();
+    test_binary();
+    test_text();
+}
@@ -0,0 +1,198 @@
+/** @file
+ * provides access logs buffered per worker, in text or binary records.
+ */
+#pragma once
+
+#include "util.h"
+
+#include <stdint.h>    // uint64_t
+#include <stdio.h>     // FILE
+#include <sys/types.h> // pid_t
+#include <time.h>      // time_t
+
+// clang-format off
+#define LOG_BUF_SIZE       (64 * 1024) ///< size of the buffer of AccessLog
+#define LOG_FLUSH_INTERVAL 1           ///< seconds to keep lines in the buffer
+#define LOG_DICT_SIZE      1024        ///< strings per dictionary in binary
+#define LOG_STR_MAX        1024        ///< longer strings are cut in binary
+// clang-format on
+
+/// Combined Log Format
+#define LOG_FORMAT_COMBINED                                                    \
+    "$remote_addr - - [$time_local] \"$request\" $status $body_bytes_sent "    \
+    "\"$http_referer\" \"$http_user_agent\""
+
+/// Common Log Format
+#define LOG_FORMAT_COMMON                                                      \
+    "$remote_addr - - [$time_local] \"$request\" $status $body_bytes_sent"
+
+/// binary records instead of text lines, see LogRecordType
+#define LOG_FORMAT_BINARY "binary"
+
+/// an operation of LogFormat
+typedef enum {
+    LF_LITERAL,                ///< copies the literal
+    LF_REMOTE_ADDR,            ///< $remote_addr
+    LF_TIME_LOCAL,             ///< $time_local
+    LF_REQUEST,                ///< $request
+    LF_STATUS,                 ///< $status
+    LF_BODY_BYTES_SENT,        ///< $body_bytes_sent
+    LF_HTTP_REFERER,           ///< $http_referer
+    LF_HTTP_USER_AGENT,        ///< $http_user_agent
+    LF_REQUEST_TIME,           ///< $request_time
+    LF_UPSTREAM_RESPONSE_TIME, ///< $upstream_response_time
+    LF_PARSE_TIME,             ///< $parse_time
+    LF_BUILD_TIME,             ///< $build_time
+    LF_FIRST_BYTE_TIME,        ///< $first_byte_time
+    LF_SEND_TIME,              ///< $send_time
+} LogOpType;
+
+typedef struct {
+    LogOpType ty;
+    const char *str; ///< literal, for LF_LITERAL
+    int len;         ///< length of the literal
+} LogOp;
+
+/** @struct LogFormat
+ * @brief A format of log lines compiled into operations, in the manner of
+ * log_format of nginx.
+ *
+ * e.g. "$remote_addr [$time_local] $request_time" is compiled into
+ * LF_REMOTE_ADDR, LF_LITERAL(" ["), LF_TIME_LOCAL, LF_LITERAL("] "),
+ * LF_REQUEST_TIME.
+ *
+ * \li LogFormat_compile()
+ * \li delete_LogFormat()
+ */
+typedef struct {
+    LogOp *ops;
+    int nops;
+    char *_src; // for internal: the format which literals point to
+} LogFormat;
+
+/**
+ * monotonic timestamps of the phases of a request in nanoseconds, see
+ * monotonic_ns(). 0 if unknown.
+ */
+typedef struct {
+    uint64_t received;   ///< the first byte of the request is received
+    uint64_t parsed;     ///< the request line and headers are parsed
+    uint64_t built;      ///< the response is built
+    uint64_t first_sent; ///< the first byte of the response is written
+    uint64_t last_sent;  ///< the last byte of the response is written
+} PhaseTimes;
+
+/// values of fields of a log line
+typedef struct {
+    time_t time; ///< the time of the request, stored in binary records
+    const char *remote_addr;
+    const char *time_local;
+    const char *request;
+    const char *status;
+    const char *body_bytes_sent;
+    const char *http_referer;
+    const char *http_user_agent;
+    uint64_t request_time; ///< nanoseconds
+    PhaseTimes phases;     ///< not stored in binary records
+} LogEntry;
+
+LogFormat *LogFormat_compile(const char *fmt, Exception *ex);
+void delete_LogFormat(LogFormat *);
+int LogFormat_render(LogFormat *, LogEntry *, char *buf, int size);
+
+/**
+ * types of records of a binary log.
+ *
+ * A record is the length of the rest of the record (u16), the type (u8) and
+ * the payload. Numbers are little-endian and of fixed width. Workers append
+ * records to the same file, so records carry the pid of the worker and
+ * strings are sent once per worker as LR_STRING records, then referred to by
+ * their ids.
+ *
+ * \li LR_HEADER: "DLOG", version (u8), pid (u32), UTC offset in seconds (i32).
+ * It starts a new dictionary of the worker.
+ * \li LR_STRING: pid (u32), id (u16), string (the rest of the record)
+ * \li LR_REQUEST: pid (u32), time (i64), request_time in ns (u64), IPv4
+ * address (4 bytes), status (u16), body_bytes_sent (i64, -1 if unknown), ids
+ * of request, http_referer and http_user_agent (u16 each).
+ */
+typedef enum {
+    LR_HEADER = 'H',
+    LR_STRING = 'S',
+    LR_REQUEST = 'R',
+} LogRecordType;
+
+typedef struct LogDict LogDict;
+
+/** @struct AccessLog
+ * @brief An access log which formats lines into the buffer of its own and
+ * appends them to the file in batches.
+ *
+ * Each worker has its own AccessLog, so that workers never wait for each
+ * other. The buffer is flushed when it is full or LOG_FLUSH_INTERVAL has
+ * passed since the last flush. A flush is a single write(2) of whole lines to
+ * the file opened with O_APPEND, so the order of lines of a worker is kept
+ * and lines of workers are never torn.
+ *
+ * \li new_AccessLog() creates a log in LOG_FORMAT_COMBINED.
+ * \li delete_AccessLog() flushes and closes the log.
+ * \li AccessLog_setFormat() sets a format, or LOG_FORMAT_BINARY.
+ * \li AccessLog_write() appends a line or records.
+ * \li AccessLog_flush()
+ * \li AccessLog_flushIfDue() flushes if LOG_FLUSH_INTERVAL has passed.
+ * \li AccessLog_reopen() flushes and reopens the path, for log rotation.
+ */
+typedef struct {
+    char *path;
+    int fd;
+    LogFormat *format;
+    bool binary; ///< writes binary records instead of lines
+
+    LogDict *_dict; // for internal: strings sent by this worker
+
+    char buf[LOG_BUF_SIZE];
+    int len;
+    time_t flushed_at; ///< the time of the last flush
+} AccessLog;
+
+AccessLog *new_AccessLog(const char *path, Exception *ex);
+void delete_AccessLog(AccessLog *);
+void AccessLog_setFormat(AccessLog *, const char *fmt, Exception *ex);
+int AccessLog_write(AccessLog *, LogEntry *, time_t now);
+void AccessLog_flush(AccessLog *);
+void AccessLog_flushIfDue(AccessLog *, time_t now);
+void AccessLog_reopen(AccessLog *, Exception *ex);
+
+bool LogEntry_parse(LogEntry *, char *line);
+
+/** @struct LogReader
+ * @brief A reader of a log, in binary records, see LogRecordType, or in
+ * lines of LOG_FORMAT_COMBINED or LOG_FORMAT_COMMON.
+ *
+ * The format is detected by the first byte: a binary log starts with the
+ * length of its header, a control character, and a line does not.
+ *
+ * \li new_LogReader()
+ * \li delete_LogReader()
+ * \li LogReader_next() reads the next request. The strings of the entry are
+ * valid until the next call. Malformed lines are skipped and counted.
+ */
+typedef struct {
+    FILE *in;
+    bool text;    ///< lines, known after the first LogReader_next()
+    long skipped; ///< malformed lines skipped
+
+    bool _detected;          // for internal: the format is detected
+    Vector *_dicts;          // for internal: dictionaries of workers
+    char _remote_addr[16];   // for internal: buffers of fields
+    char _time_local[32];    // for internal
+    char _status[8];         // for internal
+    char _body_bytes[24];    // for internal
+    unsigned char _rec[65536]; // for internal: the current record or line
+} LogReader;
+
+LogReader *new_LogReader(FILE *in);
+void delete_LogReader(LogReader *);
+bool LogReader_next(LogReader *, LogEntry *, Exception *ex);
+
+void run_all_test_log();
@@ -0,0 +1,153 @@
+/** @file
+ * dali-logcat - converts access logs into text or JSON. Binary logs and
+ * lines of the combined or common format are read, see LogReader.
+ *
+ * Usage: dali-logcat [-j] [-f LOG_FORMAT] [FILE...]
+ *
+ * \li -j : writes a JSON object per line.
+ * \li -f LOG_FORMAT : writes lines in the format (default: combined), see
+ * LogFormat_compile().
+ *
+ * The standard input is read if no file is given.
+ */
+#include "log.h"
+#include "util.h"
+
+#include <stdio.h>  // printf(3)
+#include <stdlib.h> // exit(3)
+#include <string.h> // strcmp(3)
+
+typedef struct {
+    char *prog_name;
+    bool json;
+    char *log_format;
+    Vector *files;
+} LogcatOption;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "%s [-j] [-f LOG_FORMAT] [FILE...]\n", prog_name);
+}
+
+static LogcatOption *LogcatOption_parse(int argc, char **argv, Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    LogcatOption *opts = calloc(1, sizeof(LogcatOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->log_format = LOG_FORMAT_COMBINED;
+    opts->files = new_Vector();
+
+    while (ArgsIter_hasNext(iter)) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-j") == 0) {
+            opts->json = true;
+            continue;
+        }
+        if (strcmp(arg, "-f") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument -- 'f'";
+                break;
+            }
+            opts->log_format = ArgsIter_next(iter);
+            continue;
+        }
+        if (arg[0] == '-' && arg[1] != '\0') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+            break;
+        }
+        Vector_push(opts->files, arg);
+    }
+    delete_ArgsIter(iter);
+
+    return opts;
+}
+
+static void write_json_str(const char *str, FILE *out) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            fprintf(out, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(out, "\\u%04x", *p);
+        else
+            fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static void write_json(LogEntry *e, FILE *out) {
+    fprintf(out, "{\"time\":%jd,\"remote_addr\":", (intmax_t)e->time);
+    write_json_str(e->remote_addr, out);
+    fprintf(out, ",\"time_local\":");
+    write_json_str(e->time_local, out);
+    fprintf(out, ",\"request\":");
+    write_json_str(e->request, out);
+    fprintf(out, ",\"status\":%s,\"body_bytes_sent\":", e->status);
+    if (strcmp(e->body_bytes_sent, "-") == 0)
+        fprintf(out, "null");
+    else
+        fprintf(out, "%s", e->body_bytes_sent);
+    fprintf(out, ",\"http_referer\":");
+    write_json_str(e->http_referer, out);
+    fprintf(out, ",\"http_user_agent\":");
+    write_json_str(e->http_user_agent, out);
+    fprintf(out, ",\"request_time\":%.6f}\n", e->request_time / 1e9);
+}
+
+static void cat(FILE *in, const char *name, LogcatOption *opt,
+                LogFormat *format) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogReader *reader = new_LogReader(in);
+    LogEntry e;
+    static char buf[4 * LOG_STR_MAX];
+
+    while (LogReader_next(reader, &e, ex)) {
+        if (opt->json) {
+            write_json(&e, stdout);
+            continue;
+        }
+        int len = LogFormat_render(format, &e, buf, sizeof(buf));
+        if (len > 0)
+            fwrite(buf, 1, len, stdout);
+    }
+    if (ex->ty != E_Okay)
+        fprintf(stderr, "%s: %s\n", name, ex->msg);
+
+    delete_LogReader(reader);
+    free(ex);
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    LogcatOption *opt = LogcatOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(opt->prog_name);
+        return EXIT_FAILURE;
+    }
+
+    LogFormat *format = LogFormat_compile(opt->log_format, ex);
+    if (ex->ty != E_Okay)
+        error("Error: %s: %s", ex->msg, opt->log_format);
+
+    if (opt->files->len == 0)
+        cat(stdin, "-", opt, format);
+    for (int i = 0; i < opt->files->len; i++) {
+        char *path = opt->files->data[i];
+        FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+        if (in == NULL) {
+            perror(path);
+            continue;
+        }
+        cat(in, path, opt, format);
+        if (in != stdin)
+            fclose(in);
+    }
+
+    delete_LogFormat(format);
+    return EXIT_SUCCESS;
+}
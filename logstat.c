@@ -0,0 +1,526 @@
+/** @file
+ * dali-logstat - summarizes access logs in parallel.
+ *
+ * Usage: dali-logstat [-t THREADS] [-n TOP] FILE...
+ *
+ * \li -t THREADS : the number of threads (default: the number of CPUs)
+ * \li -n TOP : the number of URIs and clients listed (default: 10)
+ *
+ * Prints the breakdown of statuses, the URIs requested most, the clients
+ * sent the most bytes, and the requests per minute.
+ *
+ * A text log is mapped into memory and split into chunks at line boundaries,
+ * and the chunks are parsed in threads, each counting into tables of its own
+ * which are merged at the end. Lines are scanned for quotes and newlines 16
+ * bytes at a time with SSE2 where available, or by memchr(3). Keys of the
+ * tables of threads point into the mapped file, so that only the distinct
+ * keys are copied, on merging. A binary log, whose strings refer to
+ * dictionaries of the workers, is read in a single thread by LogReader.
+ *
+ * The URI is without the query. A line which is not of the combined or
+ * common format is counted as skipped.
+ */
+#include "log.h"
+#include "util.h"
+
+#include <errno.h>    // errno
+#include <pthread.h>  // pthread_create(3)
+#include <stdint.h>   // uint64_t
+#include <stdio.h>    // printf(3)
+#include <stdlib.h>   // qsort(3)
+#include <string.h>   // memchr(3)
+#include <sys/mman.h> // mmap(2)
+#include <sys/stat.h> // fstat(2)
+#include <unistd.h>   // sysconf(3)
+
+#ifdef __SSE2__
+#include <emmintrin.h> // _mm_cmpeq_epi8
+#endif
+
+// clang-format off
+#define LOGSTAT_MAX_THREADS 256           ///< the maximum of -t
+#define LOGSTAT_MIN_CHUNK   (1024 * 1024) ///< the least bytes of a chunk
+#define LOGSTAT_MINUTE_LEN  17            ///< "dd/Mon/yyyy:HH:MM"
+#define LOGSTAT_MAX_STATUS  600           ///< statuses are 100 to 599
+// clang-format on
+
+typedef struct {
+    char *prog_name;
+    int threads;
+    int top;
+    Vector *files;
+} LogstatOption;
+
+/// counts of a key
+typedef struct {
+    const char *key; ///< NULL if empty
+    int len;
+    uint64_t count;
+    uint64_t bytes;
+} Entry;
+
+/** @struct Table
+ * @brief A hash table of counts by keys, of open addressing. Keys point into
+ * the log, or are copied if copy_keys is set.
+ */
+typedef struct {
+    Entry *entries;
+    int cap; ///< a power of two
+    int len;
+    bool copy_keys;
+} Table;
+
+/// counts of a chunk
+typedef struct {
+    const char *begin;
+    const char *end;
+
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t skipped;
+    uint64_t status[LOGSTAT_MAX_STATUS]; ///< [0] for the others
+    Table uris;
+    Table clients;
+    Table minutes; ///< by "dd/Mon/yyyy:HH:MM"
+
+    // the minute of the last lines, added to minutes when the minute changes
+    char minute[LOGSTAT_MINUTE_LEN];
+    uint64_t minute_count;
+    uint64_t minute_bytes;
+} Stats;
+
+static LogstatOption *Opt;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "%s [-t THREADS] [-n TOP] FILE...\n", prog_name);
+}
+
+static LogstatOption *LogstatOption_parse(int argc, char **argv,
+                                          Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    LogstatOption *opts = calloc(1, sizeof(LogstatOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->threads = sysconf(_SC_NPROCESSORS_ONLN);
+    opts->top = 10;
+    opts->files = new_Vector();
+
+    while (ex->ty == E_Okay && ArgsIter_hasNext(iter)) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-t") == 0 || strcmp(arg, "-n") == 0) {
+            if (!ArgsIter_hasNext(iter)) {
+                ex->ty = O_IllegalArgument;
+                ex->msg = "option require an argument";
+                break;
+            }
+            if (arg[1] == 't')
+                opts->threads = atoi(ArgsIter_next(iter));
+            else
+                opts->top = atoi(ArgsIter_next(iter));
+        } else if (arg[0] == '-') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+        } else {
+            Vector_push(opts->files, arg);
+        }
+    }
+    delete_ArgsIter(iter);
+
+    if (ex->ty == E_Okay && opts->files->len == 0) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "FILE is required";
+    }
+    if (ex->ty == E_Okay &&
+        (opts->threads <= 0 || opts->threads > LOGSTAT_MAX_THREADS)) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "bad THREADS";
+    }
+    return opts;
+}
+
+//
+// Table
+//
+
+static unsigned hash(const char *key, int len) {
+    unsigned h = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++)
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    return h;
+}
+
+static Entry *find_slot(Entry *entries, int cap, const char *key, int len) {
+    unsigned i = hash(key, len) & (cap - 1);
+    for (; entries[i].key != NULL; i = (i + 1) & (cap - 1))
+        if (entries[i].len == len && memcmp(entries[i].key, key, len) == 0)
+            break;
+    return &entries[i];
+}
+
+/// adds the counts to the key
+static void Table_add(Table *t, const char *key, int len, uint64_t count,
+                      uint64_t bytes) {
+    if (t->len * 2 >= t->cap) {
+        int cap = t->cap == 0 ? 1024 : t->cap * 2;
+        Entry *entries = calloc(cap, sizeof(Entry));
+        for (int i = 0; i < t->cap; i++)
+            if (t->entries[i].key != NULL)
+                *find_slot(entries, cap, t->entries[i].key,
+                           t->entries[i].len) = t->entries[i];
+        free(t->entries);
+        t->entries = entries;
+        t->cap = cap;
+    }
+
+    Entry *e = find_slot(t->entries, t->cap, key, len);
+    if (e->key == NULL) {
+        e->key = t->copy_keys ? strndup(key, len) : key;
+        e->len = len;
+        t->len++;
+    }
+    e->count += count;
+    e->bytes += bytes;
+}
+
+static void Table_merge(Table *dest, Table *src) {
+    for (int i = 0; i < src->cap; i++)
+        if (src->entries[i].key != NULL)
+            Table_add(dest, src->entries[i].key, src->entries[i].len,
+                      src->entries[i].count, src->entries[i].bytes);
+}
+
+static void Table_clear(Table *t) {
+    if (t->copy_keys)
+        for (int i = 0; i < t->cap; i++)
+            free((char *)t->entries[i].key);
+    free(t->entries);
+    *t = (Table){.copy_keys = t->copy_keys};
+}
+
+/// returns the entries sorted by the comparator, to be freed
+static Entry *Table_sorted(Table *t, int (*compar)(const void *,
+                                                   const void *)) {
+    Entry *sorted = malloc((t->len + 1) * sizeof(Entry));
+    int n = 0;
+    for (int i = 0; i < t->cap; i++)
+        if (t->entries[i].key != NULL)
+            sorted[n++] = t->entries[i];
+    qsort(sorted, n, sizeof(Entry), compar);
+    return sorted;
+}
+
+//
+// parsing
+//
+
+/// returns the first c1 or c2 in [p, end), or end
+static const char *find2(const char *p, const char *end, char c1, char c2) {
+#ifdef __SSE2__
+    __m128i v1 = _mm_set1_epi8(c1), v2 = _mm_set1_epi8(c2);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(x, v1), _mm_cmpeq_epi8(x, v2)));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    for (; p < end; p++)
+        if (*p == c1 || *p == c2)
+            return p;
+    return end;
+#else
+    const char *a = memchr(p, c1, end - p);
+    const char *b = memchr(p, c2, a != NULL ? a - p : end - p);
+    return b != NULL ? b : a != NULL ? a : end;
+#endif
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/// the closing quote of $request is followed by the status and a space
+static bool closes_request(const char *q, const char *end) {
+    return end - q >= 6 && q[1] == ' ' && is_digit(q[2]) && is_digit(q[3]) &&
+           is_digit(q[4]) && (q[5] == ' ' || q[5] == '\n');
+}
+
+static void flush_minute(Stats *st) {
+    if (st->minute_count > 0)
+        Table_add(&st->minutes, st->minute, LOGSTAT_MINUTE_LEN,
+                  st->minute_count, st->minute_bytes);
+    st->minute_count = st->minute_bytes = 0;
+}
+
+/// counts a request of the fields
+static void count(Stats *st, const char *addr, int addr_len,
+                  const char *minute, const char *uri, int uri_len,
+                  int status, uint64_t bytes) {
+    st->requests++;
+    st->bytes += bytes;
+    st->status[status >= 100 && status < LOGSTAT_MAX_STATUS ? status : 0]++;
+    Table_add(&st->uris, uri, uri_len, 1, bytes);
+    Table_add(&st->clients, addr, addr_len, 1, bytes);
+    if (minute == NULL)
+        return;
+    if (memcmp(st->minute, minute, LOGSTAT_MINUTE_LEN) != 0) {
+        flush_minute(st);
+        memcpy(st->minute, minute, LOGSTAT_MINUTE_LEN);
+    }
+    st->minute_count++;
+    st->minute_bytes += bytes;
+}
+
+/// the URI without the method, the version and the query
+static const char *request_uri(const char *req, const char *end, int *len) {
+    const char *uri = memchr(req, ' ', end - req);
+    uri = uri != NULL ? uri + 1 : req;
+    const char *q = find2(uri, end, ' ', '?');
+    *len = q - uri;
+    return uri;
+}
+
+/**
+ * Parses a line of the combined or common format, up to the newline.
+ *
+ * @return the next line
+ */
+static const char *parse_line(Stats *st, const char *line, const char *end) {
+    // the first quote opens $request, as the fields before have none
+    const char *q = find2(line, end, '\n', '"');
+    if (q == end || *q == '\n') {
+        if (q > line)
+            st->skipped++;
+        return q == end ? end : q + 1;
+    }
+    const char *req = q + 1;
+    do
+        q = find2(q + 1, end, '\n', '"');
+    while (q < end && *q == '"' && !closes_request(q, end));
+    if (q == end || *q == '\n') {
+        st->skipped++;
+        return q == end ? end : q + 1;
+    }
+
+    const char *addr_end = memchr(line, ' ', req - line);
+    const char *time = memchr(line, '[', req - line);
+    const char *minute = time != NULL && req - time > LOGSTAT_MINUTE_LEN
+                             ? time + 1
+                             : NULL;
+    int uri_len;
+    const char *uri = request_uri(req, q, &uri_len);
+    int status = (q[2] - '0') * 100 + (q[3] - '0') * 10 + (q[4] - '0');
+    uint64_t bytes = 0;
+    const char *p = q + 6;
+    for (; p < end && is_digit(*p); p++)
+        bytes = bytes * 10 + (*p - '0');
+
+    count(st, line, addr_end != NULL ? addr_end - line : 0, minute, uri,
+          uri_len, status, bytes);
+
+    const char *nl = memchr(p, '\n', end - p);
+    return nl != NULL ? nl + 1 : end;
+}
+
+static void *parse_chunk(void *arg) {
+    Stats *st = arg;
+    for (const char *p = st->begin; p < st->end;)
+        p = parse_line(st, p, st->end);
+    flush_minute(st);
+    return NULL;
+}
+
+/// reads a binary log in the thread of the caller
+static void read_binary(Stats *st, FILE *in, const char *name) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogReader *reader = new_LogReader(in);
+    LogEntry e;
+    char minute[LOGSTAT_MINUTE_LEN + 1];
+
+    while (LogReader_next(reader, &e, ex)) {
+        int uri_len;
+        const char *req = e.request;
+        const char *uri = request_uri(req, req + strlen(req), &uri_len);
+        snprintf(minute, sizeof(minute), "%s", e.time_local);
+        count(st, e.remote_addr, strlen(e.remote_addr), minute, uri, uri_len,
+              atoi(e.status), strtoull(e.body_bytes_sent, NULL, 10));
+    }
+    flush_minute(st);
+    if (ex->ty != E_Okay)
+        fprintf(stderr, "%s: %s\n", name, ex->msg);
+
+    delete_LogReader(reader);
+    free(ex);
+}
+
+/// maps the text log, and parses its chunks in threads
+static void read_text(Stats *total, int fd, size_t size, const char *name) {
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        error("Error: mmap: %s: %s", name, strerror(errno));
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    int n = Opt->threads;
+    if (size / n < LOGSTAT_MIN_CHUNK)
+        n = size / LOGSTAT_MIN_CHUNK + 1;
+
+    // chunks end at the newline after each n-th of the file
+    const char *begin = map, *end = begin + size;
+    Stats *chunks = calloc(n, sizeof(Stats));
+    pthread_t *threads = calloc(n, sizeof(pthread_t));
+    const char *p = begin;
+    for (int i = 0; i < n; i++) {
+        const char *q = i == n - 1 ? end : begin + size / n * (i + 1);
+        if (q < p)
+            q = p;
+        const char *nl = q < end ? memchr(q, '\n', end - q) : NULL;
+        chunks[i].begin = p;
+        chunks[i].end = p = nl != NULL ? nl + 1 : end;
+        chunks[i].minutes.copy_keys = true; // of Stats.minute
+        if (pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) != 0)
+            error("Error: pthread_create");
+    }
+
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        Stats *st = &chunks[i];
+        total->requests += st->requests;
+        total->bytes += st->bytes;
+        total->skipped += st->skipped;
+        for (int s = 0; s < LOGSTAT_MAX_STATUS; s++)
+            total->status[s] += st->status[s];
+        Table_merge(&total->uris, &st->uris);
+        Table_merge(&total->clients, &st->clients);
+        Table_merge(&total->minutes, &st->minutes);
+        Table_clear(&st->uris);
+        Table_clear(&st->clients);
+        Table_clear(&st->minutes);
+    }
+    free(threads);
+    free(chunks);
+    munmap(map, size);
+}
+
+//
+// report
+//
+
+static int by_count(const void *a, const void *b) {
+    const Entry *x = a, *y = b;
+    return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+static int by_bytes(const void *a, const void *b) {
+    const Entry *x = a, *y = b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/// "dd/Mon/yyyy:HH:MM" as a number in the order of times
+static long minute_order(const Entry *e) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *k = e->key;
+    long mon = 0;
+    while (mon < 12 && strncmp(months + mon * 3, k + 3, 3) != 0)
+        mon++;
+    return atol(k + 7) * 100000000 + mon * 1000000 + atol(k) * 10000 +
+           atol(k + 12) * 100 + atol(k + 15);
+}
+
+static int by_minute(const void *a, const void *b) {
+    long x = minute_order(a), y = minute_order(b);
+    return x < y ? -1 : x > y;
+}
+
+static void print_result(Stats *st, double sec, size_t size) {
+    printf("%ju requests, %.2f MB sent, %ju lines skipped, %.2f s (%.1f MB/s)"
+           "\n",
+           (uintmax_t)st->requests, st->bytes / 1e6, (uintmax_t)st->skipped,
+           sec, sec > 0 ? size / sec / 1e6 : 0);
+
+    printf("\nstatus\n");
+    for (int s = 0; s < LOGSTAT_MAX_STATUS; s++) {
+        char label[8] = "other";
+        if (st->status[s] == 0)
+            continue;
+        if (s > 0)
+            snprintf(label, sizeof(label), "%d", s);
+        printf("  %-5s %12ju %6.2f%%\n", label, (uintmax_t)st->status[s],
+               st->status[s] * 100.0 / st->requests);
+    }
+
+    Entry *uris = Table_sorted(&st->uris, by_count);
+    printf("\ntop URIs\n  %12s %12s  %s\n", "requests", "MB", "uri");
+    for (int i = 0; i < st->uris.len && i < Opt->top; i++)
+        printf("  %12ju %12.2f  %.*s\n", (uintmax_t)uris[i].count,
+               uris[i].bytes / 1e6, uris[i].len, uris[i].key);
+    free(uris);
+
+    Entry *clients = Table_sorted(&st->clients, by_bytes);
+    printf("\ntop clients by bytes\n  %12s %12s  %s\n", "requests", "MB",
+           "client");
+    for (int i = 0; i < st->clients.len && i < Opt->top; i++)
+        printf("  %12ju %12.2f  %.*s\n", (uintmax_t)clients[i].count,
+               clients[i].bytes / 1e6, clients[i].len, clients[i].key);
+    free(clients);
+
+    Entry *minutes = Table_sorted(&st->minutes, by_minute);
+    printf("\nrequests per minute\n  %-17s %12s %10s\n", "minute",
+           "requests", "per second");
+    for (int i = 0; i < st->minutes.len; i++)
+        printf("  %.*s %12ju %10.2f\n", minutes[i].len, minutes[i].key,
+               (uintmax_t)minutes[i].count, minutes[i].count / 60.0);
+    free(minutes);
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    Opt = LogstatOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(Opt->prog_name);
+        return EXIT_FAILURE;
+    }
+
+    Stats *total = calloc(1, sizeof(Stats));
+    size_t bytes_read = 0;
+    uint64_t start = monotonic_ns();
+
+    // the keys outlive the logs
+    total->uris.copy_keys = total->clients.copy_keys =
+        total->minutes.copy_keys = true;
+
+    for (int i = 0; i < Opt->files->len; i++) {
+        char *path = Opt->files->data[i];
+        FILE *in = fopen(path, "r");
+        struct stat st;
+        if (in == NULL || fstat(fileno(in), &st) == -1) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            if (in != NULL)
+                fclose(in);
+            continue;
+        }
+        bytes_read += st.st_size;
+
+        int c = getc(in);
+        if (c != EOF && c < ' ' && c != '\n') {
+            ungetc(c, in);
+            read_binary(total, in, path);
+        } else if (st.st_size > 0) {
+            read_text(total, fileno(in), st.st_size, path);
+        }
+        fclose(in);
+    }
+    double sec = (monotonic_ns() - start) / 1e9;
+
+    print_result(total, sec, bytes_read);
+
+    Table_clear(&total->uris);
+    Table_clear(&total->clients);
+    Table_clear(&total->minutes);
+    free(total);
+    free(ex);
+    return EXIT_SUCCESS;
+}
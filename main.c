@@ -1,19 +1,25 @@
 #include "main.h"
+#include "compress.h"
 #include "file.h"
+#include "histogram.h"
+#include "log.h"
+#include "metrics.h"
+#include "mime.h"
 #include "net.h"
+#include "perf.h"
+#include "stats.h"
 
+#include <errno.h>  // errno
 #include <stdlib.h> // atoi(3)
 #include <string.h> // strcmp(3)
 
 static void run_all_test();
+static void run_all_bench();
 static void run_all_test_main();
 
-static Map *new_MimeMap();
 static Option *Option_parse(int argc, char **argv, Exception *ex);
 static void print_usage(const char *);
 
-Map *MimeMap;
-
 /**
  *
  */
@@ -31,6 +37,18 @@ int main(int argc, char **argv) {
         run_all_test();
         return EXIT_SUCCESS;
     }
+    if (opt->bench) {
+        if (opt->bench_output != NULL) {
+            BenchOutput = fopen(opt->bench_output, "w");
+            if (BenchOutput == NULL)
+                error("Error: fopen: %s: %s", opt->bench_output,
+                      strerror(errno));
+        }
+        run_all_bench();
+        if (BenchOutput != NULL)
+            fclose(BenchOutput);
+        return EXIT_SUCCESS;
+    }
     if (opt->help) {
         print_usage(opt->prog_name);
         return EXIT_SUCCESS;
@@ -40,26 +58,17 @@ int main(int argc, char **argv) {
         return EXIT_SUCCESS;
     }
 
-    MimeMap = new_MimeMap();
+    if (opt->mime_types != NULL) {
+        mime_load(opt->mime_types, ex);
+        if (ex->ty != E_Okay)
+            error("Error: %s: %s: %s", ex->msg, opt->mime_types,
+                  strerror(errno));
+    }
     server_start(opt);
 
     return EXIT_SUCCESS;
 }
 
-static Map *new_MimeMap() {
-    Map *map = new_Map();
-
-    // clang-format off
-    Map_put(map, "css" , "text/css" );
-    Map_put(map, "gif" , "image/gif");
-    Map_put(map, "html", "text/html");
-    Map_put(map, "png" , "image/png");
-    Map_put(map, "wmv" , "video/x-ms-wmv");
-    // clang-format on
-
-    return map;
-}
-
 static Option *Option_parse(int argc, char **argv, Exception *ex) {
     ArgsIter *iter = new_ArgsIter(argc, argv);
     Option *opts = calloc(1, sizeof(Option));
@@ -84,6 +93,10 @@ static Option *Option_parse(int argc, char **argv, Exception *ex) {
                 opts->test = true;
                 continue;
             }
+            if (strcmp(arg, "-bench") == 0) {
+                opts->bench = true;
+                continue;
+            }
             if (strcmp(arg, "-h") == 0) {
                 opts->help = true;
                 continue;
@@ -92,6 +105,26 @@ static Option *Option_parse(int argc, char **argv, Exception *ex) {
                 opts->version = true;
                 continue;
             }
+            if (strcmp(arg, "-i") == 0) {
+                opts->autoindex = true;
+                continue;
+            }
+            if (strcmp(arg, "-z") == 0) {
+                opts->compress = true;
+                continue;
+            }
+            if (strcmp(arg, "-d") == 0) {
+                opts->debug = true;
+                continue;
+            }
+            if (strcmp(arg, "-P") == 0) {
+                opts->perf = true;
+                continue;
+            }
+            if (strcmp(arg, "-s") == 0) {
+                opts->status = true;
+                continue;
+            }
             if (strcmp(arg, "-r") == 0) {
                 if (!ArgsIter_hasNext(iter)) {
                     ex->ty = O_IllegalArgument;
@@ -110,6 +143,33 @@ static Option *Option_parse(int argc, char **argv, Exception *ex) {
                 opts->access_log = ArgsIter_next(iter);
                 continue;
             }
+            if (strcmp(arg, "-f") == 0) {
+                if (!ArgsIter_hasNext(iter)) {
+                    ex->ty = O_IllegalArgument;
+                    ex->msg = "option require an argument -- 'f'";
+                    break;
+                }
+                opts->log_format = ArgsIter_next(iter);
+                continue;
+            }
+            if (strcmp(arg, "-m") == 0) {
+                if (!ArgsIter_hasNext(iter)) {
+                    ex->ty = O_IllegalArgument;
+                    ex->msg = "option require an argument -- 'm'";
+                    break;
+                }
+                opts->mime_types = ArgsIter_next(iter);
+                continue;
+            }
+            if (strcmp(arg, "-o") == 0) {
+                if (!ArgsIter_hasNext(iter)) {
+                    ex->ty = O_IllegalArgument;
+                    ex->msg = "option require an argument -- 'o'";
+                    break;
+                }
+                opts->bench_output = ArgsIter_next(iter);
+                continue;
+            }
             if (strcmp(arg, "-p") == 0) {
                 if (!ArgsIter_hasNext(iter)) {
                     ex->ty = O_IllegalArgument;
@@ -135,8 +195,11 @@ static Option *Option_parse(int argc, char **argv, Exception *ex) {
 
 static void print_usage(const char *prog_name) {
     fprintf(stderr, "Usage:\n");
-    fprintf(stderr, "%s [-r DOCUMENT_ROOT] [-l ACCESS_LOG] [-p PORT]\n",
+    fprintf(stderr,
+            "%s [-r DOCUMENT_ROOT] [-l ACCESS_LOG] [-f LOG_FORMAT] [-p PORT] "
+            "[-m MIME_TYPES] [-i] [-z] [-d] [-P] [-s]\n",
             prog_name);
+    fprintf(stderr, "%s -bench [-o RESULTS]\n", prog_name);
     fprintf(stderr, "%s -h\n", prog_name);
     fprintf(stderr, "%s -v\n", prog_name);
 }
@@ -155,6 +218,7 @@ static void test_Option_parse_normal() {
     expect_str(__LINE__, opt->prog_name, "./httpd");
     expect_str(__LINE__, opt->document_root, "www");
     expect_str(__LINE__, opt->access_log, "access.log");
+    expect_ptr(__LINE__, NULL, opt->log_format);
 
     char *arg_full[] = {"./HTTPD", "-r", "WWW", "-l", "ACCESS.LOG", "-p", "80"};
     opt = Option_parse(7, arg_full, ex);
@@ -178,6 +242,46 @@ static void test_Option_parse_normal() {
     opt = Option_parse(2, arg_test, ex);
     expect(__LINE__, ex->ty, E_Okay);
     expect_bool(__LINE__, true, opt->test);
+
+    char *arg_bench[] = {"./httpd", "-bench"};
+    opt = Option_parse(2, arg_bench, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_bool(__LINE__, true, opt->bench);
+
+    char *arg_bench_output[] = {"./httpd", "-bench", "-o", "results.json"};
+    opt = Option_parse(4, arg_bench_output, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_str(__LINE__, "results.json", opt->bench_output);
+
+    char *arg_autoindex[] = {"./httpd", "-i"};
+    opt = Option_parse(2, arg_autoindex, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_bool(__LINE__, true, opt->autoindex);
+
+    char *arg_compress[] = {"./httpd", "-z"};
+    opt = Option_parse(2, arg_compress, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_bool(__LINE__, true, opt->compress);
+
+    char *arg_debug[] = {"./httpd", "-d"};
+    opt = Option_parse(2, arg_debug, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_bool(__LINE__, true, opt->debug);
+
+    char *arg_perf[] = {"./httpd", "-P"};
+    opt = Option_parse(2, arg_perf, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_bool(__LINE__, true, opt->perf);
+
+    char *arg_log_format[] = {"./httpd", "-f", "common"};
+    opt = Option_parse(3, arg_log_format, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_str(__LINE__, "common", opt->log_format);
+
+    char *arg_mime_types[] = {"./httpd", "-m", "mime.types"};
+    opt = Option_parse(3, arg_mime_types, ex);
+    expect(__LINE__, ex->ty, E_Okay);
+    expect_str(__LINE__, "mime.types", opt->mime_types);
 }
 
 /**
@@ -198,6 +302,24 @@ static void test_Option_parse_abnormal() {
     expect(__LINE__, ex->ty, O_IllegalArgument);
     expect_str(__LINE__, "option require an argument -- 'l'", ex->msg);
 
+    ex->ty = E_Okay;
+    char *arg_f[] = {"./httpd", "-f"};
+    Option_parse(2, arg_f, ex);
+    expect(__LINE__, ex->ty, O_IllegalArgument);
+    expect_str(__LINE__, "option require an argument -- 'f'", ex->msg);
+
+    ex->ty = E_Okay;
+    char *arg_m[] = {"./httpd", "-m"};
+    Option_parse(2, arg_m, ex);
+    expect(__LINE__, ex->ty, O_IllegalArgument);
+    expect_str(__LINE__, "option require an argument -- 'm'", ex->msg);
+
+    ex->ty = E_Okay;
+    char *arg_o[] = {"./httpd", "-bench", "-o"};
+    Option_parse(3, arg_o, ex);
+    expect(__LINE__, ex->ty, O_IllegalArgument);
+    expect_str(__LINE__, "option require an argument -- 'o'", ex->msg);
+
     ex->ty = E_Okay;
     char *arg_p[] = {"./httpd", "-p"};
     Option_parse(2, arg_p, ex);
@@ -221,11 +343,16 @@ static void run_all_test_main() {
 }
 
 static void run_all_test() {
-    MimeMap = new_MimeMap();
-
     run_all_test_util();
     run_all_test_main();
     run_all_test_file();
+    run_all_test_compress();
+    run_all_test_mime();
+    run_all_test_log();
+    run_all_test_histogram();
+    run_all_test_stats();
+    run_all_test_perf();
+    run_all_test_metrics();
     run_all_test_net();
     run_all_test_server();
 
@@ -233,3 +360,10 @@ static void run_all_test() {
     printf(" All unit tests passed.\n");
     printf("==============================\n");
 }
+
+static void run_all_bench() {
+    run_all_bench_util();
+    run_all_bench_mime();
+    run_all_bench_net();
+    run_all_bench_server();
+}
@@ -4,11 +4,15 @@
 #include "util.h"
 
 // clang-format off
-#define VERSION      "0.1.0"
-#define HTTP_VERSION "HTTP/1.1"
-#define SERVER_NAME  "Dali"
-#define DEFAULT_PORT 8088
-#define MAX_SERVERS  20
+#define VERSION             "0.1.0"
+#define HTTP_VERSION        "HTTP/1.1"
+#define SERVER_NAME         "Dali"
+#define DEFAULT_PORT        8088
+#define MAX_SERVERS         20
+#define BYTERANGES_BOUNDARY "DALI_BYTERANGES_7c1e"
+#define STREAM_CHUNK_SIZE   (64 * 1024)
+#define LOOPBACK_BATCH      32    ///< requests per connection of -bench
+#define LOOPBACK_REQUESTS   20000 ///< requests of the report of -bench
 // clang-format on
 
 typedef struct {
@@ -16,14 +20,21 @@ typedef struct {
     bool debug;
     bool help;
     bool test;
+    bool bench;
     bool version;
+    bool compress;
+    bool autoindex;
+    bool perf;
+    bool status; ///< serves STATUS_URI instead of the document root
     char *document_root;
     char *access_log;
+    char *log_format;
+    char *bench_output;
+    char *mime_types;
     int port;
 } Option;
 
 void server_start(Option *);
 void run_all_test_server();
+void run_all_bench_server();
 
-/** a Mime map*/
-extern Map *MimeMap;
@@ -0,0 +1,39 @@
+/** @file
+ * counts calls of malloc(3), calloc(3) and realloc(3) for microbenchmarks.
+ *
+ * Linked only into dali-microbench. The functions replace the ones of glibc,
+ * which calls them internally as well, e.g. in strdup(3), and pass on to the
+ * allocator of glibc. free(3) is not replaced, as the memory is of the same
+ * allocator.
+ */
+#include "util.h"
+
+#include <stddef.h> // size_t
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static uint64_t Count; // benchmarks run in a single thread
+
+void *malloc(size_t size) {
+    Count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    Count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    Count++;
+    return __libc_realloc(ptr, size);
+}
+
+/**
+ * Returns the number of allocations since the program starts.
+ */
+uint64_t malloc_count() {
+    return Count;
+}
@@ -0,0 +1,572 @@
+#include "metrics.h"
+#include "util.h"
+
+#include <stdarg.h>   // va_start(3)
+#include <stdio.h>    // snprintf(3)
+#include <stdlib.h>   // malloc(3)
+#include <string.h>   // strstr(3)
+#include <sys/mman.h> // mmap(2)
+#include <sys/wait.h> // waitpid(2)
+#include <unistd.h>   // fork(2)
+
+/// adds to the counter, which has no other writer
+static void add(_Atomic uint64_t *counter, uint64_t n) {
+    uint64_t v = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, v + n, memory_order_relaxed);
+}
+
+static uint64_t get(_Atomic uint64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static const char *PhaseNames[PP_NPHASES] = {
+    [PP_PARSE] = "parse",
+    [PP_BUILD] = "build",
+    [PP_WRITE] = "write",
+    [PP_LOG] = "log",
+};
+
+/**
+ * Returns the name of the phase.
+ *
+ * @return e.g. "parse"
+ * @param phase
+ */
+const char *PerfPhase_name(PerfPhase phase) {
+    return PhaseNames[phase];
+}
+
+/**
+ * Sets the state of the worker.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param state
+ */
+void WorkerSlot_setState(WorkerSlot *slot, WorkerState state) {
+    if (slot == NULL)
+        return;
+    if (state == WS_KEEPALIVE &&
+        atomic_load_explicit(&slot->state, memory_order_relaxed) == WS_IDLE)
+        add(&slot->connections, 1);
+    atomic_store_explicit(&slot->state, state, memory_order_relaxed);
+}
+
+/**
+ * Counts a response.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param status_code e.g. "200"
+ * @param bytes the bytes of the response sent
+ */
+void WorkerSlot_countRequest(WorkerSlot *slot, const char *status_code,
+                             uint64_t bytes) {
+    if (slot == NULL)
+        return;
+    add(&slot->requests, 1);
+    add(&slot->bytes_sent, bytes);
+    if (status_code != NULL && '1' <= status_code[0] && status_code[0] <= '5')
+        add(&slot->responses[status_code[0] - '1'], 1);
+}
+
+/**
+ * Counts a lookup of a cache.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param hit
+ */
+void WorkerSlot_countCache(WorkerSlot *slot, bool hit) {
+    if (slot == NULL)
+        return;
+    add(hit ? &slot->cache_hits : &slot->cache_misses, 1);
+}
+
+/**
+ * Counts a lookup of the cache of resolved files.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param hit
+ */
+void WorkerSlot_countFileCache(WorkerSlot *slot, bool hit) {
+    if (slot == NULL)
+        return;
+    add(hit ? &slot->file_cache_hits : &slot->file_cache_misses, 1);
+}
+
+/**
+ * Records the latency of a request, and the transfer rate if the response is
+ * at least LARGE_TRANSFER bytes.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param request_ns from the first byte of the request to the last byte of
+ * the response
+ * @param first_byte_ns from the first byte of the request to the first byte
+ * of the response
+ * @param bytes the bytes of the response sent
+ * @param send_ns from the first byte to the last byte of the response
+ */
+void WorkerSlot_recordLatency(WorkerSlot *slot, uint64_t request_ns,
+                              uint64_t first_byte_ns, uint64_t bytes,
+                              uint64_t send_ns) {
+    if (slot == NULL)
+        return;
+    Histogram_record(&slot->request_time, request_ns);
+    Histogram_record(&slot->first_byte_time, first_byte_ns);
+    if (bytes >= LARGE_TRANSFER && send_ns > 0)
+        Histogram_record(&slot->transfer_rate,
+                         (uint64_t)(bytes * 1e9 / send_ns));
+}
+
+/**
+ * Counts the events in a phase of a request.
+ *
+ * @param slot the slot of the worker, or NULL to do nothing
+ * @param phase
+ * @param before the values of PerfCounters at the start of the phase
+ * @param after the values of PerfCounters at the end of the phase
+ */
+void WorkerSlot_countPerf(WorkerSlot *slot, PerfPhase phase,
+                          const uint64_t before[PE_NEVENTS],
+                          const uint64_t after[PE_NEVENTS]) {
+    if (slot == NULL)
+        return;
+    for (int i = 0; i < PE_NEVENTS; i++)
+        if (after[i] > before[i])
+            add(&slot->perf[phase][i], after[i] - before[i]);
+}
+
+/**
+ * Creates a new Scoreboard object in shared memory.
+ *
+ * @return a pointer to a new Scoreboard object
+ * @param nslots the number of workers
+ * @param ex a pointer to Exception, E_Failure if mmap(2) fails
+ */
+Scoreboard *new_Scoreboard(int nslots, Exception *ex) {
+    Scoreboard *board = calloc(1, sizeof(Scoreboard));
+    board->nslots = nslots;
+    board->slots = mmap(NULL, nslots * sizeof(WorkerSlot),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if (board->slots == MAP_FAILED) {
+        board->slots = NULL;
+        ex->ty = E_Failure;
+        ex->msg = "mmap";
+    }
+    return board;
+}
+
+/**
+ * Destroys the Scoreboard object.
+ *
+ * @param board
+ */
+void delete_Scoreboard(Scoreboard *board) {
+    if (board->slots != NULL)
+        munmap(board->slots, board->nslots * sizeof(WorkerSlot));
+    free(board);
+}
+
+/// the aggregate of slots
+typedef struct {
+    uint64_t requests;
+    uint64_t bytes_sent;
+    uint64_t responses[5];
+    uint64_t connections;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t file_cache_hits;
+    uint64_t file_cache_misses;
+    int workers[3]; // by WorkerState
+
+    Histogram request_time;
+    Histogram first_byte_time;
+    Histogram transfer_rate;
+
+    uint64_t perf[PP_NPHASES][PE_NEVENTS];
+} Total;
+
+static void sum(Scoreboard *board, Total *t) {
+    for (int i = 0; i < board->nslots; i++) {
+        WorkerSlot *slot = &board->slots[i];
+        t->requests += get(&slot->requests);
+        t->bytes_sent += get(&slot->bytes_sent);
+        for (int j = 0; j < 5; j++)
+            t->responses[j] += get(&slot->responses[j]);
+        t->connections += get(&slot->connections);
+        t->cache_hits += get(&slot->cache_hits);
+        t->cache_misses += get(&slot->cache_misses);
+        t->file_cache_hits += get(&slot->file_cache_hits);
+        t->file_cache_misses += get(&slot->file_cache_misses);
+
+        int state = atomic_load_explicit(&slot->state, memory_order_relaxed);
+        if (0 <= state && state < 3)
+            t->workers[state]++;
+
+        Histogram_merge(&t->request_time, &slot->request_time);
+        Histogram_merge(&t->first_byte_time, &slot->first_byte_time);
+        Histogram_merge(&t->transfer_rate, &slot->transfer_rate);
+
+        for (int j = 0; j < PP_NPHASES; j++)
+            for (int k = 0; k < PE_NEVENTS; k++)
+                t->perf[j][k] += get(&slot->perf[j][k]);
+    }
+}
+
+static const double Quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+/// appends the formatted string to buf, and returns the new length
+static int appendf(char *buf, int size, int len, const char *fmt, ...) {
+    if (len >= size)
+        return len;
+
+    va_list ap;
+    va_start(ap, fmt);
+    len += vsnprintf(buf + len, size - len, fmt, ap);
+    va_end(ap);
+    return len;
+}
+
+/// appends a summary of the histogram, of nanoseconds if scale is 1e9
+static int append_summary(char *buf, int size, int len, const char *name,
+                          const char *help, Histogram *h, double scale) {
+    len = appendf(buf, size, len, "# HELP %s %s\n# TYPE %s summary\n", name,
+                  help, name);
+    for (int i = 0; i < sizeof(Quantiles) / sizeof(*Quantiles); i++)
+        len = appendf(buf, size, len, "%s{quantile=\"%g\"} %.9g\n", name,
+                      Quantiles[i],
+                      Histogram_percentile(h, Quantiles[i] * 100) / scale);
+    return appendf(buf, size, len, "%s_sum %.9g\n%s_count %ju\n", name,
+                   h->sum / scale, name, (uintmax_t)h->count);
+}
+
+/// appends the percentiles of the histogram as a JSON object
+static int append_json(char *buf, int size, int len, const char *name,
+                       Histogram *h) {
+    len = appendf(buf, size, len, ",\"%s\":{\"count\":%ju,\"mean\":%ju",
+                  name, (uintmax_t)h->count, (uintmax_t)Histogram_mean(h));
+    len = appendf(buf, size, len,
+                  ",\"p50\":%ju,\"p90\":%ju,\"p99\":%ju,\"p999\":%ju",
+                  (uintmax_t)Histogram_percentile(h, 50),
+                  (uintmax_t)Histogram_percentile(h, 90),
+                  (uintmax_t)Histogram_percentile(h, 99),
+                  (uintmax_t)Histogram_percentile(h, 99.9));
+    return appendf(buf, size, len, ",\"max\":%ju}", (uintmax_t)h->max);
+}
+
+static int append_perf(char *buf, int size, int len, Total *t) {
+    len = appendf(buf, size, len,
+                  "# HELP dali_perf_events_total Events of performance "
+                  "counters by request phase.\n"
+                  "# TYPE dali_perf_events_total counter\n");
+    for (int i = 0; i < PP_NPHASES; i++)
+        for (int j = 0; j < PE_NEVENTS; j++)
+            len = appendf(buf, size, len,
+                          "dali_perf_events_total{phase=\"%s\",event=\"%s\"}"
+                          " %ju\n",
+                          PerfPhase_name(i), PerfEvent_name(j),
+                          (uintmax_t)t->perf[i][j]);
+    return len;
+}
+
+static int append_perf_json(char *buf, int size, int len, Total *t) {
+    len = appendf(buf, size, len, ",\"perf\":{");
+    for (int i = 0; i < PP_NPHASES; i++) {
+        len = appendf(buf, size, len, "%s\"%s\":{", i > 0 ? "," : "",
+                      PerfPhase_name(i));
+        for (int j = 0; j < PE_NEVENTS; j++)
+            len = appendf(buf, size, len, "%s\"%s\":%ju", j > 0 ? "," : "",
+                          PerfEvent_name(j), (uintmax_t)t->perf[i][j]);
+        len = appendf(buf, size, len, "}");
+    }
+    return appendf(buf, size, len, "}");
+}
+
+static int render_prometheus(Total *t, Scoreboard *board, char *buf,
+                             int size) {
+    int nslots = board->nslots;
+    int len;
+    // clang-format off
+    len = snprintf(buf, size,
+        "# HELP dali_requests_total Requests handled.\n"
+        "# TYPE dali_requests_total counter\n"
+        "dali_requests_total %ju\n"
+        "# HELP dali_responses_total Responses by status class.\n"
+        "# TYPE dali_responses_total counter\n"
+        "dali_responses_total{class=\"1xx\"} %ju\n"
+        "dali_responses_total{class=\"2xx\"} %ju\n"
+        "dali_responses_total{class=\"3xx\"} %ju\n"
+        "dali_responses_total{class=\"4xx\"} %ju\n"
+        "dali_responses_total{class=\"5xx\"} %ju\n"
+        "# HELP dali_sent_bytes_total Bytes of responses sent.\n"
+        "# TYPE dali_sent_bytes_total counter\n"
+        "dali_sent_bytes_total %ju\n"
+        "# HELP dali_connections_total Connections accepted.\n"
+        "# TYPE dali_connections_total counter\n"
+        "dali_connections_total %ju\n"
+        "# HELP dali_connections Open connections, active or idle in "
+        "keep-alive.\n"
+        "# TYPE dali_connections gauge\n"
+        "dali_connections{state=\"active\"} %d\n"
+        "dali_connections{state=\"idle\"} %d\n"
+        "# HELP dali_workers Workers, and the ones waiting for a connection.\n"
+        "# TYPE dali_workers gauge\n"
+        "dali_workers{state=\"all\"} %d\n"
+        "dali_workers{state=\"idle\"} %d\n"
+        "# HELP dali_cache_lookups_total Lookups of caches of workers.\n"
+        "# TYPE dali_cache_lookups_total counter\n"
+        "dali_cache_lookups_total{result=\"hit\"} %ju\n"
+        "dali_cache_lookups_total{result=\"miss\"} %ju\n"
+        "# HELP dali_file_cache_lookups_total Lookups of resolved files of "
+        "workers.\n"
+        "# TYPE dali_file_cache_lookups_total counter\n"
+        "dali_file_cache_lookups_total{result=\"hit\"} %ju\n"
+        "dali_file_cache_lookups_total{result=\"miss\"} %ju\n",
+        (uintmax_t)t->requests,
+        (uintmax_t)t->responses[0], (uintmax_t)t->responses[1],
+        (uintmax_t)t->responses[2], (uintmax_t)t->responses[3],
+        (uintmax_t)t->responses[4],
+        (uintmax_t)t->bytes_sent,
+        (uintmax_t)t->connections,
+        t->workers[WS_BUSY], t->workers[WS_KEEPALIVE],
+        nslots, t->workers[WS_IDLE],
+        (uintmax_t)t->cache_hits, (uintmax_t)t->cache_misses,
+        (uintmax_t)t->file_cache_hits, (uintmax_t)t->file_cache_misses);
+    // clang-format on
+
+    len = append_summary(buf, size, len, "dali_request_duration_seconds",
+                         "From the first byte of a request to the last byte "
+                         "of the response.",
+                         &t->request_time, 1e9);
+    len = append_summary(buf, size, len, "dali_first_byte_duration_seconds",
+                         "From the first byte of a request to the first byte "
+                         "of the response.",
+                         &t->first_byte_time, 1e9);
+    len = append_summary(buf, size, len,
+                         "dali_transfer_rate_bytes_per_second",
+                         "Rate of responses of at least 1MiB.",
+                         &t->transfer_rate, 1);
+    if (board->perf)
+        len = append_perf(buf, size, len, t);
+    return len;
+}
+
+static int render_json(Total *t, Scoreboard *board, char *buf, int size) {
+    int nslots = board->nslots;
+    int len;
+    // clang-format off
+    len = snprintf(buf, size,
+        "{\"requests\":%ju,"
+        "\"responses\":{\"1xx\":%ju,\"2xx\":%ju,\"3xx\":%ju,\"4xx\":%ju,"
+        "\"5xx\":%ju},"
+        "\"bytes_sent\":%ju,"
+        "\"connections\":{\"total\":%ju,\"active\":%d,\"idle\":%d},"
+        "\"workers\":{\"all\":%d,\"idle\":%d},"
+        "\"cache\":{\"hits\":%ju,\"misses\":%ju},"
+        "\"file_cache\":{\"hits\":%ju,\"misses\":%ju}",
+        (uintmax_t)t->requests,
+        (uintmax_t)t->responses[0], (uintmax_t)t->responses[1],
+        (uintmax_t)t->responses[2], (uintmax_t)t->responses[3],
+        (uintmax_t)t->responses[4],
+        (uintmax_t)t->bytes_sent,
+        (uintmax_t)t->connections,
+        t->workers[WS_BUSY], t->workers[WS_KEEPALIVE],
+        nslots, t->workers[WS_IDLE],
+        (uintmax_t)t->cache_hits, (uintmax_t)t->cache_misses,
+        (uintmax_t)t->file_cache_hits, (uintmax_t)t->file_cache_misses);
+    // clang-format on
+
+    len = append_json(buf, size, len, "request_time_ns", &t->request_time);
+    len = append_json(buf, size, len, "first_byte_time_ns",
+                      &t->first_byte_time);
+    len = append_json(buf, size, len, "transfer_rate_bytes_per_sec",
+                      &t->transfer_rate);
+    if (board->perf)
+        len = append_perf_json(buf, size, len, t);
+    return appendf(buf, size, len, "}\n");
+}
+
+/**
+ * Renders the aggregate of all slots.
+ *
+ * @return a new string
+ * @param board
+ * @param json true for JSON, false for Prometheus text format
+ */
+char *Scoreboard_render(Scoreboard *board, bool json) {
+    Total *t = calloc(1, sizeof(Total));
+    sum(board, t);
+
+    int size = 16384;
+    char *buf = malloc(size);
+    if (json)
+        render_json(t, board, buf, size);
+    else
+        render_prometheus(t, board, buf, size);
+
+    free(t);
+    return buf;
+}
+
+static void dump(FILE *out, const char *name, Histogram *h, double scale) {
+    fprintf(out, "%-16s count %ju, mean %.6f, p50 %.6f, p99 %.6f, p99.9 %.6f, "
+                 "max %.6f\n",
+            name, (uintmax_t)h->count, Histogram_mean(h) / scale,
+            Histogram_percentile(h, 50) / scale,
+            Histogram_percentile(h, 99) / scale,
+            Histogram_percentile(h, 99.9) / scale, h->max / scale);
+}
+
+/**
+ * Prints the percentiles of latency in seconds, and the transfer rate in
+ * MB/s.
+ *
+ * @param board
+ * @param out
+ */
+void Scoreboard_dump(Scoreboard *board, FILE *out) {
+    Total *t = calloc(1, sizeof(Total));
+    sum(board, t);
+
+    fprintf(out, "requests: %ju\n", (uintmax_t)t->requests);
+    dump(out, "request_time:", &t->request_time, 1e9);
+    dump(out, "first_byte_time:", &t->first_byte_time, 1e9);
+    dump(out, "transfer_rate:", &t->transfer_rate, 1e6);
+
+    free(t);
+}
+
+static void test_WorkerSlot() {
+    expect(__LINE__, 0, sizeof(WorkerSlot) % CACHE_LINE_SIZE);
+
+    Exception *ex = calloc(1, sizeof(Exception));
+    Scoreboard *board = new_Scoreboard(2, ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect(__LINE__, 0, (uintptr_t)&board->slots[1] % CACHE_LINE_SIZE);
+
+    WorkerSlot *slot = &board->slots[0];
+    WorkerSlot_setState(slot, WS_KEEPALIVE);
+    WorkerSlot_setState(slot, WS_BUSY);
+    WorkerSlot_countRequest(slot, "200", 100);
+    WorkerSlot_setState(slot, WS_KEEPALIVE);
+    WorkerSlot_countRequest(slot, "404", 10);
+    WorkerSlot_countRequest(slot, NULL, 0);
+    WorkerSlot_countCache(slot, true);
+    WorkerSlot_countCache(slot, false);
+    WorkerSlot_countCache(slot, false);
+    WorkerSlot_countFileCache(slot, true);
+    WorkerSlot_countFileCache(slot, true);
+    WorkerSlot_countFileCache(slot, false);
+
+    // counted by a child process
+    pid_t pid = fork();
+    if (pid == 0) {
+        WorkerSlot_setState(&board->slots[1], WS_KEEPALIVE);
+        WorkerSlot_setState(&board->slots[1], WS_BUSY);
+        WorkerSlot_countRequest(&board->slots[1], "304", 200);
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+
+    expect(__LINE__, 3, get(&slot->requests));
+    expect(__LINE__, 1, get(&slot->connections));
+    expect(__LINE__, 1, get(&board->slots[1].requests));
+
+    char *text = Scoreboard_render(board, false);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_requests_total 4\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_sent_bytes_total 310\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "{class=\"2xx\"} 1\ndali_responses_total"
+                             "{class=\"3xx\"} 1\ndali_responses_total"
+                             "{class=\"4xx\"} 1\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_connections_total 2\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "{state=\"active\"} 1\n") != NULL);
+    expect_bool(__LINE__, true, strstr(text, "{state=\"idle\"} 1\n") != NULL);
+    expect_bool(__LINE__, true, strstr(text, "{result=\"miss\"} 2\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "dali_file_cache_lookups_total{result=\"hit\"} "
+                             "2\n") != NULL);
+    free(text);
+
+    char *json = Scoreboard_render(board, true);
+    expect_bool(__LINE__, true, strncmp(json, "{\"requests\":4,", 14) == 0);
+    expect_bool(__LINE__, true,
+                strstr(json, "\"connections\":{\"total\":2,\"active\":1,"
+                             "\"idle\":1}") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(json, "\"cache\":{\"hits\":1,\"misses\":2},") !=
+                    NULL);
+    expect_bool(__LINE__, true,
+                strstr(json, "\"file_cache\":{\"hits\":2,\"misses\":1},") !=
+                    NULL);
+    free(json);
+
+    // histograms are merged
+    WorkerSlot_recordLatency(slot, 1007, 503, 100, 500);
+    WorkerSlot_recordLatency(&board->slots[1], 3000, 1000, 2000000,
+                             1000000000);
+    expect(__LINE__, 0, board->slots[0].transfer_rate.count);
+
+    text = Scoreboard_render(board, false);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_request_duration_seconds{quantile=\"0.5\"}"
+                             " 1.007e-06\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_request_duration_seconds_count 2\n") !=
+                    NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_transfer_rate_bytes_per_second{quantile="
+                             "\"0.999\"} 2000000\n") != NULL);
+    free(text);
+
+    json = Scoreboard_render(board, true);
+    expect_bool(__LINE__, true,
+                strstr(json, ",\"first_byte_time_ns\":{\"count\":2,\"mean\""
+                             ":751,\"p50\":503,") != NULL);
+    expect_bool(__LINE__, true, strstr(json, "\"max\":3000}") != NULL);
+    free(json);
+
+    // performance counters are rendered if enabled
+    uint64_t before[PE_NEVENTS] = {100, 200, 0, 0, 5};
+    uint64_t after[PE_NEVENTS] = {1100, 2200, 0, 0, 5};
+    text = Scoreboard_render(board, false);
+    expect_bool(__LINE__, true, strstr(text, "dali_perf_events") == NULL);
+    free(text);
+
+    board->perf = true;
+    WorkerSlot_countPerf(slot, PP_PARSE, before, after);
+    WorkerSlot_countPerf(&board->slots[1], PP_PARSE, before, after);
+    WorkerSlot_countPerf(slot, PP_LOG, after, before); // not counted
+    text = Scoreboard_render(board, false);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_perf_events_total{phase=\"parse\","
+                             "event=\"cycles\"} 2000\n") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(text, "\ndali_perf_events_total{phase=\"log\","
+                             "event=\"instructions\"} 0\n") != NULL);
+    free(text);
+
+    json = Scoreboard_render(board, true);
+    expect_bool(__LINE__, true,
+                strstr(json, ",\"perf\":{\"parse\":{\"cycles\":2000,"
+                             "\"instructions\":4000,") != NULL);
+    expect_bool(__LINE__, true,
+                strstr(json, "\"context_switches\":0}}}\n") != NULL);
+    free(json);
+
+    // NULL is ignored, for tests without scoreboard
+    WorkerSlot_setState(NULL, WS_BUSY);
+    WorkerSlot_countRequest(NULL, "200", 1);
+    WorkerSlot_countCache(NULL, true);
+    WorkerSlot_countPerf(NULL, PP_PARSE, before, after);
+
+    delete_Scoreboard(board);
+    free(ex);
+}
+
+void run_all_test_metrics() {
+    test_WorkerSlot();
+}
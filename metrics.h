@@ -0,0 +1,104 @@
+/** @file
+ * provides a scoreboard of workers in shared memory.
+ */
+#pragma once
+
+#include "histogram.h"
+#include "perf.h"
+#include "util.h"
+
+#include <stdalign.h>  // alignas
+#include <stdatomic.h> // _Atomic
+#include <stdint.h>    // uint64_t
+#include <stdio.h>     // FILE
+
+// clang-format off
+#define STATUS_URI      "/server-status" ///< the URL of the scoreboard
+#define CACHE_LINE_SIZE 64
+#define LARGE_TRANSFER  (1024 * 1024) ///< the least bytes to record the rate
+// clang-format on
+
+/// state of a worker
+typedef enum {
+    WS_IDLE,      ///< waiting for a connection
+    WS_KEEPALIVE, ///< waiting for the next request on a connection
+    WS_BUSY,      ///< handling a request
+} WorkerState;
+
+/// phase of a request, to which PerfCounters are attributed
+typedef enum {
+    PP_PARSE, ///< HttpMessage_parse()
+    PP_BUILD, ///< building the response
+    PP_WRITE, ///< writing the response
+    PP_LOG,   ///< writing the access log
+    PP_NPHASES,
+} PerfPhase;
+
+const char *PerfPhase_name(PerfPhase phase);
+
+/** @struct WorkerSlot
+ * @brief Counters of a worker.
+ *
+ * A slot is written only by its worker, and read by any worker to render the
+ * scoreboard. Slots are aligned to cache lines, so that workers never write
+ * to the same line.
+ *
+ * \li WorkerSlot_setState()
+ * \li WorkerSlot_countRequest()
+ * \li WorkerSlot_countCache()
+ * \li WorkerSlot_countFileCache()
+ * \li WorkerSlot_recordLatency()
+ * \li WorkerSlot_countPerf()
+ */
+typedef struct {
+    alignas(CACHE_LINE_SIZE) _Atomic uint64_t requests;
+    _Atomic uint64_t bytes_sent;
+    _Atomic uint64_t responses[5]; ///< by status class, 1xx to 5xx
+    _Atomic uint64_t connections;  ///< connections accepted
+    _Atomic uint64_t cache_hits;
+    _Atomic uint64_t cache_misses;
+    _Atomic uint64_t file_cache_hits;
+    _Atomic uint64_t file_cache_misses;
+    _Atomic int state; ///< WorkerState
+
+    Histogram request_time;    ///< ns from the first byte to the last byte
+    Histogram first_byte_time; ///< ns to the first byte of the response
+    Histogram transfer_rate;   ///< bytes per second of large transfers
+
+    _Atomic uint64_t perf[PP_NPHASES][PE_NEVENTS]; ///< PerfEvent by phase
+} WorkerSlot;
+
+void WorkerSlot_setState(WorkerSlot *, WorkerState state);
+void WorkerSlot_countRequest(WorkerSlot *, const char *status_code,
+                             uint64_t bytes);
+void WorkerSlot_countCache(WorkerSlot *, bool hit);
+void WorkerSlot_countFileCache(WorkerSlot *, bool hit);
+void WorkerSlot_recordLatency(WorkerSlot *, uint64_t request_ns,
+                              uint64_t first_byte_ns, uint64_t bytes,
+                              uint64_t send_ns);
+void WorkerSlot_countPerf(WorkerSlot *, PerfPhase phase,
+                          const uint64_t before[PE_NEVENTS],
+                          const uint64_t after[PE_NEVENTS]);
+
+/** @struct Scoreboard
+ * @brief Slots of workers in memory shared by processes. It must be created
+ * before fork(2).
+ *
+ * \li new_Scoreboard()
+ * \li delete_Scoreboard()
+ * \li Scoreboard_render() renders the aggregate in Prometheus text format or
+ * JSON.
+ * \li Scoreboard_dump() prints the percentiles of latency.
+ */
+typedef struct {
+    int nslots;
+    WorkerSlot *slots;
+    bool perf; ///< renders the counters of PerfEvent by PerfPhase
+} Scoreboard;
+
+Scoreboard *new_Scoreboard(int nslots, Exception *ex);
+void delete_Scoreboard(Scoreboard *);
+char *Scoreboard_render(Scoreboard *, bool json);
+void Scoreboard_dump(Scoreboard *, FILE *out);
+
+void run_all_test_metrics();
@@ -0,0 +1,214 @@
+#include "mime.h"
+#include "file.h"
+#include "stats.h"
+#include "util.h"
+
+#include <stdint.h>  // uint32_t
+#include <stdio.h>   // getline(3)
+#include <stdlib.h>  // free(3)
+#include <string.h>  // strtok_r(3)
+#include <strings.h> // strncasecmp(3)
+#include <unistd.h>  // unlink(2)
+
+#include "mime_table.h"
+
+static MimeEntry *Overrides; // of mime_load(), open addressing, or NULL
+static int NOverrides;       // the number of the slots, a power of 2
+
+static bool match(const char *key, const char *ext, size_t len) {
+    return key != NULL && strncasecmp(key, ext, len) == 0 && key[len] == '\0';
+}
+
+/**
+ * Looks up the media type of the extension, in the ones loaded by
+ * mime_load() first, and then in the table generated by mimegen. The case of
+ * the extension is ignored.
+ *
+ * @return the media type, or NULL if the extension is unknown
+ * @param ext the extension without the dot, not necessarily terminated
+ * @param len the length of the extension
+ */
+const char *mime_lookup(const char *ext, size_t len) {
+    uint32_t h = strcase_hash(ext, len, 0);
+
+    if (Overrides != NULL) {
+        for (int i = h & (NOverrides - 1); Overrides[i].ext != NULL;
+             i = (i + 1) & (NOverrides - 1))
+            if (match(Overrides[i].ext, ext, len))
+                return Overrides[i].type;
+    }
+
+    uint32_t seed = MimeSeeds[h % MIME_NBUCKETS];
+    const MimeEntry *e = &MimeSlots[strcase_hash(ext, len, seed) % MIME_NSLOTS];
+    return match(e->ext, ext, len) ? e->type : NULL;
+}
+
+/**
+ * Returns the media type of the file by the extension of its name.
+ *
+ * @return the media type, or MIME_DEFAULT_TYPE if the extension is unknown
+ * @param path the path of the file
+ */
+const char *mime_type(const char *path) {
+    PathSlice ext = extension_slice(path);
+
+    if (ext.off == -1)
+        return MIME_DEFAULT_TYPE;
+    const char *type = mime_lookup(path + ext.off, ext.len);
+    return type != NULL ? type : MIME_DEFAULT_TYPE;
+}
+
+/// puts the entry into Overrides, replacing the one of the same extension
+static void put_override(const char *ext, const char *type) {
+    uint32_t h = strcase_hash(ext, strlen(ext), 0);
+    int i = h & (NOverrides - 1);
+
+    while (Overrides[i].ext != NULL &&
+           !match(Overrides[i].ext, ext, strlen(ext)))
+        i = (i + 1) & (NOverrides - 1);
+    Overrides[i].ext = ext;
+    Overrides[i].type = type;
+}
+
+/**
+ * Loads media types from the file of the format of mime.types(5), which
+ * override the ones of the table. A later line overrides an earlier one.
+ * Called before workers start, and the loaded types live as long as the
+ * process.
+ *
+ * @param path the path of the file
+ * @param ex E_Failure if the file cannot be read
+ */
+void mime_load(const char *path, Exception *ex) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        ex->ty = E_Failure;
+        ex->msg = "fopen";
+        return;
+    }
+
+    // the ones loaded before, and then the ones of the file
+    Vector *entries = new_Vector();
+    for (int i = 0; i < NOverrides; i++)
+        if (Overrides[i].ext != NULL)
+            Vector_push(entries, memcpy(malloc(sizeof(MimeEntry)),
+                                        &Overrides[i], sizeof(MimeEntry)));
+
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, in) != -1) {
+        char *p = strchr(line, '#');
+        if (p != NULL)
+            *p = '\0';
+
+        char *save;
+        char *type = strtok_r(line, " \t\r\n", &save);
+        if (type == NULL)
+            continue;
+        type = strdup(type);
+        char *ext;
+        while ((ext = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+            MimeEntry *e = malloc(sizeof(MimeEntry));
+            e->ext = strdup(ext);
+            e->type = type;
+            Vector_push(entries, e);
+        }
+    }
+    free(line);
+    fclose(in);
+
+    // loaded up to 50%, so that probes are short
+    free(Overrides);
+    NOverrides = 8;
+    while (NOverrides < entries->len * 2)
+        NOverrides *= 2;
+    Overrides = calloc(NOverrides, sizeof(MimeEntry));
+    for (int i = 0; i < entries->len; i++) {
+        MimeEntry *e = entries->data[i];
+        put_override(e->ext, e->type);
+    }
+    delete_Vector(entries);
+}
+
+static void test_mime_type() {
+    // clang-format off
+    expect_str(__LINE__, "text/html",  mime_type("www/index.html"));
+    expect_str(__LINE__, "text/html",  mime_type("/index.html"));
+    expect_str(__LINE__, "text/html",  mime_type("/INDEX.HTML"));
+    expect_str(__LINE__, "text/css",   mime_type("www/css/style.css"));
+    expect_str(__LINE__, "image/png",  mime_type("www/img/logo.png"));
+    expect_str(__LINE__, "text/plain", mime_type("www/extless"));
+    expect_str(__LINE__, "text/plain", mime_type("www.d/extless"));
+    expect_str(__LINE__, "text/plain", mime_type("a.unknownext"));
+    expect_str(__LINE__, "text/plain", mime_type(".dotfile"));
+    expect_str(__LINE__, "text/plain", mime_type("index."));
+    // clang-format on
+}
+
+/// every extension of the table is found in its slot
+static void test_mime_lookup() {
+    int n = 0;
+
+    for (int i = 0; i < MIME_NSLOTS; i++) {
+        const MimeEntry *e = &MimeSlots[i];
+        if (e->ext == NULL)
+            continue;
+        expect_str(__LINE__, e->type, mime_lookup(e->ext, strlen(e->ext)));
+        n++;
+    }
+    expect_bool(__LINE__, true, n > 200);
+
+    expect_str(__LINE__, "application/json", mime_lookup("json.gz", 4));
+    expect_ptr(__LINE__, NULL, mime_lookup("js", 1));
+    expect_ptr(__LINE__, NULL, mime_lookup("", 0));
+}
+
+static void test_mime_load() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    char path[] = "/tmp/dali_mime_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "w");
+    fprintf(f, "# overrides\n"
+               "text/x-custom\tfoo  BAR\n"
+               "\n"
+               "application/xhtml+xml html # comment\n"
+               "text/x-other foo\n");
+    fclose(f);
+
+    mime_load(path, ex);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect_str(__LINE__, "text/x-other", mime_type("a.foo"));
+    expect_str(__LINE__, "text/x-custom", mime_type("a.bar"));
+    expect_str(__LINE__, "application/xhtml+xml", mime_type("a.html"));
+    expect_str(__LINE__, "text/css", mime_type("a.css"));
+
+    // not found
+    mime_load("/tmp/dali_mime_not_found", ex);
+    expect(__LINE__, E_Failure, ex->ty);
+
+    // the table is as generated without overrides
+    free(Overrides);
+    Overrides = NULL;
+    NOverrides = 0;
+    expect_str(__LINE__, "text/html", mime_type("a.html"));
+
+    unlink(path);
+    free(ex);
+}
+
+void run_all_test_mime() {
+    test_mime_type();
+    test_mime_lookup();
+    test_mime_load();
+}
+
+static void bench_mime_type(void *arg, long n) {
+    static char *paths[] = {"www/index.html", "www/css/style.css",
+                            "www/img/logo.png", "www/README"};
+    for (long i = 0; i < n; i++)
+        BenchSink += (uintptr_t)mime_type(paths[i % 4]);
+}
+
+void run_all_bench_mime() {
+    bench("mime_type", bench_mime_type, NULL);
+}
@@ -0,0 +1,29 @@
+/** @file
+ * provides media types of files by their extensions.
+ *
+ * The table of extensions is a perfect hash generated from mime.types by
+ * mimegen at build time, and mime_load() overrides it at runtime. Lookups do
+ * not allocate.
+ */
+#pragma once
+
+#include "util.h"
+
+#include <stddef.h> // size_t
+
+// clang-format off
+#define MIME_DEFAULT_TYPE "text/plain" ///< the type of unknown extensions
+// clang-format on
+
+/// an extension and its media type
+typedef struct {
+    const char *ext;
+    const char *type;
+} MimeEntry;
+
+const char *mime_type(const char *path);
+const char *mime_lookup(const char *ext, size_t len);
+void mime_load(const char *path, Exception *ex);
+
+void run_all_test_mime();
+void run_all_bench_mime();
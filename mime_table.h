@@ -0,0 +1,542 @@
+/** @file
+ * the table of media types of mime.c, generated by mimegen from mime.types.
+ * do not edit.
+ */
+// clang-format off
+#define MIME_NBUCKETS 128 ///< buckets of the first level
+#define MIME_NSLOTS   512 ///< slots of the second level
+
+static const uint32_t MimeSeeds[MIME_NBUCKETS] = {
+    7, 4, 8, 1, 8, 7, 16, 58,
+    2, 17, 5, 2, 6, 15, 10, 7,
+    6, 11, 6, 9, 15, 2, 10, 15,
+    12, 0, 5, 46, 28, 53, 10, 3,
+    1, 13, 3, 13, 4, 24, 7, 1,
+    4, 1, 10, 3, 12, 3, 31, 12,
+    1, 3, 5, 1, 40, 22, 2, 9,
+    18, 5, 51, 2, 1, 3, 1, 29,
+    8, 2, 9, 39, 37, 7, 1, 2,
+    14, 1, 2, 7, 2, 19, 9, 6,
+    6, 50, 14, 8, 9, 41, 33, 2,
+    2, 2, 11, 3, 5, 42, 4, 4,
+    19, 11, 15, 12, 22, 36, 5, 16,
+    75, 9, 26, 2, 58, 52, 83, 19,
+    155, 12, 3, 6, 30, 13, 11, 2,
+    12, 20, 0, 9, 1, 23, 143, 1,
+};
+
+static const MimeEntry MimeSlots[MIME_NSLOTS] = {
+    {"snd", "audio/basic"},
+    {"sco", "audio/csound"},
+    {"gv", "text/vnd.graphviz"},
+    {"nef", "image/x-nikon-nef"},
+    {"tcl", "text/x-tcl"},
+    {"sh", "application/x-sh"},
+    {"htc", "text/x-component"},
+    {"sql", "application/sql"},
+    {"tag", "text/prs.lines.tag"},
+    {"erf", "image/x-epson-erf"},
+    {NULL, NULL},
+    {"m4u", "video/vnd.mpegurl"},
+    {NULL, NULL},
+    {"s14", "video/vnd.sealed.mpeg4"},
+    {"iso", "application/x-iso9660-image"},
+    {"3dml", "text/vnd.in3d.3dml"},
+    {"m4s", "video/iso.segment"},
+    {"pot", "text/plain"},
+    {"orc", "audio/csound"},
+    {"eot", "application/vnd.ms-fontobject"},
+    {"spo", "text/vnd.in3d.spot"},
+    {"mj2", "video/mj2"},
+    {"viv", "video/vnd.vivo"},
+    {"tif", "image/tiff"},
+    {"brf", "text/plain"},
+    {"cpt", "image/x-corelphotopaint"},
+    {"h++", "text/x-c++hdr"},
+    {"dxf", "image/vnd.dxf"},
+    {"uvi", "image/vnd.dece.graphic"},
+    {"uri", "text/uri-list"},
+    {NULL, NULL},
+    {"ccc", "text/vnd.net2phone.commcenter.command"},
+    {"plj", "audio/vnd.everad.plj"},
+    {"lsx", "video/x-la-asf"},
+    {"cgm", "image/cgm"},
+    {"miz", "text/mizar"},
+    {"hif", "image/avif"},
+    {"uvvs", "video/vnd.dece.sd"},
+    {"fli", "video/fli"},
+    {"heic", "image/heic"},
+    {NULL, NULL},
+    {"ico", "image/vnd.microsoft.icon"},
+    {"mp3", "audio/mpeg"},
+    {"copyright", "text/vnd.debian.copyright"},
+    {"uvm", "video/vnd.dece.mobile"},
+    {NULL, NULL},
+    {NULL, NULL},
+    {NULL, NULL},
+    {"bin", "application/octet-stream"},
+    {"rpm", "application/x-rpm"},
+    {"adts", "audio/aac"},
+    {NULL, NULL},
+    {"msp", "application/octet-stream"},
+    {"axv", "video/annodex"},
+    {"cls", "text/x-tex"},
+    {"apk", "application/vnd.android.package-archive"},
+    {"fly", "text/vnd.fly"},
+    {"wmf", "image/wmf"},
+    {"abc", "text/vnd.abc"},
+    {"flx", "text/vnd.fmi.flexstor"},
+    {"csvs", "text/csv-schema"},
+    {"xlt", "application/vnd.ms-excel"},
+    {"pat", "image/x-coreldrawpattern"},
+    {"wgsl", "text/wgsl"},
+    {"sgml", "text/SGML"},
+    {"smv", "audio/SMV"},
+    {"smp3", "audio/vnd.sealedmedia.softseal.mpeg"},
+    {"xlc", "application/vnd.ms-excel"},
+    {"axa", "audio/annodex"},
+    {"xslt", "application/xslt+xml"},
+    {"pyv", "video/vnd.ms-playready.media.pyv"},
+    {"cr2", "image/x-canon-cr2"},
+    {"p", "text/x-pascal"},
+    {"sty", "text/x-tex"},
+    {NULL, NULL},
+    {"latex", "application/x-latex"},
+    {"bat", "application/x-msdos-program"},
+    {"jxss", "image/jxss"},
+    {NULL, NULL},
+    {"csd", "audio/csound"},
+    {"mpf", "text/vnd.ms-mediapackage"},
+    {"d", "text/x-dsrc"},
+    {"psd", "image/vnd.adobe.photoshop"},
+    {"lhs", "text/x-literate-haskell"},
+    {"awb", "audio/AMR-WB"},
+    {"sgm", "text/SGML"},
+    {"tar", "application/x-tar"},
+    {"deploy", "application/octet-stream"},
+    {"csv", "text/csv"},
+    {"sjpg", "image/vnd.sealedmedia.softseal.jpg"},
+    {"mc2", "text/vnd.senx.warpscript"},
+    {"jxsc", "image/jxsc"},
+    {NULL, NULL},
+    {"pya", "audio/vnd.ms-playready.media.pya"},
+    {"provn", "text/provenance-notation"},
+    {NULL, NULL},
+    {"eps2", "application/postscript"},
+    {"shc", "text/shaclc"},
+    {"wax", "audio/x-ms-wax"},
+    {NULL, NULL},
+    {"jtd", "text/vnd.esmertec.theme-descriptor"},
+    {"curl", "text/vnd.curl"},
+    {"xpm", "image/x-xpixmap"},
+    {"msu", "application/octet-stream"},
+    {"hgl", "text/vnd.hgl"},
+    {"s1g", "image/vnd.sealedmedia.softseal.gif"},
+    {"webp", "image/webp"},
+    {"s11", "video/vnd.sealed.mpeg1"},
+    {"uvg", "image/vnd.dece.graphic"},
+    {"eps3", "application/postscript"},
+    {"uvvh", "video/vnd.dece.hd"},
+    {"epsf", "application/postscript"},
+    {"jph", "image/jph"},
+    {NULL, NULL},
+    {"mpe", "video/mpeg"},
+    {"tex", "text/x-tex"},
+    {NULL, NULL},
+    {"xml", "application/xml"},
+    {"uvs", "video/vnd.dece.sd"},
+    {"tfx", "image/tiff-fx"},
+    {"emf", "image/emf"},
+    {"png", "image/png"},
+    {"xla", "application/vnd.ms-excel"},
+    {"heif", "image/heif"},
+    {NULL, NULL},
+    {"uvva", "audio/vnd.dece.audio"},
+    {"pgb", "image/vnd.globalgraphics.pgb"},
+    {"n3", "text/n3"},
+    {"css", "text/css"},
+    {NULL, NULL},
+    {"jpg2", "image/jp2"},
+    {"csh", "text/x-csh"},
+    {"mhas", "audio/mhas"},
+    {"hans", "text/vnd.hans"},
+    {"pls", "audio/x-scpls"},
+    {NULL, NULL},
+    {NULL, NULL},
+    {"cpio", "application/x-cpio"},
+    {"mpg", "video/mpeg"},
+    {NULL, NULL},
+    {"apng", "image/apng"},
+    {"at3", "audio/ATRAC3"},
+    {"shex", "text/shex"},
+    {NULL, NULL},
+    {"text", "text/plain"},
+    {"torrent", "application/x-bittorrent"},
+    {"cql", "text/cql"},
+    {"mkv", "video/x-matroska"},
+    {"tk", "text/x-tcl"},
+    {"s1n", "image/vnd.sealed.png"},
+    {"sofa", "audio/sofa"},
+    {NULL, NULL},
+    {NULL, NULL},
+    {"hh", "text/x-c++hdr"},
+    {"uris", "text/uri-list"},
+    {"eps", "application/postscript"},
+    {"aac", "audio/aac"},
+    {"mid", "audio/sp-midi"},
+    {NULL, NULL},
+    {"ttf", "font/ttf"},
+    {"drle", "image/dicom-rle"},
+    {"xhe", "audio/usac"},
+    {"m1v", "video/mpeg"},
+    {"smp", "audio/vnd.sealedmedia.softseal.mpeg"},
+    {"pcx", "image/vnd.zbrush.pcx"},
+    {"avci", "image/avci"},
+    {"spx", "audio/ogg"},
+    {"geojson", "application/geo+json"},
+    {"atom", "application/atom+xml"},
+    {"m2v", "video/mpeg"},
+    {"sgi", "image/vnd.sealedmedia.softseal.gif"},
+    {"smk", "video/vnd.radgamettools.smacker"},
+    {"markdown", "text/markdown"},
+    {"heifs", "image/heif-sequence"},
+    {"aiff", "audio/x-aiff"},
+    {"s1j", "image/vnd.sealedmedia.softseal.jpg"},
+    {"mjs", "text/javascript"},
+    {"webm", "video/webm"},
+    {"pas", "text/x-pascal"},
+    {"odp", "application/vnd.oasis.opendocument.presentation"},
+    {NULL, NULL},
+    {"patch", "text/x-diff"},
+    {"ics", "text/calendar"},
+    {"uvh", "video/vnd.dece.hd"},
+    {"aa3", "audio/ATRAC3"},
+    {"ogg", "audio/ogg"},
+    {"btif", "image/prs.btif"},
+    {"ass", "audio/aac"},
+    {NULL, NULL},
+    {"wm", "video/x-ms-wm"},
+    {"moc", "text/x-moc"},
+    {NULL, NULL},
+    {"djv", "image/vnd.djvu"},
+    {"lbc", "audio/iLBC"},
+    {NULL, NULL},
+    {"sos", "text/vnd.sosi"},
+    {"s1m", "audio/vnd.sealedmedia.softseal.mpeg"},
+    {"fts", "image/fits"},
+    {"sig", "application/pgp-signature"},
+    {"p7s", "application/pkcs7-signature"},
+    {"jpgm", "image/jpm"},
+    {"gff3", "text/gff3"},
+    {NULL, NULL},
+    {"shtml", "text/html"},
+    {"yaml", "application/yaml"},
+    {"pgm", "image/x-portable-graymap"},
+    {"rgb", "image/x-rgb"},
+    {"vcs", "text/x-vcalendar"},
+    {"jxsi", "image/jxsi"},
+    {"multitrack", "audio/vnd.presonus.multitrack"},
+    {"gl", "video/gl"},
+    {"ttl", "text/turtle"},
+    {"yt", "video/vnd.youtube.yt"},
+    {"xht", "application/xhtml+xml"},
+    {"wasm", "application/wasm"},
+    {"xlw", "application/vnd.ms-excel"},
+    {"rip", "audio/vnd.rip"},
+    {"rss", "application/rss+xml"},
+    {"vcf", "text/vcard"},
+    {"nim", "video/vnd.nokia.interleaved-multimedia"},
+    {"msi", "application/x-msi"},
+    {NULL, NULL},
+    {"wav", "audio/x-wav"},
+    {"omg", "audio/ATRAC3"},
+    {"jxrs", "image/jxrS"},
+    {"si", "text/vnd.wap.si"},
+    {"bz2", "application/x-bzip2"},
+    {NULL, NULL},
+    {"726", "audio/32kadpcm"},
+    {"uva", "audio/vnd.dece.audio"},
+    {"sjp", "image/vnd.sealedmedia.softseal.jpg"},
+    {"dls", "audio/dls"},
+    {"dsc", "text/prs.lines.tag"},
+    {NULL, NULL},
+    {"uvvm", "video/vnd.dece.mobile"},
+    {"com", "application/x-msdos-program"},
+    {"xif", "image/vnd.xiff"},
+    {"spdx", "text/spdx"},
+    {"sgif", "image/vnd.sealedmedia.softseal.gif"},
+    {"xz", "application/x-xz"},
+    {"deb", "application/x-debian-package"},
+    {NULL, NULL},
+    {"fst", "image/vnd.fst"},
+    {"uvvi", "image/vnd.dece.graphic"},
+    {"xyze", "image/vnd.radiance"},
+    {NULL, NULL},
+    {"bik", "video/vnd.radgamettools.bink"},
+    {"mp2", "audio/mpeg"},
+    {"vtf", "image/vnd.valve.source.texture"},
+    {"uvvp", "video/vnd.dece.pd"},
+    {"c", "text/x-csrc"},
+    {"crt", "application/x-x509-ca-cert"},
+    {"koz", "audio/vnd.audiokoz"},
+    {"mpga", "audio/mpeg"},
+    {"ra", "audio/x-pn-realaudio"},
+    {"webmanifest", "application/manifest+json"},
+    {"boo", "text/x-boo"},
+    {"ascii", "text/vnd.ascii-art"},
+    {"txt", "text/plain"},
+    {"lzh", "application/x-lzh"},
+    {"ecelp4800", "audio/vnd.nuera.ecelp4800"},
+    {"dtshd", "audio/vnd.dts.hd"},
+    {"lsf", "video/x-la-asf"},
+    {"dwg", "image/vnd.dwg"},
+    {"srt", "text/plain"},
+    {"hsj2", "image/hsj2"},
+    {"kmz", "application/vnd.google-earth.kmz"},
+    {"heics", "image/heic-sequence"},
+    {"azv", "image/vnd.airzip.accelerator.azv"},
+    {"jxl", "image/jxl"},
+    {"gz", "application/gzip"},
+    {"hej2", "image/hej2k"},
+    {"mxmf", "audio/mobile-xmf"},
+    {"jpx", "image/jpx"},
+    {"rar", "application/vnd.rar"},
+    {"ppm", "image/x-portable-pixmap"},
+    {NULL, NULL},
+    {"acn", "audio/asc"},
+    {"aif", "audio/x-aiff"},
+    {"wml", "text/vnd.wap.wml"},
+    {"tsv", "text/tab-separated-values"},
+    {"cnd", "text/jcr-cnd"},
+    {"rtf", "application/rtf"},
+    {"aal", "audio/ATRAC-ADVANCED-LOSSLESS"},
+    {"dot", "text/vnd.graphviz"},
+    {"cdt", "image/x-coreldrawtemplate"},
+    {"avi", "video/x-msvideo"},
+    {"mpd", "application/dash+xml"},
+    {"ged", "text/vnd.familysearch.gedcom"},
+    {"jp2", "image/jp2"},
+    {NULL, NULL},
+    {"sswf", "video/vnd.sealed.swf"},
+    {"ltx", "text/x-tex"},
+    {NULL, NULL},
+    {"jhc", "image/jphc"},
+    {"ttc", "font/collection"},
+    {"mov", "video/quicktime"},
+    {"dll", "application/x-msdos-program"},
+    {"pdf", "application/pdf"},
+    {"smov", "video/vnd.sealedmedia.softseal.mov"},
+    {"bmp", "image/bmp"},
+    {"pm", "text/x-perl"},
+    {NULL, NULL},
+    {"oga", "audio/ogg"},
+    {"dts", "audio/vnd.dts"},
+    {"epsi", "application/postscript"},
+    {NULL, NULL},
+    {"rm", "audio/x-pn-realaudio"},
+    {"jar", "application/java-archive"},
+    {"atx", "audio/ATRAC-X"},
+    {"mxu", "video/vnd.mpegurl"},
+    {"movie", "video/x-sgi-movie"},
+    {"opus", "audio/ogg"},
+    {"fpx", "image/vnd.fpx"},
+    {"mpv", "video/x-matroska"},
+    {"fit", "image/fits"},
+    {"ly", "text/x-lilypond"},
+    {"hxx", "text/x-c++hdr"},
+    {"cdr", "image/x-coreldraw"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"spng", "image/vnd.sealed.png"},
+    {"flt", "text/vnd.ficlab.flt"},
+    {"dif", "video/dv"},
+    {"uvvg", "image/vnd.dece.graphic"},
+    {"rlc", "image/vnd.fujixerox.edmics-rlc"},
+    {"3dm", "text/vnd.in3d.3dml"},
+    {"evb", "audio/EVRCB"},
+    {"dmg", "application/x-apple-diskimage"},
+    {"pps", "application/vnd.ms-powerpoint"},
+    {"xcf", "image/x-xcf"},
+    {"c++", "text/x-c++src"},
+    {"xwd", "image/x-xwindowdump"},
+    {NULL, NULL},
+    {"lvp", "audio/vnd.lucent.voice"},
+    {"ram", "audio/x-pn-realaudio"},
+    {"exr", "image/aces"},
+    {NULL, NULL},
+    {"enw", "audio/EVRCNW"},
+    {"xsl", "application/xslt+xml"},
+    {"vtt", "text/vtt"},
+    {"etx", "text/x-setext"},
+    {"vcard", "text/vcard"},
+    {"uvu", "video/vnd.dece.mp4"},
+    {"jpf", "image/jpx"},
+    {"exe", "application/x-msdos-program"},
+    {"wma", "audio/x-ms-wma"},
+    {"mml", "application/mathml+xml"},
+    {"m3u", "audio/mpegurl"},
+    {"jxs", "image/jxs"},
+    {"wmv", "video/x-ms-wmv"},
+    {"html", "text/html"},
+    {"jpm", "image/jpm"},
+    {"tiff", "image/tiff"},
+    {"otf", "font/otf"},
+    {"vfk", "text/vnd.exchangeable"},
+    {"wmx", "video/x-ms-wmx"},
+    {"jxr", "image/jxr"},
+    {"ifb", "text/calendar"},
+    {"xls", "application/vnd.ms-excel"},
+    {"avif", "image/avif"},
+    {"sfv", "text/x-sfv"},
+    {"mp1", "audio/mpeg"},
+    {"rst", "text/prs.fallenstein.rst"},
+    {"odt", "application/vnd.oasis.opendocument.text"},
+    {"epub", "application/epub+zip"},
+    {"psid", "audio/prs.sid"},
+    {"pl", "text/x-perl"},
+    {"ief", "image/ief"},
+    {"pti", "image/prs.pti"},
+    {"au", "audio/basic"},
+    {"bib", "text/x-bibtex"},
+    {"h", "text/x-chdr"},
+    {"wvx", "video/x-ms-wvx"},
+    {NULL, NULL},
+    {"jng", "image/x-jng"},
+    {"mmr", "image/vnd.fujixerox.edmics-mmr"},
+    {"loas", "audio/usac"},
+    {"bk2", "video/vnd.radgamettools.bink"},
+    {"gsm", "audio/x-gsm"},
+    {"jpg", "image/jpeg"},
+    {"flac", "audio/flac"},
+    {"jphc", "image/jphc"},
+    {NULL, NULL},
+    {"avcs", "image/avcs"},
+    {NULL, NULL},
+    {"wbmp", "image/vnd.wap.wbmp"},
+    {"appcache", "text/cache-manifest"},
+    {"ods", "application/vnd.oasis.opendocument.spreadsheet"},
+    {"zip", "application/zip"},
+    {"yml", "application/yaml"},
+    {"fvt", "video/vnd.fvt"},
+    {"aifc", "audio/x-aiff"},
+    {"json", "application/json"},
+    {"smpg", "video/vnd.sealed.mpeg1"},
+    {"woff2", "font/woff2"},
+    {"diff", "text/x-diff"},
+    {"amr", "audio/AMR"},
+    {"7z", "application/x-7z-compressed"},
+    {"cpp", "text/x-c++src"},
+    {"vbk", "audio/vnd.nortel.vbk"},
+    {NULL, NULL},
+    {"gif", "image/gif"},
+    {"ogx", "application/ogg"},
+    {"m4v", "video/mp4"},
+    {NULL, NULL},
+    {"spot", "text/vnd.in3d.spot"},
+    {"qcp", "audio/EVRC-QCP"},
+    {"doc", "application/msword"},
+    {NULL, NULL},
+    {"py", "text/x-python"},
+    {"mjp2", "video/mj2"},
+    {"m4a", "audio/mp4"},
+    {"uvvv", "video/vnd.dece.video"},
+    {"cxx", "text/x-c++src"},
+    {"uvvu", "video/vnd.dece.mp4"},
+    {"xbm", "image/x-xbitmap"},
+    {"cc", "text/x-c++src"},
+    {"flv", "video/x-flv"},
+    {NULL, NULL},
+    {NULL, NULL},
+    {"woff", "font/woff"},
+    {NULL, NULL},
+    {"mp4", "video/mp4"},
+    {"ktx2", "image/ktx2"},
+    {"tr", "text/troff"},
+    {"ppt", "application/vnd.ms-powerpoint"},
+    {"xlm", "application/vnd.ms-excel"},
+    {"ktx", "image/ktx"},
+    {"rgbe", "image/vnd.radiance"},
+    {"pbm", "image/x-portable-bitmap"},
+    {"djvu", "image/vnd.djvu"},
+    {"mpg4", "video/mp4"},
+    {NULL, NULL},
+    {"pnm", "image/x-portable-anymap"},
+    {"sd2", "audio/x-sd2"},
+    {"soa", "text/dns"},
+    {"jad", "text/vnd.sun.j2me.app-descriptor"},
+    {"uvp", "video/vnd.dece.pd"},
+    {"es", "text/javascript"},
+    {"l16", "audio/L16"},
+    {NULL, NULL},
+    {NULL, NULL},
+    {"art", "image/x-jg"},
+    {"fits", "image/fits"},
+    {"ts", "text/vnd.trolltech.linguist"},
+    {"shaclc", "text/shaclc"},
+    {"mdi", "image/vnd.ms-modi"},
+    {"ai", "application/postscript"},
+    {"spn", "image/vnd.sealed.png"},
+    {"manifest", "text/cache-manifest"},
+    {"js", "text/javascript"},
+    {"md", "text/markdown"},
+    {"wmls", "text/vnd.wap.wmlscript"},
+    {"hs", "text/x-haskell"},
+    {"zst", "application/zstd"},
+    {"ac3", "audio/ac3"},
+    {NULL, NULL},
+    {"ssw", "video/vnd.sealed.swf"},
+    {"ecelp9600", "audio/vnd.nuera.ecelp9600"},
+    {"jfif", "image/jpeg"},
+    {"xhtm", "application/xhtml+xml"},
+    {"jls", "image/jls"},
+    {"tap", "image/vnd.tencent.tap"},
+    {"jpeg", "image/jpeg"},
+    {"smo", "video/vnd.sealedmedia.softseal.mov"},
+    {"svg", "image/svg+xml"},
+    {"svgz", "image/svg+xml"},
+    {"java", "text/x-java"},
+    {"evw", "audio/EVRCWB"},
+    {"jsonld", "application/ld+json"},
+    {"xhtml", "application/xhtml+xml"},
+    {NULL, NULL},
+    {"jpe", "image/jpeg"},
+    {"orf", "image/x-olympus-orf"},
+    {"mlp", "audio/vnd.dolby.mlp"},
+    {"fbs", "image/vnd.fastbidsheet"},
+    {"b16", "image/vnd.pco.b16"},
+    {"ecelp7470", "audio/vnd.nuera.ecelp7470"},
+    {"ps", "application/postscript"},
+    {"s1q", "video/vnd.sealedmedia.softseal.mov"},
+    {"mpega", "audio/mpeg"},
+    {"sl", "text/vnd.wap.sl"},
+    {"mpeg", "video/mpeg"},
+    {"zone", "text/dns"},
+    {"scala", "text/x-scala"},
+    {"hdr", "image/vnd.radiance"},
+    {"dpx", "image/dpx"},
+    {NULL, NULL},
+    {"a", "text/vnd.a"},
+    {"t", "text/troff"},
+    {"qt", "video/quicktime"},
+    {"roff", "text/troff"},
+    {"dms", "text/vnd.DMClientScript"},
+    {"ogv", "video/ogg"},
+    {NULL, NULL},
+    {"eol", "audio/vnd.digital-winds"},
+    {"sid", "audio/prs.sid"},
+    {"mng", "video/x-mng"},
+    {"btf", "image/prs.btif"},
+    {"hpp", "text/x-c++hdr"},
+    {"htm", "text/html"},
+    {"dv", "video/dv"},
+    {"crw", "image/x-canon-crw"},
+    {"dvb", "video/vnd.dvb.file"},
+    {"kml", "application/vnd.google-earth.kml+xml"},
+    {"gcd", "text/x-pcs-gcd"},
+    {NULL, NULL},
+    {"uvv", "video/vnd.dece.video"},
+    {"evc", "audio/EVRC"},
+    {"tm", "text/texmacs"},
+    {"jxra", "image/jxrA"},
+    {"ras", "image/x-cmu-raster"},
+};
+// clang-format on
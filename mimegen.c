@@ -0,0 +1,179 @@
+/** @file
+ * mimegen - generates the table of media types of mime.c.
+ *
+ * Usage: mimegen FILE
+ *
+ * Reads FILE of the format of mime.types(5), a media type and zero or more
+ * extensions per line, and writes the table as C source to the standard
+ * output.
+ *
+ * The table is a perfect hash of two levels (hash and displace). An extension
+ * falls into a bucket by strcase_hash() of seed 0, and into a slot by
+ * strcase_hash() of the seed of the bucket. Seeds are searched bucket by
+ * bucket, the largest first, so that no two extensions share a slot. A lookup
+ * computes two hashes and compares one extension.
+ *
+ * Exits with failure if FILE has an extension twice.
+ */
+#include "mime.h"
+#include "util.h"
+
+#include <ctype.h>  // tolower(3)
+#include <errno.h>  // errno
+#include <stdio.h>  // getline(3)
+#include <stdlib.h> // qsort(3)
+#include <string.h> // strtok_r(3)
+
+#define MAX_SEED (1 << 24) ///< seeds searched for a bucket
+
+static const char *Path;
+
+/// reads the entries of the file into a Vector of MimeEntry
+static Vector *read_entries(FILE *in) {
+    Vector *entries = new_Vector();
+    char *line = NULL;
+    size_t cap = 0;
+    int lineno = 0;
+
+    while (getline(&line, &cap, in) != -1) {
+        lineno++;
+        char *p = strchr(line, '#');
+        if (p != NULL)
+            *p = '\0';
+
+        char *save;
+        char *type = strtok_r(line, " \t\r\n", &save);
+        if (type == NULL)
+            continue;
+        char *ext;
+        while ((ext = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+            if (strpbrk(type, "\"\\") != NULL || strpbrk(ext, "\"\\") != NULL)
+                error("Error: %s:%d: invalid character", Path, lineno);
+            for (p = ext; *p; p++)
+                *p = tolower((unsigned char)*p);
+            for (int i = 0; i < entries->len; i++) {
+                MimeEntry *e = entries->data[i];
+                if (strcmp(e->ext, ext) == 0)
+                    error("Error: %s:%d: duplicate extension: %s", Path,
+                          lineno, ext);
+            }
+
+            MimeEntry *e = malloc(sizeof(MimeEntry));
+            e->ext = strdup(ext);
+            e->type = strdup(type);
+            Vector_push(entries, e);
+        }
+    }
+    free(line);
+    return entries;
+}
+
+static Vector **Buckets; // of indices of entries, for compare_size()
+
+/// orders buckets by the number of entries, the largest first
+static int compare_size(const void *a, const void *b) {
+    return Buckets[*(int *)b]->len - Buckets[*(int *)a]->len;
+}
+
+/**
+ * Searches the seed of the bucket whose entries fall into free and distinct
+ * slots, and takes the slots.
+ *
+ * @return the seed
+ */
+static uint32_t place(Vector *entries, Vector *bucket, const MimeEntry **slots,
+                      int nslots) {
+    int index[bucket->len];
+
+    for (uint32_t seed = 1; seed < MAX_SEED; seed++) {
+        int i;
+        for (i = 0; i < bucket->len; i++) {
+            const MimeEntry *e = entries->data[*(int *)bucket->data[i]];
+            index[i] = strcase_hash(e->ext, strlen(e->ext), seed) % nslots;
+            if (slots[index[i]] != NULL)
+                break;
+            int j;
+            for (j = 0; j < i && index[j] != index[i]; j++)
+                ;
+            if (j < i)
+                break;
+        }
+        if (i < bucket->len)
+            continue;
+
+        for (i = 0; i < bucket->len; i++)
+            slots[index[i]] = entries->data[*(int *)bucket->data[i]];
+        return seed;
+    }
+    error("Error: %s: no perfect hash is found", Path);
+}
+
+static void print_table(uint32_t *seeds, int nbuckets,
+                        const MimeEntry **slots, int nslots) {
+    printf("/** @file\n"
+           " * the table of media types of mime.c, generated by mimegen from "
+           "%s.\n"
+           " * do not edit.\n"
+           " */\n"
+           "// clang-format off\n"
+           "#define MIME_NBUCKETS %d ///< buckets of the first level\n"
+           "#define MIME_NSLOTS   %d ///< slots of the second level\n"
+           "\n",
+           Path, nbuckets, nslots);
+
+    printf("static const uint32_t MimeSeeds[MIME_NBUCKETS] = {");
+    for (int i = 0; i < nbuckets; i++)
+        printf("%s%u,", i % 8 == 0 ? "\n    " : " ", seeds[i]);
+    printf("\n};\n\n");
+
+    printf("static const MimeEntry MimeSlots[MIME_NSLOTS] = {\n");
+    for (int i = 0; i < nslots; i++) {
+        if (slots[i] == NULL)
+            printf("    {NULL, NULL},\n");
+        else
+            printf("    {\"%s\", \"%s\"},\n", slots[i]->ext, slots[i]->type);
+    }
+    printf("};\n"
+           "// clang-format on\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage:\n%s FILE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    Path = argv[1];
+
+    FILE *in = fopen(Path, "r");
+    if (in == NULL)
+        error("Error: fopen: %s: %s", Path, strerror(errno));
+    Vector *entries = read_entries(in);
+    fclose(in);
+
+    // slots are loaded up to 90%, and buckets have 4 slots on average
+    int nslots = 8;
+    while (nslots * 9 < entries->len * 10)
+        nslots *= 2;
+    int nbuckets = nslots / 4;
+
+    Buckets = calloc(nbuckets, sizeof(Vector *));
+    int *order = malloc(nbuckets * sizeof(int));
+    for (int i = 0; i < nbuckets; i++) {
+        Buckets[i] = new_Vector();
+        order[i] = i;
+    }
+    for (int i = 0; i < entries->len; i++) {
+        const MimeEntry *e = entries->data[i];
+        int b = strcase_hash(e->ext, strlen(e->ext), 0) % nbuckets;
+        Vector_push(Buckets[b], intdup(i));
+    }
+    qsort(order, nbuckets, sizeof(int), compare_size);
+
+    uint32_t *seeds = calloc(nbuckets, sizeof(uint32_t));
+    const MimeEntry **slots = calloc(nslots, sizeof(MimeEntry *));
+    for (int i = 0; i < nbuckets && Buckets[order[i]]->len > 0; i++)
+        seeds[order[i]] = place(entries, Buckets[order[i]], slots, nslots);
+
+    print_table(seeds, nbuckets, slots, nslots);
+    return EXIT_SUCCESS;
+}
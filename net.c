@@ -1,10 +1,14 @@
 #include "net.h"
+#include "stats.h"
 #include "util.h"
 
 #include <assert.h>    // assert(3)
+#include <stdarg.h>    // va_start(3)
 #include <fcntl.h>     // open(2)
+#include <netinet/tcp.h> // TCP_NODELAY
 #include <stdlib.h>    // malloc(3)
 #include <string.h>    // strdup(3)
+#include <sys/socket.h> // socketpair(2)
 #include <sys/stat.h>  // oepn(2)
 #include <sys/types.h> // open(2)
 #include <unistd.h>    // unlink(2)
@@ -28,11 +32,12 @@ static Socket *new_Socket(SocketType ty) {
  * @param sock the pointer to Socket
  */
 void delete_Socket(Socket *sock) {
-    if (sock->_ty == S_CLT) {
-        fclose(sock->ips);
+    if (sock->ops != NULL)
         fclose(sock->ops);
-    }
-    close(sock->_fd);
+    if (sock->ips != NULL)
+        fclose(sock->ips);
+    if (sock->ips == NULL && sock->ops == NULL && sock->_fd >= 0)
+        close(sock->_fd);
 
     free(sock->addr);
     free(sock);
@@ -76,6 +81,22 @@ Socket *new_ServerSocket(int port, Exception *ex) {
     return sv_sock;
 }
 
+/// opens the input and the output streams of the connected socket
+static void open_streams(Socket *sock, Exception *ex) {
+    sock->ips = fdopen(sock->_fd, "r");
+    if (sock->ips == NULL) {
+        ex->ty = E_Failure;
+        ex->msg = "fdopen";
+        return;
+    }
+
+    sock->ops = fdopen(sock->_fd, "w");
+    if (sock->ops == NULL) {
+        ex->ty = E_Failure;
+        ex->msg = "fdopen";
+    }
+}
+
 /**
  * Accepts a connection on Socket object
  *
@@ -94,20 +115,29 @@ Socket *ServerSocket_accept(Socket *self, Exception *ex) {
         return sock;
     }
 
-    sock->ips = fdopen(sock->_fd, "r");
-    if (sock->ips == NULL) {
-        ex->ty = E_Failure;
-        ex->msg = "fdopen";
-        return sock;
-    }
+    // the headers are flushed before the body is sent by sendfile(2), which
+    // must not wait for the delayed ACK of the client.
+    int one = 1;
+    setsockopt(sock->_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
-    sock->ops = fdopen(sock->_fd, "w");
-    if (sock->ops == NULL) {
-        ex->ty = E_Failure;
-        ex->msg = "fdopen";
-        return sock;
-    }
+    open_streams(sock, ex);
+    return sock;
+}
+
+/**
+ * Creates a new Socket object of a connected descriptor, e.g. an end of
+ * socketpair(2). The address is 0.0.0.0, unless set.
+ *
+ * @return a new connected Socket object, which owns the descriptor
+ * @param fd the descriptor
+ * @param ex the pointer to Exception object
+ */
+Socket *new_ConnectedSocket(int fd, Exception *ex) {
+    Socket *sock = new_Socket(S_CLT);
 
+    sock->_fd = fd;
+    sock->addr->sin_family = AF_INET;
+    open_streams(sock, ex);
     return sock;
 }
 
@@ -174,6 +204,40 @@ void url_decode(char *dest, const char *src) {
     *dest = '\0';
 }
 
+/**
+ * Canonicalizes the absolute path in place, in a single pass: collapses
+ * repeated '/', and removes "." segments, and ".." segments with their
+ * parents, e.g. "/a/./b//../c" into "/a/c". A trailing '/' is kept.
+ *
+ * @return false if the path is not absolute, or a ".." goes above the root
+ * @param path the path, never longer after canonicalization
+ */
+bool path_canonicalize(char *path) {
+    if (path[0] != '/')
+        return false;
+
+    // w follows a '/' of the output, and r is the next segment of the input
+    char *w = path + 1;
+    for (char *r = path + 1; *r;) {
+        size_t len = strcspn(r, "/");
+        if (len == 2 && r[0] == '.' && r[1] == '.') {
+            if (w == path + 1)
+                return false;
+            for (w--; w[-1] != '/'; w--)
+                ;
+        } else if (len > 0 && !(len == 1 && r[0] == '.')) {
+            memmove(w, r, len);
+            w += len;
+            if (r[len] == '/')
+                *w++ = '/';
+        }
+        r += r[len] == '/' ? len + 1 : len;
+    }
+    *w = '\0';
+
+    return true;
+}
+
 //
 // http
 //
@@ -193,6 +257,7 @@ HttpMessage *new_HttpMessage(HttpMessageType ty) {
     HttpMessage *result = calloc(1, sizeof(HttpMessage));
     result->_ty = ty;
     result->header_map = new_Map();
+    result->body_fd = -1;
     return result;
 }
 
@@ -208,6 +273,7 @@ void delete_HttpMessage(HttpMessage *msg) {
     }
 
     // start-line(Request-Line|Status-Line)
+    free(msg->request_line);
     free(msg->method);
     free(msg->request_uri);
     free(msg->http_version);
@@ -219,6 +285,14 @@ void delete_HttpMessage(HttpMessage *msg) {
 
     // message-body
     free(msg->body);
+    if (msg->body_parts != NULL) {
+        for (int i = 0; i < msg->body_parts->len; i++)
+            free(((BodyPart *)msg->body_parts->data[i])->buf);
+        delete_Vector(msg->body_parts);
+    }
+    if (msg->body_fd != -1)
+        close(msg->body_fd);
+    free(msg->body_arg);
 
     // utilities
     free(msg->filename);
@@ -264,6 +338,295 @@ HttpMessage *HttpMessage_parse(FILE *f, HttpMessageType ty, Exception *ex,
     return msg;
 }
 
+static void append_part(HttpMessage *msg, char *buf, off_t offset,
+                        off_t len) {
+    BodyPart *part = malloc(sizeof(BodyPart));
+    part->buf = buf;
+    part->offset = offset;
+    part->len = len;
+
+    if (msg->body_parts == NULL)
+        msg->body_parts = new_Vector();
+    Vector_push(msg->body_parts, part);
+    msg->body_len += len;
+}
+
+/**
+ * Appends a copy of the string to the body parts.
+ *
+ * @param msg
+ * @param text
+ */
+void HttpMessage_appendText(HttpMessage *msg, const char *text) {
+    append_part(msg, strdup(text), 0, strlen(text));
+}
+
+/**
+ * Appends a range of body_fd to the body parts. The range is sent without
+ * copying it to the user space.
+ *
+ * @param msg
+ * @param offset offset of the range in body_fd
+ * @param len length of the range
+ */
+void HttpMessage_appendRange(HttpMessage *msg, off_t offset, off_t len) {
+    append_part(msg, NULL, offset, len);
+}
+
+/**
+ * Sets the producer which generates the body when the message is written.
+ * The length of the body need not be known in advance.
+ *
+ * @param msg
+ * @param producer
+ * @param arg argument passed to the producer, freed with the message
+ */
+void HttpMessage_setProducer(HttpMessage *msg, BodyProducer producer,
+                             void *arg) {
+    msg->body_producer = producer;
+    msg->body_arg = arg;
+}
+
+/**
+ * Creates a new ChunkedWriter object.
+ *
+ * @return a pointer to a new ChunkedWriter object
+ * @param out the stream to write
+ * @param chunked true to apply the chunked transfer-coding
+ */
+ChunkedWriter *new_ChunkedWriter(FILE *out, bool chunked) {
+    ChunkedWriter *w = calloc(1, sizeof(ChunkedWriter));
+    w->_out = out;
+    w->_chunked = chunked;
+    return w;
+}
+
+/**
+ * Destroys the ChunkedWriter object.
+ *
+ * @param w
+ */
+void delete_ChunkedWriter(ChunkedWriter *w) {
+    free(w);
+}
+
+static void flush_chunk(ChunkedWriter *w) {
+    if (w->_len == 0)
+        return;
+
+    if (w->_chunked)
+        w->written += fprintf(w->_out, "%x\r\n", w->_len) + 2;
+    w->written += fwrite(w->_buf, 1, w->_len, w->_out);
+    if (w->_chunked)
+        fputs("\r\n", w->_out);
+    fflush(w->_out);
+    w->_len = 0;
+}
+
+/**
+ * Writes the buffer to the body.
+ *
+ * @param w
+ * @param buf
+ * @param len length of buf
+ */
+void ChunkedWriter_write(ChunkedWriter *w, const char *buf, size_t len) {
+    while (len > 0) {
+        size_t n = sizeof(w->_buf) - w->_len;
+        if (n > len)
+            n = len;
+        memcpy(w->_buf + w->_len, buf, n);
+        w->_len += n;
+        buf += n;
+        len -= n;
+
+        if (w->_len == sizeof(w->_buf))
+            flush_chunk(w);
+    }
+}
+
+/**
+ * Writes the formatted string to the body.
+ *
+ * @param w
+ * @param fmt format string of printf(3)
+ */
+void ChunkedWriter_printf(ChunkedWriter *w, const char *fmt, ...) {
+    char buf[1024];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (len >= sizeof(buf)) {
+        char *p = malloc(len + 1);
+        va_start(ap, fmt);
+        vsnprintf(p, len + 1, fmt, ap);
+        va_end(ap);
+        ChunkedWriter_write(w, p, len);
+        free(p);
+        return;
+    }
+    ChunkedWriter_write(w, buf, len);
+}
+
+/**
+ * Writes the buffered data and the last-chunk.
+ *
+ * @param w
+ */
+void ChunkedWriter_close(ChunkedWriter *w) {
+    flush_chunk(w);
+    if (w->_chunked) {
+        fputs("0\r\n\r\n", w->_out);
+        w->written += 5;
+    }
+    fflush(w->_out);
+}
+
+/**
+ * Parses the field-value of Range.
+ *
+ * byte-ranges-specifier = "bytes=" byte-range-set
+ * byte-range-set  = 1#( byte-range-spec / suffix-byte-range-spec )
+ * byte-range-spec = first-byte-pos "-" [ last-byte-pos ]
+ * suffix-byte-range-spec = "-" suffix-length
+ *
+ * @return the number of satisfiable ranges stored to ranges,
+ * -1 if the field-value is invalid or has more than MAX_RANGES ranges.
+ * @param field_value the field-value of Range
+ * @param size the length of the representation
+ * @param ranges array of MAX_RANGES ByteRange to store the result
+ *
+ * @see https://www.rfc-editor.org/rfc/rfc7233.html
+ */
+int parse_ranges(const char *field_value, off_t size, ByteRange *ranges) {
+    const char *p = field_value;
+    int n = 0, nspec = 0;
+
+    if (strncmp(p, "bytes=", strlen("bytes=")) != 0)
+        return -1;
+    p += strlen("bytes=");
+
+    while (true) {
+        off_t first = -1, last = -1;
+        char *end;
+
+        while (*p == ' ')
+            p++;
+        if ('0' <= *p && *p <= '9') {
+            first = strtoll(p, &end, 10);
+            p = end;
+        }
+        if (*p++ != '-')
+            return -1;
+        if ('0' <= *p && *p <= '9') {
+            last = strtoll(p, &end, 10);
+            p = end;
+        }
+        while (*p == ' ')
+            p++;
+
+        if (first == -1 && last == -1)
+            return -1;
+        if (first != -1 && last != -1 && last < first)
+            return -1;
+        if (++nspec > MAX_RANGES)
+            return -1;
+
+        if (first == -1) { // suffix-byte-range-spec
+            if (last > 0 && size > 0) {
+                ranges[n].first = last < size ? size - last : 0;
+                ranges[n].last = size - 1;
+                n++;
+            }
+        } else if (first < size) {
+            ranges[n].first = first;
+            ranges[n].last = (last == -1 || last >= size) ? size - 1 : last;
+            n++;
+        }
+
+        if (*p == '\0')
+            break;
+        if (*p++ != ',')
+            return -1;
+    }
+
+    return n;
+}
+
+/**
+ * Parses HTTP-date in the form of IMF-fixdate.
+ *
+ * e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+ *
+ * @return true if the date is valid.
+ * @param str HTTP-date
+ * @param t the parsed time
+ */
+bool parse_http_date(const char *str, time_t *t) {
+    static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct tm tm = {0};
+    char wday[4], mon[4];
+    int n;
+
+    if (sscanf(str, "%3s, %2d %3s %4d %2d:%2d:%2d GMT%n", wday, &tm.tm_mday,
+               mon, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec,
+               &n) != 7 ||
+        str[n] != '\0')
+        return false;
+
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(mon, months[i]) == 0)
+            tm.tm_mon = i;
+    }
+    if (tm.tm_mon == -1)
+        return false;
+    tm.tm_year -= 1900;
+
+    *t = timegm(&tm);
+    return true;
+}
+
+/**
+ * Returns true if the list of entity-tags matches the entity-tag using the
+ * weak comparison. A suffix of the entity-tag after '-', which denotes
+ * content-coding, is ignored.
+ *
+ * @return true if the entity-tag is in the list or the list is "*"
+ * @param field_value the field-value of If-None-Match
+ * @param etag the entity-tag of the file
+ *
+ * @see https://www.rfc-editor.org/rfc/rfc7232.html#section-2.3.2
+ */
+bool etag_match(const char *field_value, const char *etag) {
+    const char *p = field_value;
+    int len = strlen(etag) - 1; // without closing DQUOTE
+
+    while (*p) {
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (*p == '*')
+            return true;
+        if (strncmp(p, "W/", 2) == 0)
+            p += 2;
+        if (strncmp(p, etag, len) == 0 && (p[len] == '"' || p[len] == '-'))
+            return true;
+
+        // skip the entity-tag
+        if (*p == '"')
+            p = strchr(p + 1, '"');
+        if (p == NULL)
+            return false;
+        while (*p && *p != ',')
+            p++;
+    }
+    return false;
+}
+
 static void request_line(FILE *f, HttpMessage *msg, Exception *ex) {
     char *p, *p0;
 
@@ -316,10 +679,13 @@ static void request_line(FILE *f, HttpMessage *msg, Exception *ex) {
     msg->filename = strdup(msg->request_uri);
     if ((p = strchr(msg->filename, '?')) != NULL)
         *p = '\0';
+    if (msg->method_ty != HMMT_UNKNOWN && !path_canonicalize(msg->filename))
+        goto bad_request;
 
     // query_str
     // msg->query_str = strdup(++p);
 
+    free(line);
     return;
 
 bad_request:
@@ -338,8 +704,10 @@ static void message_header(FILE *f, HttpMessage *msg, Exception *ex) {
     char *p, *line;
 
     while ((line = read_line(f)) != NULL) {
-        if (strlen(line) == 0)
+        if (strlen(line) == 0) {
+            free(line);
             break;
+        }
 
         // key
         if ((p = strchr(line, ':')) == NULL)
@@ -356,11 +724,11 @@ static void message_header(FILE *f, HttpMessage *msg, Exception *ex) {
         value = strdup(p);
 
         Map_put(msg->header_map, key, value);
-        free(line);
 
         // empty key is invalid
         if (strlen(key) == 0)
             goto bad_request;
+        free(line);
     }
     return;
 
@@ -449,6 +817,177 @@ static void test_url_decode() {
     expect_str(__LINE__, "%3", buf);
 }
 
+static void test_path_canonicalize() {
+    const char *cases[][2] = {
+        // clang-format off
+        {"/",              "/"},
+        {"/index.html",    "/index.html"},
+        {"//index.html",   "/index.html"},
+        {"/a//b/",         "/a/b/"},
+        {"/./a/./b/.",     "/a/b/"},
+        {"/a/../b",        "/b"},
+        {"/a/b/../../c/",  "/c/"},
+        {"/a/..",          "/"},
+        {"/a/b/..",        "/a/"},
+        {"/..a/b../.a.",   "/..a/b../.a."},
+        // clang-format on
+    };
+    char buf[100];
+
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        strcpy(buf, cases[i][0]);
+        expect_bool(__LINE__, true, path_canonicalize(buf));
+        expect_str(__LINE__, cases[i][1], buf);
+    }
+
+    // escapes and relative paths
+    strcpy(buf, "/..");
+    expect_bool(__LINE__, false, path_canonicalize(buf));
+    strcpy(buf, "/a/../../etc/passwd");
+    expect_bool(__LINE__, false, path_canonicalize(buf));
+    strcpy(buf, "//../a");
+    expect_bool(__LINE__, false, path_canonicalize(buf));
+    strcpy(buf, "a/b");
+    expect_bool(__LINE__, false, path_canonicalize(buf));
+    strcpy(buf, "");
+    expect_bool(__LINE__, false, path_canonicalize(buf));
+}
+
+static void test_parse_ranges() {
+    ByteRange r[MAX_RANGES];
+
+    // clang-format off
+    expect(__LINE__, 1,   parse_ranges("bytes=0-9", 100, r));
+    expect(__LINE__, 0,   r[0].first);
+    expect(__LINE__, 9,   r[0].last);
+
+    expect(__LINE__, 1,   parse_ranges("bytes=90-", 100, r));
+    expect(__LINE__, 90,  r[0].first);
+    expect(__LINE__, 99,  r[0].last);
+
+    expect(__LINE__, 1,   parse_ranges("bytes=-10", 100, r));
+    expect(__LINE__, 90,  r[0].first);
+    expect(__LINE__, 99,  r[0].last);
+
+    // last-byte-pos and suffix-length are truncated
+    expect(__LINE__, 1,   parse_ranges("bytes=50-1000", 100, r));
+    expect(__LINE__, 99,  r[0].last);
+    expect(__LINE__, 1,   parse_ranges("bytes=-1000", 100, r));
+    expect(__LINE__, 0,   r[0].first);
+
+    // multiple ranges
+    expect(__LINE__, 3,   parse_ranges("bytes=0-0, 10-19,-1", 100, r));
+    expect(__LINE__, 10,  r[1].first);
+    expect(__LINE__, 19,  r[1].last);
+    expect(__LINE__, 99,  r[2].first);
+
+    // unsatisfiable ranges are dropped
+    expect(__LINE__, 1,   parse_ranges("bytes=100-,0-0", 100, r));
+    expect(__LINE__, 0,   parse_ranges("bytes=100-199", 100, r));
+    expect(__LINE__, 0,   parse_ranges("bytes=-0", 100, r));
+
+    // invalid
+    expect(__LINE__, -1,  parse_ranges("items=0-9", 100, r));
+    expect(__LINE__, -1,  parse_ranges("bytes=", 100, r));
+    expect(__LINE__, -1,  parse_ranges("bytes=-", 100, r));
+    expect(__LINE__, -1,  parse_ranges("bytes=9-0", 100, r));
+    expect(__LINE__, -1,  parse_ranges("bytes=0-9;", 100, r));
+    expect(__LINE__, -1,  parse_ranges("bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,"
+                                       "7-7,8-8,9-9,10-10,11-11,12-12,13-13,"
+                                       "14-14,15-15,16-16", 100, r));
+    // clang-format on
+}
+
+static void test_parse_http_date() {
+    time_t t;
+
+    expect_bool(__LINE__, true,
+                parse_http_date("Thu, 01 Jan 1970 00:00:00 GMT", &t));
+    expect(__LINE__, 0, t);
+    expect_bool(__LINE__, true,
+                parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT", &t));
+    expect(__LINE__, 784111777, t);
+
+    // invalid
+    expect_bool(__LINE__, false,
+                parse_http_date("Sun, 06 Nov 1994 08:49:37", &t));
+    expect_bool(__LINE__, false,
+                parse_http_date("Sun, 06 Foo 1994 08:49:37 GMT", &t));
+    expect_bool(__LINE__, false,
+                parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT+", &t));
+    expect_bool(__LINE__, false,
+                parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT", &t));
+    expect_bool(__LINE__, false, parse_http_date("", &t));
+}
+
+static void test_etag_match() {
+    // clang-format off
+    expect_bool(__LINE__, true,  etag_match("\"1-2-3\"", "\"1-2-3\""));
+    expect_bool(__LINE__, true,  etag_match("*", "\"1-2-3\""));
+    expect_bool(__LINE__, true,  etag_match("W/\"1-2-3\"", "\"1-2-3\""));
+    expect_bool(__LINE__, true,  etag_match("\"x\", \"1-2-3\"", "\"1-2-3\""));
+    expect_bool(__LINE__, true,  etag_match("\"1-2-3-gzip\"", "\"1-2-3\""));
+    expect_bool(__LINE__, false, etag_match("\"1-2-4\"", "\"1-2-3\""));
+    expect_bool(__LINE__, false, etag_match("\"1-2-34\"", "\"1-2-3\""));
+    expect_bool(__LINE__, false, etag_match("\"1-2-3", "\"1-2-3-4\""));
+    expect_bool(__LINE__, false, etag_match("", "\"1-2-3\""));
+    // clang-format on
+}
+
+static void test_ChunkedWriter() {
+    char buf[8192];
+    FILE *f;
+    ChunkedWriter *w;
+
+    // chunked
+    f = tmpfile();
+    w = new_ChunkedWriter(f, true);
+    ChunkedWriter_write(w, "Hello", 5);
+    ChunkedWriter_printf(w, ", %s!", "World");
+    ChunkedWriter_close(w);
+    expect(__LINE__, 23, w->written);
+    delete_ChunkedWriter(w);
+    rewind(f);
+    buf[fread(buf, 1, sizeof(buf) - 1, f)] = '\0';
+    expect_str(__LINE__, "d\r\nHello, World!\r\n0\r\n\r\n", buf);
+    fclose(f);
+
+    // larger than the buffer
+    f = tmpfile();
+    w = new_ChunkedWriter(f, true);
+    for (int i = 0; i < 4097; i++)
+        ChunkedWriter_write(w, "a", 1);
+    ChunkedWriter_close(w);
+    delete_ChunkedWriter(w);
+    rewind(f);
+    expect_str(__LINE__, "1000\r\n", fgets(buf, sizeof(buf), f));
+    fseek(f, 4096 + 2, SEEK_CUR);
+    expect_str(__LINE__, "1\r\n", fgets(buf, sizeof(buf), f));
+    fclose(f);
+
+    // empty body
+    f = tmpfile();
+    w = new_ChunkedWriter(f, true);
+    ChunkedWriter_close(w);
+    delete_ChunkedWriter(w);
+    rewind(f);
+    buf[fread(buf, 1, sizeof(buf) - 1, f)] = '\0';
+    expect_str(__LINE__, "0\r\n\r\n", buf);
+    fclose(f);
+
+    // not chunked
+    f = tmpfile();
+    w = new_ChunkedWriter(f, false);
+    ChunkedWriter_printf(w, "%d", 42);
+    ChunkedWriter_close(w);
+    expect(__LINE__, 2, w->written);
+    delete_ChunkedWriter(w);
+    rewind(f);
+    buf[fread(buf, 1, sizeof(buf) - 1, f)] = '\0';
+    expect_str(__LINE__, "42", buf);
+    fclose(f);
+}
+
 static void test_read_line() {
     char *str = "HTTP/1.1 200 OK\r\n";
     FILE *f = tmpfile();
@@ -508,6 +1047,20 @@ static void test_HttpMessage_parse() {
     expect(__LINE__, HMMT_HEAD, req->method_ty);
     delete_HttpMessage(req);
 
+    //
+    // Normal(non-canonical path)
+    //
+    f = tmpfile();
+    fprintf(f, "GET //a/./b/../hello.html?q=/.. HTTP/1.1\r\n"
+               "\r\n");
+    rewind(f);
+    req = HttpMessage_parse(f, HM_REQ, ex, false);
+    fclose(f);
+    expect(__LINE__, E_Okay, ex->ty);
+    expect_str(__LINE__, "//a/./b/../hello.html?q=/..", req->request_uri);
+    expect_str(__LINE__, "/a/hello.html", req->filename);
+    delete_HttpMessage(req);
+
     //-----------
     // Irregular
     //-----------
@@ -545,6 +1098,18 @@ static void test_HttpMessage_parse() {
     fclose(f);
     expect(__LINE__, HM_BadRequest, ex->ty);
 
+    //
+    // path above the document root, encoded
+    //
+    f = tmpfile();
+    fprintf(f, "GET /a/%%2e%%2e/../etc/passwd HTTP/1.1\r\n"
+               "Host: localhost\r\n"
+               "\r\n");
+    rewind(f);
+    req = HttpMessage_parse(f, HM_REQ, ex, false);
+    fclose(f);
+    expect(__LINE__, HM_BadRequest, ex->ty);
+
     //
     // Empty key in message-header
     //
@@ -559,8 +1124,107 @@ static void test_HttpMessage_parse() {
     expect(__LINE__, HMMT_GET, req->method_ty);
 }
 
+static void test_ConnectedSocket() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    int fds[2];
+    char buf[16];
+
+    expect(__LINE__, 0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    Socket *sock = new_ConnectedSocket(fds[0], ex);
+    expect(__LINE__, E_Okay, ex->ty);
+
+    expect(__LINE__, 5, write(fds[1], "ping\n", 5));
+    expect_str(__LINE__, "ping\n", fgets(buf, sizeof(buf), sock->ips));
+    fputs("pong\n", sock->ops);
+    fflush(sock->ops);
+    expect(__LINE__, 5, read(fds[1], buf, sizeof(buf)));
+    expect(__LINE__, 'p', buf[0]);
+
+    delete_Socket(sock);
+    expect(__LINE__, 0, read(fds[1], buf, sizeof(buf))); // closed
+    close(fds[1]);
+    free(ex);
+}
+
 void run_all_test_net() {
     test_url_decode();
+    test_path_canonicalize();
+    test_parse_ranges();
+    test_parse_http_date();
+    test_etag_match();
+    test_ChunkedWriter();
     test_read_line();
     test_HttpMessage_parse();
+    test_ConnectedSocket();
+}
+
+static void bench_url_decode(void *arg, long n) {
+    char buf[256];
+    for (long i = 0; i < n; i++) {
+        url_decode(buf, "/search%20results/caf%C3%A9+menu%3Fday%3Dmonday.html");
+        BenchSink += buf[0];
+    }
+}
+
+/// requests recorded from clients
+static const char *Corpus[] = {
+    // curl
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "User-Agent: curl/7.68.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+    // a browser
+    "GET /css/style.css?v=20201013 HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/86.0.4240.75 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Referer: http://localhost:8088/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: ja,en-US;q=0.9,en;q=0.8\r\n"
+    "If-None-Match: \"5f85a2b8-1a2b\"\r\n"
+    "If-Modified-Since: Tue, 13 Oct 2020 11:51:20 GMT\r\n"
+    "\r\n",
+    // a download manager
+    "GET /files/dali%202020-10.tar.gz HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "User-Agent: Wget/1.20.3 (linux-gnu)\r\n"
+    "Accept: */*\r\n"
+    "Accept-Encoding: identity\r\n"
+    "Range: bytes=1048576-\r\n"
+    "Connection: Keep-Alive\r\n"
+    "\r\n",
+};
+
+/// parses the requests of Corpus in turn
+static void bench_HttpMessage_parse(void *arg, long n) {
+    int ncorpus = sizeof(Corpus) / sizeof(*Corpus);
+    FILE *f[ncorpus];
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    for (int i = 0; i < ncorpus; i++)
+        f[i] = fmemopen((void *)Corpus[i], strlen(Corpus[i]), "r");
+
+    for (long i = 0; i < n; i++) {
+        FILE *in = f[i % ncorpus];
+        rewind(in);
+        ex->ty = E_Okay;
+        HttpMessage *req = HttpMessage_parse(in, HM_REQ, ex, false);
+        BenchSink += req->method_ty;
+        delete_HttpMessage(req);
+    }
+
+    for (int i = 0; i < ncorpus; i++)
+        fclose(f[i]);
+    free(ex);
+}
+
+void run_all_bench_net() {
+    bench("url_decode", bench_url_decode, NULL);
+    bench("HttpMessage_parse", bench_HttpMessage_parse, NULL);
 }
@@ -8,6 +8,8 @@
 #include <netinet/in.h> // socklen_t
 #include <stdbool.h>    // bool
 #include <stdio.h>      // FILE
+#include <sys/types.h>  // off_t
+#include <time.h>       // time_t
 
 /* general net lib */
 
@@ -33,8 +35,10 @@ typedef struct {
 Socket *new_ServerSocket(int, Exception *);
 void delete_Socket(Socket *);
 Socket *ServerSocket_accept(Socket *, Exception *);
+Socket *new_ConnectedSocket(int fd, Exception *);
 
 void url_decode(char *dest, const char *src);
+bool path_canonicalize(char *path);
 
 /* http lib */
 
@@ -51,6 +55,43 @@ typedef enum {
     HMMT_UNKNOWN, ///< not implemented method
 } HttpMessageMethodType;
 
+/// a part of message-body
+typedef struct {
+    char *buf;    ///< data on memory, or NULL if the part is a range of body_fd
+    off_t offset; ///< offset of the range in body_fd
+    off_t len;    ///< length of the part
+} BodyPart;
+
+/** @struct ChunkedWriter
+ * @brief A writer of message-body whose length is not known in advance.
+ *
+ * Written data is buffered and sent as a chunk of the chunked
+ * transfer-coding, or as is if the connection is closed to delimit the body.
+ *
+ * \li new_ChunkedWriter()
+ * \li delete_ChunkedWriter()
+ * \li ChunkedWriter_write()
+ * \li ChunkedWriter_printf()
+ * \li ChunkedWriter_close() writes the last-chunk.
+ */
+typedef struct {
+    off_t written; ///< bytes written to the stream, including chunk framing
+
+    FILE *_out;
+    bool _chunked;
+    char _buf[4096];
+    int _len;
+} ChunkedWriter;
+
+ChunkedWriter *new_ChunkedWriter(FILE *out, bool chunked);
+void delete_ChunkedWriter(ChunkedWriter *);
+void ChunkedWriter_write(ChunkedWriter *, const char *buf, size_t len);
+void ChunkedWriter_printf(ChunkedWriter *, const char *fmt, ...);
+void ChunkedWriter_close(ChunkedWriter *);
+
+/// generates message-body on writing the message.
+typedef void (*BodyProducer)(ChunkedWriter *, void *arg);
+
 /**
  * HTTP-message    = Request | Response
  *
@@ -93,13 +134,34 @@ typedef struct {
     Map *header_map;
 
     // message-body
-    char *body;
-    int body_len;
+    char *body;         // whole body on memory, or NULL
+    off_t body_len;     // length of body, or sum of body_parts
+    Vector *body_parts; // BodyPart list, used if body is NULL
+    int body_fd;        // file which body_parts refer to, or -1
+    BodyProducer body_producer; // generates body of unknown length, or NULL
+    void *body_arg;             // argument of body_producer, freed with msg
 
 } HttpMessage;
 
 HttpMessage *new_HttpMessage(HttpMessageType ty);
 void delete_HttpMessage(HttpMessage *);
 HttpMessage *HttpMessage_parse(FILE *, HttpMessageType, Exception *, bool);
+void HttpMessage_appendText(HttpMessage *, const char *);
+void HttpMessage_appendRange(HttpMessage *, off_t offset, off_t len);
+void HttpMessage_setProducer(HttpMessage *, BodyProducer, void *arg);
+
+/// the maximum number of ranges in a Range header field
+#define MAX_RANGES 16
+
+/// byte-range-spec with resolved positions
+typedef struct {
+    off_t first; ///< first-byte-pos
+    off_t last;  ///< last-byte-pos, inclusive
+} ByteRange;
+
+int parse_ranges(const char *field_value, off_t size, ByteRange *ranges);
+bool parse_http_date(const char *, time_t *);
+bool etag_match(const char *field_value, const char *etag);
 
 void run_all_test_net();
+void run_all_bench_net();
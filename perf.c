@@ -0,0 +1,172 @@
+#include "perf.h"
+#include "util.h"
+
+#include <linux/perf_event.h> // perf_event_attr
+#include <stdlib.h>           // calloc(3)
+#include <string.h>           // memset(3)
+#include <sys/ioctl.h>        // ioctl(2)
+#include <sys/syscall.h>      // SYS_perf_event_open
+#include <unistd.h>           // syscall(2)
+
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} Events[PE_NEVENTS] = {
+    [PE_CYCLES] = {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PE_INSTRUCTIONS] = {"instructions", PERF_TYPE_HARDWARE,
+                         PERF_COUNT_HW_INSTRUCTIONS},
+    [PE_CACHE_MISSES] = {"cache_misses", PERF_TYPE_HARDWARE,
+                         PERF_COUNT_HW_CACHE_MISSES},
+    [PE_BRANCH_MISSES] = {"branch_misses", PERF_TYPE_HARDWARE,
+                          PERF_COUNT_HW_BRANCH_MISSES},
+    [PE_CONTEXT_SWITCHES] = {"context_switches", PERF_TYPE_SOFTWARE,
+                             PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+/**
+ * Returns the name of the event.
+ *
+ * @return e.g. "cycles"
+ * @param ev
+ */
+const char *PerfEvent_name(PerfEvent ev) {
+    return Events[ev].name;
+}
+
+static int perf_event_open(struct perf_event_attr *attr, int group_fd) {
+    return syscall(SYS_perf_event_open, attr, 0 /* this process */,
+                   -1 /* any cpu */, group_fd, 0);
+}
+
+/**
+ * Opens the counters on the calling process. The first event opened leads
+ * the group.
+ *
+ * @return a pointer to a new PerfCounters object
+ * @param ex a pointer to Exception, E_Failure if no event can be counted,
+ * e.g. perf_event_paranoid forbids or the system has no PMU.
+ */
+PerfCounters *new_PerfCounters(Exception *ex) {
+    PerfCounters *pc = calloc(1, sizeof(PerfCounters));
+    int leader = -1;
+
+    for (int i = 0; i < PE_NEVENTS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = Events[i].type;
+        attr.config = Events[i].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = leader == -1; // the group starts with the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        pc->_fds[i] = perf_event_open(&attr, leader);
+        pc->_index[i] = -1;
+        if (pc->_fds[i] == -1)
+            continue;
+        if (leader == -1)
+            leader = pc->_fds[i];
+        pc->_index[i] = pc->_nopen++;
+    }
+
+    if (leader == -1) {
+        ex->ty = E_Failure;
+        ex->msg = "perf_event_open";
+        return pc;
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return pc;
+}
+
+/**
+ * Closes the counters and destroys the PerfCounters object.
+ *
+ * @param pc
+ */
+void delete_PerfCounters(PerfCounters *pc) {
+    // members first, then the leader
+    for (int i = PE_NEVENTS - 1; i >= 0; i--)
+        if (pc->_fds[i] != -1)
+            close(pc->_fds[i]);
+    free(pc);
+}
+
+/**
+ * Reads the values of the events since the counters are opened.
+ *
+ * @param pc
+ * @param values the values by PerfEvent, 0 if the event is not counted
+ */
+void PerfCounters_read(PerfCounters *pc, uint64_t values[PE_NEVENTS]) {
+    uint64_t buf[1 + PE_NEVENTS] = {0}; // nr, values...
+
+    memset(values, 0, sizeof(uint64_t) * PE_NEVENTS);
+    if (pc->_nopen == 0)
+        return;
+
+    int leader = -1;
+    for (int i = 0; i < PE_NEVENTS && leader == -1; i++)
+        leader = pc->_fds[i];
+    if (read(leader, buf, sizeof(buf)) <= 0)
+        return;
+
+    for (int i = 0; i < PE_NEVENTS; i++)
+        if (pc->_index[i] != -1 && pc->_index[i] < buf[0])
+            values[i] = buf[1 + pc->_index[i]];
+}
+
+/**
+ * Returns whether the event is counted, as not all events are available on
+ * every system.
+ */
+bool PerfCounters_counts(PerfCounters *pc, PerfEvent ev) {
+    return pc->_fds[ev] != -1;
+}
+
+static void test_PerfCounters() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    uint64_t v1[PE_NEVENTS], v2[PE_NEVENTS];
+
+    expect_str(__LINE__, "cycles", PerfEvent_name(PE_CYCLES));
+    expect_str(__LINE__, "context_switches",
+               PerfEvent_name(PE_CONTEXT_SWITCHES));
+
+    PerfCounters *pc = new_PerfCounters(ex);
+    if (ex->ty != E_Okay) {
+        // not available on this system, all values are 0
+        PerfCounters_read(pc, v1);
+        for (int i = 0; i < PE_NEVENTS; i++)
+            expect(__LINE__, 0, v1[i]);
+        delete_PerfCounters(pc);
+        free(ex);
+        return;
+    }
+
+    PerfCounters_read(pc, v1);
+    volatile int sum = 0;
+    for (int i = 0; i < 1000000; i++)
+        sum += i;
+    usleep(1000); // switches the context
+    PerfCounters_read(pc, v2);
+
+    for (int i = 0; i < PE_NEVENTS; i++) {
+        expect_bool(__LINE__, true, v1[i] <= v2[i]);
+        expect_bool(__LINE__, pc->_fds[i] != -1, PerfCounters_counts(pc, i));
+        if (pc->_fds[i] == -1)
+            expect(__LINE__, 0, v2[i]);
+    }
+    if (pc->_fds[PE_INSTRUCTIONS] != -1)
+        expect_bool(__LINE__, true, v2[PE_INSTRUCTIONS] - v1[PE_INSTRUCTIONS] >
+                                        1000000);
+
+    delete_PerfCounters(pc);
+    free(ex);
+}
+
+void run_all_test_perf() {
+    test_PerfCounters();
+}
@@ -0,0 +1,45 @@
+/** @file
+ * provides hardware performance counters of the calling process with
+ * perf_event_open(2).
+ */
+#pragma once
+
+#include "util.h"
+
+#include <stdint.h> // uint64_t
+
+/// events counted by PerfCounters
+typedef enum {
+    PE_CYCLES,
+    PE_INSTRUCTIONS,
+    PE_CACHE_MISSES,
+    PE_BRANCH_MISSES,
+    PE_CONTEXT_SWITCHES,
+    PE_NEVENTS,
+} PerfEvent;
+
+const char *PerfEvent_name(PerfEvent ev);
+
+/** @struct PerfCounters
+ * @brief Counters of PerfEvent opened on the calling process, in user space
+ * only. The counters are opened as a group, so they are read with a single
+ * read(2) and are scheduled together. An event which the kernel or the CPU
+ * does not support is not counted.
+ *
+ * \li new_PerfCounters() fails if no event can be counted.
+ * \li delete_PerfCounters()
+ * \li PerfCounters_read() reads the values of all events.
+ * \li PerfCounters_counts() returns whether the event is counted.
+ */
+typedef struct {
+    int _fds[PE_NEVENTS];   // for internal: -1 if not counted
+    int _index[PE_NEVENTS]; // for internal: index in the group, or -1
+    int _nopen;             // for internal: the number of members
+} PerfCounters;
+
+PerfCounters *new_PerfCounters(Exception *ex);
+void delete_PerfCounters(PerfCounters *);
+void PerfCounters_read(PerfCounters *, uint64_t values[PE_NEVENTS]);
+bool PerfCounters_counts(PerfCounters *, PerfEvent ev);
+
+void run_all_test_perf();
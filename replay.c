@@ -0,0 +1,678 @@
+/** @file
+ * dali-replay - replays access logs against a server.
+ *
+ * Usage: dali-replay [-a ADDRESS] [-p PORT] [-c CONNECTIONS] [-s SPEED]
+ * [FILE...]
+ *        dali-replay -m DOCUMENT_ROOT [FILE...]
+ *
+ * \li -a ADDRESS : the IPv4 address of the server (default: 127.0.0.1)
+ * \li -p PORT : the port of the server (default: 8088)
+ * \li -c CONNECTIONS : the number of keep-alive connections (default: 8)
+ * \li -s SPEED : replays SPEED times as fast as the log (default: 1). 0 sends
+ * the next request as soon as a response arrives.
+ * \li -m DOCUMENT_ROOT : synthesizes a document root of the files requested
+ * in the log, instead of replaying.
+ *
+ * Logs are read in the formats of the server, binary or combined, see
+ * LogReader. The standard input is read if no file is given.
+ *
+ * The method, the URI, the Referer and the User-Agent of the requests are
+ * sent at the times of the log, in the order of the times. As times are
+ * logged in seconds, the requests of a second are spread evenly over the
+ * second. Requests are dealt to the connections in turn, each a process of
+ * its own, and the latency of a request is measured from the time it is
+ * scheduled, so that a stalled server is not hidden by coordinated omission.
+ *
+ * A response whose status differs from the log is counted as a mismatch,
+ * except 200 for 206 and 304, as ranges and validators are not logged.
+ *
+ * The document root has a file for each path which succeeded in the log, of
+ * the largest body_bytes_sent of 200, so that the popularity and the sizes of
+ * the files are of the log. A path ending with '/' gets index.html.
+ */
+#include "histogram.h"
+#include "log.h"
+#include "main.h"
+#include "net.h"
+#include "util.h"
+
+#include <arpa/inet.h>   // inet_pton(3)
+#include <errno.h>       // errno
+#include <netinet/in.h>  // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <signal.h>      // signal(2)
+#include <stdio.h>       // printf(3)
+#include <stdlib.h>      // qsort(3)
+#include <string.h>      // strcmp(3)
+#include <strings.h>     // strncasecmp(3)
+#include <sys/mman.h>    // mmap(2)
+#include <sys/socket.h>  // socket(2)
+#include <sys/stat.h>    // mkdir(2)
+#include <sys/wait.h>    // waitpid(2)
+#include <time.h>        // clock_nanosleep(2)
+#include <unistd.h>      // fork(2)
+
+// clang-format off
+#define REPLAY_REQUEST_MAX (4 * LOG_STR_MAX) ///< bytes of a request
+#define REPLAY_LINE_MAX    (16 * 1024)       ///< bytes of a header line
+// clang-format on
+
+typedef struct {
+    char *prog_name;
+    char *address;
+    int port;
+    int connections;
+    double speed;
+    char *document_root;
+    Vector *files;
+} ReplayOption;
+
+/// a request of the log
+typedef struct {
+    long seq;      ///< the order in the log
+    time_t time;   ///< the time of the log
+    uint64_t at;   ///< ns since the first request, at the pace of the log
+    char *method;
+    char *uri;
+    char *referer;    ///< NULL if not logged
+    char *user_agent; ///< NULL if not logged
+    int status;
+    int64_t bytes; ///< body_bytes_sent, -1 if unknown
+} LoggedRequest;
+
+/// counts of a connection, shared with the parent
+typedef struct {
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t connect_errors;
+    uint64_t read_errors;
+    uint64_t mismatches; // the status differs from the log
+    Histogram latency;      // ns from the scheduled time
+    Histogram service_time; // ns from the time sent
+} ReplayResult;
+
+static ReplayOption *Opt;
+static Vector *Requests; // LoggedRequest *, in the order of times
+static struct sockaddr_in Addr;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr,
+            "%s [-a ADDRESS] [-p PORT] [-c CONNECTIONS] [-s SPEED] "
+            "[FILE...]\n",
+            prog_name);
+    fprintf(stderr, "%s -m DOCUMENT_ROOT [FILE...]\n", prog_name);
+}
+
+static char *str_arg(ArgsIter *iter, Exception *ex, char *msg) {
+    if (!ArgsIter_hasNext(iter)) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = msg;
+        return "0";
+    }
+    return ArgsIter_next(iter);
+}
+
+static ReplayOption *ReplayOption_parse(int argc, char **argv,
+                                        Exception *ex) {
+    ArgsIter *iter = new_ArgsIter(argc, argv);
+    ReplayOption *opts = calloc(1, sizeof(ReplayOption));
+
+    opts->prog_name = ArgsIter_getProgName(iter);
+    opts->address = "127.0.0.1";
+    opts->port = DEFAULT_PORT;
+    opts->connections = 8;
+    opts->speed = 1;
+    opts->files = new_Vector();
+
+    while (ex->ty == E_Okay && ArgsIter_hasNext(iter)) {
+        char *arg = ArgsIter_next(iter);
+
+        if (strcmp(arg, "-a") == 0) {
+            opts->address =
+                str_arg(iter, ex, "option require an argument -- 'a'");
+        } else if (strcmp(arg, "-p") == 0) {
+            opts->port =
+                atoi(str_arg(iter, ex, "option require an argument -- 'p'"));
+        } else if (strcmp(arg, "-c") == 0) {
+            opts->connections =
+                atoi(str_arg(iter, ex, "option require an argument -- 'c'"));
+        } else if (strcmp(arg, "-s") == 0) {
+            opts->speed =
+                atof(str_arg(iter, ex, "option require an argument -- 's'"));
+        } else if (strcmp(arg, "-m") == 0) {
+            opts->document_root =
+                str_arg(iter, ex, "option require an argument -- 'm'");
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            ex->ty = O_IllegalArgument;
+            ex->msg = "unknown option";
+        } else {
+            Vector_push(opts->files, arg);
+        }
+    }
+    delete_ArgsIter(iter);
+
+    if (ex->ty == E_Okay && opts->connections <= 0) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "CONNECTIONS must be positive";
+    }
+    if (ex->ty == E_Okay && opts->speed < 0) {
+        ex->ty = O_IllegalArgument;
+        ex->msg = "SPEED must not be negative";
+    }
+    return opts;
+}
+
+/**
+ * Rebuilds the request of the entry.
+ *
+ * @return a new LoggedRequest, or NULL if $request is not of a method and a
+ * URI
+ */
+static LoggedRequest *new_LoggedRequest(LogEntry *e, long seq) {
+    char *method = strdup(e->request);
+    char *uri = strchr(method, ' ');
+    if (uri == NULL || uri == method) {
+        free(method);
+        return NULL;
+    }
+    *uri++ = '\0';
+    uri[strcspn(uri, " ")] = '\0';
+    if (uri[0] != '/') {
+        free(method);
+        return NULL;
+    }
+
+    LoggedRequest *r = calloc(1, sizeof(LoggedRequest));
+    r->seq = seq;
+    r->time = e->time;
+    r->method = method;
+    r->uri = uri;
+    if (strcmp(e->http_referer, "-") != 0)
+        r->referer = strdup(e->http_referer);
+    if (strcmp(e->http_user_agent, "-") != 0)
+        r->user_agent = strdup(e->http_user_agent);
+    r->status = atoi(e->status);
+    r->bytes = strcmp(e->body_bytes_sent, "-") == 0
+                   ? -1
+                   : strtoll(e->body_bytes_sent, NULL, 10);
+    return r;
+}
+
+/// frees the strings of the request, which is freed by delete_Vector()
+static void clear_LoggedRequest(LoggedRequest *r) {
+    free(r->method); // uri points to it
+    free(r->referer);
+    free(r->user_agent);
+}
+
+static void read_log(FILE *in, const char *name) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    LogReader *reader = new_LogReader(in);
+    LogEntry e;
+    long skipped = 0;
+
+    while (LogReader_next(reader, &e, ex)) {
+        LoggedRequest *r = new_LoggedRequest(&e, Requests->len);
+        if (r == NULL)
+            skipped++;
+        else
+            Vector_push(Requests, r);
+    }
+    if (ex->ty != E_Okay)
+        fprintf(stderr, "%s: %s\n", name, ex->msg);
+    skipped += reader->skipped;
+    if (skipped > 0)
+        fprintf(stderr, "%s: %ld malformed requests skipped\n", name,
+                skipped);
+
+    delete_LogReader(reader);
+    free(ex);
+}
+
+static int compare_time(const void *a, const void *b) {
+    const LoggedRequest *x = *(LoggedRequest **)a;
+    const LoggedRequest *y = *(LoggedRequest **)b;
+    if (x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/**
+ * Sorts the requests by times, as workers write logs in batches, and spreads
+ * the requests of a second over the second.
+ */
+static void schedule() {
+    qsort(Requests->data, Requests->len, sizeof(void *), compare_time);
+
+    for (int i = 0, j; i < Requests->len; i = j) {
+        LoggedRequest *first = Requests->data[i];
+        for (j = i; j < Requests->len; j++)
+            if (((LoggedRequest *)Requests->data[j])->time != first->time)
+                break;
+        LoggedRequest *origin = Requests->data[0];
+        uint64_t sec = (uint64_t)(first->time - origin->time) * 1000000000;
+        for (int k = i; k < j; k++) {
+            LoggedRequest *r = Requests->data[k];
+            r->at = sec + (uint64_t)(k - i) * 1000000000 / (j - i);
+        }
+    }
+}
+
+//
+// document root
+//
+
+/// a file of the document root, of a request which succeeded
+typedef struct {
+    char *path;
+    int64_t size; ///< body_bytes_sent of 200, 0 otherwise
+} SynthFile;
+
+static int compare_path(const void *a, const void *b) {
+    return strcmp(((SynthFile *)a)->path, ((SynthFile *)b)->path);
+}
+
+/**
+ * Returns the path of the file of the URI, as the server maps it: decoded,
+ * without the query. The URI of a directory, e.g. "/", maps to its
+ * index.html, so that the directory exists for the request.
+ *
+ * @return a new string, or NULL if the path is unsafe
+ */
+static char *file_path(const char *root, const char *uri) {
+    static const char index_html[] = "index.html";
+    char *path = calloc(strlen(uri) + 1, sizeof(char));
+    url_decode(path, uri);
+    path[strcspn(path, "?")] = '\0';
+
+    size_t len = strlen(path);
+    if (len == 0 || strstr(path, "/../") != NULL ||
+        (len >= 3 && strcmp(path + len - 3, "/..") == 0)) {
+        free(path);
+        return NULL;
+    }
+    bool dir = path[len - 1] == '/';
+    char *file = malloc(strlen(root) + len + sizeof(index_html));
+    sprintf(file, "%s%s%s", root, path, dir ? index_html : "");
+    free(path);
+    return file;
+}
+
+/// creates the parent directories of the path
+static bool make_parents(char *path) {
+    for (char *p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        int rc = mkdir(path, 0755);
+        *p = '/';
+        if (rc == -1 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+/// creates the file of the size, filled with a printable pattern
+static bool make_file(const char *path, int64_t size) {
+    static const char pattern[] = "0123456789abcdefghijklmnopqrstuvwxyz\n";
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return false;
+    for (int64_t i = 0; i < size; i++)
+        putc(pattern[i % (sizeof(pattern) - 1)], f);
+    return fclose(f) == 0;
+}
+
+/**
+ * Creates a file for each path of GET and HEAD requests which succeeded, of
+ * the largest body_bytes_sent of 200. URIs which differ only by the query
+ * or the encoding are of the same file.
+ *
+ * @return the number of files which are not created
+ */
+static int synthesize(const char *root) {
+    SynthFile *ok = calloc(Requests->len, sizeof(SynthFile));
+    int nok = 0, files = 0, failures = 0;
+    int64_t total = 0;
+
+    // grouped by the path of the file, as URIs of a file differ by queries
+    for (int i = 0; i < Requests->len; i++) {
+        LoggedRequest *r = Requests->data[i];
+        bool get = strcmp(r->method, "GET") == 0 ||
+                   strcmp(r->method, "HEAD") == 0;
+        if (!get || !(r->status == 200 || r->status == 206 || r->status == 304))
+            continue;
+        char *path = file_path(root, r->uri);
+        if (path == NULL)
+            continue;
+        ok[nok++] = (SynthFile){
+            .path = path,
+            .size = r->status == 200 && r->bytes > 0 ? r->bytes : 0,
+        };
+    }
+    qsort(ok, nok, sizeof(SynthFile), compare_path);
+
+    if (mkdir(root, 0755) == -1 && errno != EEXIST)
+        error("Error: mkdir: %s: %s", root, strerror(errno));
+
+    for (int i = 0, j; i < nok; i = j) {
+        char *path = ok[i].path;
+        int64_t size = 0;
+        for (j = i; j < nok && strcmp(ok[j].path, path) == 0; j++)
+            if (ok[j].size > size)
+                size = ok[j].size;
+
+        if (make_parents(path) && make_file(path, size)) {
+            files++;
+            total += size;
+        } else {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            failures++;
+        }
+    }
+
+    printf("%d files, %.2f MB in %s\n", files, total / 1e6, root);
+    for (int i = 0; i < nok; i++)
+        free(ok[i].path);
+    free(ok);
+    return failures;
+}
+
+//
+// replay
+//
+
+static int connect_server() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr *)&Addr, sizeof(Addr)) == -1) {
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static bool send_request(int fd, LoggedRequest *r) {
+    char buf[REPLAY_REQUEST_MAX];
+    int len = snprintf(buf, sizeof(buf),
+                       "%s %s HTTP/1.1\r\n"
+                       "Host: %s:%d\r\n"
+                       "%s%s%s"
+                       "%s%s%s"
+                       "\r\n",
+                       r->method, r->uri, Opt->address, Opt->port,
+                       r->referer ? "Referer: " : "",
+                       r->referer ? r->referer : "", r->referer ? "\r\n" : "",
+                       r->user_agent ? "User-Agent: " : "",
+                       r->user_agent ? r->user_agent : "",
+                       r->user_agent ? "\r\n" : "");
+    if (len >= (int)sizeof(buf)) // too long to replay
+        return false;
+
+    for (int off = 0; off < len;) {
+        ssize_t n = write(fd, buf + off, len - off);
+        if (n <= 0)
+            return false;
+        off += n;
+    }
+    return true;
+}
+
+/// reads and discards n bytes, or up to the end if n is negative
+static bool skip(FILE *in, int64_t n, uint64_t *bytes) {
+    char buf[8192];
+
+    while (n != 0) {
+        size_t want = n < 0 || n > (int64_t)sizeof(buf) ? sizeof(buf) : n;
+        size_t got = fread(buf, 1, want, in);
+        *bytes += got;
+        if (got == 0)
+            return n < 0 && feof(in);
+        if (n > 0)
+            n -= got;
+    }
+    return true;
+}
+
+/**
+ * Reads a response.
+ *
+ * @return the status, or -1 if the response is malformed or cut
+ * @param in the connection
+ * @param head true if the request is of HEAD, whose response has no body
+ * @param close true if the connection is closed after the response
+ * @param bytes the bytes of the body are added
+ */
+static int read_response(FILE *in, bool head, bool *close, uint64_t *bytes) {
+    char line[REPLAY_LINE_MAX];
+    int status = 0;
+    int64_t len = -1;
+    bool chunked = false;
+
+    *close = false;
+    if (fgets(line, sizeof(line), in) == NULL ||
+        sscanf(line, "HTTP/%*d.%*d %d", &status) != 1)
+        return -1;
+
+    for (;;) {
+        if (fgets(line, sizeof(line), in) == NULL)
+            return -1;
+        if (strcmp(line, "\r\n") == 0)
+            break;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            len = strtoll(line + 15, NULL, 10);
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 &&
+                 strstr(line, "chunked") != NULL)
+            chunked = true;
+        else if (strncasecmp(line, "Connection:", 11) == 0 &&
+                 strstr(line, "close") != NULL)
+            *close = true;
+    }
+
+    if (head || status / 100 == 1 || status == 204 || status == 304)
+        return status;
+    if (chunked) {
+        for (;;) {
+            if (fgets(line, sizeof(line), in) == NULL)
+                return -1;
+            int64_t size = strtoll(line, NULL, 16);
+            if (size == 0)
+                break;
+            if (!skip(in, size + 2, bytes)) // and CRLF
+                return -1;
+        }
+        do { // the trailer section
+            if (fgets(line, sizeof(line), in) == NULL)
+                return -1;
+        } while (strcmp(line, "\r\n") != 0);
+        return status;
+    }
+    if (len < 0)
+        *close = true;
+    return skip(in, len, bytes) ? status : -1;
+}
+
+static bool matches(int logged, int status) {
+    return status == logged ||
+           (status == 200 && (logged == 206 || logged == 304));
+}
+
+/**
+ * Replays the requests of the connection: the k-th and every CONNECTIONS-th
+ * after it.
+ */
+static void replay(int k, ReplayResult *result, uint64_t start) {
+    FILE *in = NULL;
+
+    for (int i = k; i < Requests->len; i += Opt->connections) {
+        LoggedRequest *r = Requests->data[i];
+        uint64_t scheduled_at = monotonic_ns();
+
+        if (Opt->speed > 0) {
+            scheduled_at = start + (uint64_t)(r->at / Opt->speed);
+            struct timespec ts = {
+                .tv_sec = scheduled_at / 1000000000,
+                .tv_nsec = scheduled_at % 1000000000,
+            };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+                                   NULL) == EINTR)
+                ;
+        }
+
+        if (in == NULL) {
+            int fd = connect_server();
+            if (fd == -1) {
+                result->connect_errors++;
+                continue;
+            }
+            in = fdopen(fd, "r");
+        }
+
+        uint64_t sent_at = monotonic_ns();
+        bool close = true;
+        int status = -1;
+        if (send_request(fileno(in), r))
+            status = read_response(in, strcmp(r->method, "HEAD") == 0, &close,
+                                   &result->bytes);
+        uint64_t now = monotonic_ns();
+
+        if (status == -1) {
+            result->read_errors++;
+        } else {
+            result->requests++;
+            if (!matches(r->status, status))
+                result->mismatches++;
+            Histogram_record(&result->latency, now - scheduled_at);
+            Histogram_record(&result->service_time, now - sent_at);
+        }
+        if (close) {
+            fclose(in);
+            in = NULL;
+        }
+    }
+    if (in != NULL)
+        fclose(in);
+}
+
+static void print_latency(const char *name, Histogram *h) {
+    printf("%-14s p50 %.3f, p90 %.3f, p99 %.3f, p99.9 %.3f, max %.3f ms\n",
+           name, Histogram_percentile(h, 50) / 1e6,
+           Histogram_percentile(h, 90) / 1e6, Histogram_percentile(h, 99) / 1e6,
+           Histogram_percentile(h, 99.9) / 1e6, h->max / 1e6);
+}
+
+static void print_result(ReplayResult *total, double sec) {
+    LoggedRequest *last = Vector_last(Requests);
+
+    printf("%d requests of %.0f s, %d connections, ", Requests->len,
+           last->at / 1e9 + 1, Opt->connections);
+    if (Opt->speed > 0)
+        printf("%gx speed\n", Opt->speed);
+    else
+        printf("as fast as possible\n");
+    printf("requests:      %ju in %.1f s, %.1f requests/s, %.2f MB/s\n",
+           (uintmax_t)total->requests, sec, total->requests / sec,
+           total->bytes / sec / 1e6);
+    printf("errors:        connect %ju, read %ju, status mismatch %ju\n",
+           (uintmax_t)total->connect_errors, (uintmax_t)total->read_errors,
+           (uintmax_t)total->mismatches);
+    print_latency("latency:", &total->latency);
+    if (Opt->speed > 0)
+        print_latency("service time:", &total->service_time);
+}
+
+/**
+ * Replays the requests over the connections, each in a process.
+ *
+ * @return true if any request is replayed
+ */
+static bool run() {
+    int n = Opt->connections;
+    ReplayResult *results = mmap(NULL, n * sizeof(ReplayResult),
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+        error("Error: mmap: %s", strerror(errno));
+    memset(results, 0, n * sizeof(ReplayResult));
+
+    fflush(stdout);
+    uint64_t start = monotonic_ns();
+    for (int k = 0; k < n; k++) {
+        pid_t pid = fork();
+        if (pid == -1)
+            error("Error: fork: %s", strerror(errno));
+        if (pid == 0) {
+            replay(k, &results[k], start);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    while (wait(NULL) > 0 || errno == EINTR)
+        ;
+    double sec = (monotonic_ns() - start) / 1e9;
+
+    ReplayResult *total = calloc(1, sizeof(ReplayResult));
+    for (int k = 0; k < n; k++) {
+        total->requests += results[k].requests;
+        total->bytes += results[k].bytes;
+        total->connect_errors += results[k].connect_errors;
+        total->read_errors += results[k].read_errors;
+        total->mismatches += results[k].mismatches;
+        Histogram_merge(&total->latency, &results[k].latency);
+        Histogram_merge(&total->service_time, &results[k].service_time);
+    }
+    print_result(total, sec);
+
+    bool replayed = total->requests > 0;
+    free(total);
+    munmap(results, n * sizeof(ReplayResult));
+    return replayed;
+}
+
+int main(int argc, char **argv) {
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    Opt = ReplayOption_parse(argc, argv, ex);
+    if (ex->ty != E_Okay) {
+        fprintf(stderr, "%s\n", ex->msg);
+        print_usage(Opt->prog_name);
+        return EXIT_FAILURE;
+    }
+
+    Requests = new_Vector();
+    if (Opt->files->len == 0)
+        read_log(stdin, "-");
+    for (int i = 0; i < Opt->files->len; i++) {
+        char *path = Opt->files->data[i];
+        FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+        if (in == NULL) {
+            perror(path);
+            continue;
+        }
+        read_log(in, path);
+        if (in != stdin)
+            fclose(in);
+    }
+    if (Requests->len == 0)
+        error("Error: no requests in the log");
+    schedule();
+
+    int status;
+    if (Opt->document_root != NULL) {
+        status = synthesize(Opt->document_root) == 0 ? EXIT_SUCCESS
+                                                     : EXIT_FAILURE;
+    } else {
+        Addr.sin_family = AF_INET;
+        Addr.sin_port = htons(Opt->port);
+        if (inet_pton(AF_INET, Opt->address, &Addr.sin_addr) != 1)
+            error("Error: bad address: %s", Opt->address);
+        signal(SIGPIPE, SIG_IGN);
+        status = run() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < Requests->len; i++)
+        clear_LoggedRequest(Requests->data[i]);
+    delete_Vector(Requests);
+    free(ex);
+    return status;
+}
@@ -1,35 +1,83 @@
+#include "compress.h"
 #include "file.h"
+#include "log.h"
 #include "main.h"
+#include "metrics.h"
+#include "mime.h"
 #include "net.h"
+#include "stats.h"
 #include "util.h"
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <malloc.h> // mallinfo(3)
+#include <poll.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+/// argument of write_dir_listing()
+typedef struct {
+    char path[PATH_MAX]; // path to the directory
+    char uri[PATH_MAX];  // path in the request
+} DirListing;
+
 static pid_t Pids[MAX_SERVERS];
+static ContentCache *Cache; // compressed variants, per worker
+static FileCache *Files;    // resolved files, per worker
+static volatile sig_atomic_t Terminated; // SIGTERM is received, per worker
+static volatile sig_atomic_t Reopen;     // SIGUSR1 is received, per worker
+static Scoreboard *Board; // shared by workers
+static WorkerSlot *Slot;  // the slot of this worker in Board
+static PerfCounters *Perf; // counters of this worker, or NULL
+
+/// strings of the time rendered at most once per second, per worker
+typedef struct {
+    time_t sec;
+    char log_time[26 + 1];  // "09/Oct/2020:17:34:23 +0900"
+    char http_date[29 + 1]; // "Fri, 09 Oct 2020 08:34:23 GMT"
+} TimeCache;
+
+static TimeCache Now;
+static TimeCache *time_cache(time_t t);
 
 static void cleanup(int);
-static void header_put(HttpMessage *msg, char *key, char *value);
+static void forward(int);
+static void terminate(int);
+static void request_reopen(int);
+static void reopen_log_if_requested(AccessLog *log);
+static bool perf_available();
+static void sample_perf(uint64_t values[PE_NEVENTS]);
+static void worker(Socket *sv_sock, AccessLog *log, Option *opt);
+static void header_put(HttpMessage *msg, const char *key, const char *value);
+static void header_replace(HttpMessage *msg, const char *key,
+                           const char *value);
 static char *header_get(HttpMessage *msg, const char *key, char *default_val);
-static File *new_File2(const char *parent_path, const char *child_path);
+static File *resolve_file(const char *root, const char *filename);
 
-static void handle_connection(Socket *sock, FILE *log, Option *opt);
+static void handle_connection(Socket *sock, AccessLog *log, Option *opt);
+static int wait_request(Socket *sock, AccessLog *log);
 static HttpMessage *new_HttpResponse(HttpMessage *, Option *, Exception *ex);
 static HttpMessage *new_HttpResponse_for_bad_query(HttpMessage *, Option *,
                                                    Exception *);
 
-static void write_msg(HttpMessage *, HttpMessage *, FILE *);
-static int write_log(FILE *, Socket *, time_t *, HttpMessage *, HttpMessage *);
+static off_t write_msg(HttpMessage *, HttpMessage *, FILE *, PhaseTimes *);
+static int write_log(AccessLog *, Socket *, time_t *, PhaseTimes *,
+                     HttpMessage *, HttpMessage *);
+static void print_phases(HttpMessage *, HttpMessage *, PhaseTimes *);
 
 /**
  * Starts Http Server
@@ -39,10 +87,13 @@ static int write_log(FILE *, Socket *, time_t *, HttpMessage *, HttpMessage *);
 void server_start(Option *opt) {
     Exception *ex = calloc(1, sizeof(Exception));
 
-    FILE *log = fopen(opt->access_log, "a");
-    if (log == NULL) {
-        perror("fopen");
-        exit(1);
+    AccessLog *log = new_AccessLog(opt->access_log, ex);
+    if (ex->ty != E_Okay)
+        error("Error: new_AccessLog: %s: %s", ex->msg, strerror(errno));
+    if (opt->log_format != NULL) {
+        AccessLog_setFormat(log, opt->log_format, ex);
+        if (ex->ty != E_Okay)
+            error("Error: %s: %s", ex->msg, opt->log_format);
     }
 
     Socket *sv_sock = new_ServerSocket(opt->port, ex);
@@ -51,6 +102,18 @@ void server_start(Option *opt) {
     printf("listen: %s:%d\n", inet_ntoa(sv_sock->addr->sin_addr),
            ntohs(sv_sock->addr->sin_port));
 
+    // workers wait for a connection with poll(2), and the ones which lose the
+    // race must not block in accept(2) with lines left in the log buffer.
+    fcntl(sv_sock->_fd, F_SETFL, fcntl(sv_sock->_fd, F_GETFL) | O_NONBLOCK);
+
+    Board = new_Scoreboard(MAX_SERVERS, ex);
+    if (ex->ty != E_Okay)
+        error("Error: new_Scoreboard: %s: %s", ex->msg, strerror(errno));
+    Board->perf = opt->perf && perf_available();
+
+    // workers must not be killed by SIGUSR1 before they set the handler
+    signal(SIGUSR1, SIG_IGN);
+
     for (int i = 0; i < MAX_SERVERS; i++) {
         pid_t pid = fork();
         switch (pid) {
@@ -58,31 +121,31 @@ void server_start(Option *opt) {
             perror("fork");
             exit(1);
         case 0: // child
-            while (true) {
-                Socket *sock = ServerSocket_accept(sv_sock, ex);
-                if (ex->ty != E_Okay)
-                    error("Error: ServerSock_accept: %s: %s", ex->msg,
-                          strerror(errno));
-                printf("open pid: %d, address: %s, port: %d\n", getpid(),
-                       inet_ntoa(sock->addr->sin_addr),
-                       ntohs(sock->addr->sin_port));
-                handle_connection(sock, log, opt);
-                delete_Socket(sock);
-            }
+            Slot = &Board->slots[i];
+            worker(sv_sock, log, opt);
             break;
         default: // parent
             Pids[i] = pid;
         }
     }
 
+    // the parent writes no lines, and must not hold a rotated file
+    delete_AccessLog(log);
+
     signal(SIGTERM, cleanup);
 
+    struct sigaction sa = {0};
+    sa.sa_handler = forward;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+
     for (int i = 0; i < MAX_SERVERS; ++i) {
         int wstatus;
         waitpid(-1, &wstatus, 0);
     }
 
-    fclose(log);
+    Scoreboard_dump(Board, stderr);
+    delete_Scoreboard(Board);
     delete_Socket(sv_sock);
     free(ex);
 }
@@ -95,16 +158,183 @@ static void cleanup(int sig_type) {
     }
 }
 
-static void handle_connection(Socket *sock, FILE *log, Option *opt) {
-    HttpMessage *req, *res;
+/// passes the signal on to workers
+static void forward(int sig_type) {
+    for (int i = 0; i < MAX_SERVERS; ++i) {
+        kill(Pids[i], sig_type);
+    }
+}
+
+static void terminate(int sig_type) {
+    Terminated = 1;
+}
+
+static void request_reopen(int sig_type) {
+    Reopen = 1;
+}
+
+/**
+ * Reopens the access log if SIGUSR1 is received. Called only between
+ * requests, so that no line is torn or lost by rotation.
+ */
+static void reopen_log_if_requested(AccessLog *log) {
+    if (!Reopen)
+        return;
+    Reopen = 0;
+
+    Exception *ex = calloc(1, sizeof(Exception));
+    AccessLog_reopen(log, ex);
+    if (ex->ty != E_Okay)
+        fprintf(stderr, "Error: AccessLog_reopen: %s: %s: %s\n", ex->msg,
+                log->path, strerror(errno));
+    free(ex);
+}
+
+/**
+ * Tells whether performance counters can be opened, and warns if not. The
+ * server runs without them then.
+ */
+static bool perf_available() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    delete_PerfCounters(new_PerfCounters(ex));
+    bool ok = ex->ty == E_Okay;
+    if (!ok)
+        fprintf(stderr, "Warning: %s: %s, performance counters disabled\n",
+                ex->msg, strerror(errno));
+    free(ex);
+    return ok;
+}
+
+/// reads the counters of this worker if they are opened
+static void sample_perf(uint64_t values[PE_NEVENTS]) {
+    if (Perf != NULL)
+        PerfCounters_read(Perf, values);
+}
+
+/**
+ * Accepts and handles connections until SIGTERM is received. Flushes the
+ * access log while no connection arrives, and before exit. Reopens the
+ * access log on SIGUSR1.
+ */
+static void worker(Socket *sv_sock, AccessLog *log, Option *opt) {
     Exception *ex = calloc(1, sizeof(Exception));
 
+    // without SA_RESTART, so that blocking calls return on SIGTERM
+    struct sigaction sa = {0};
+    sa.sa_handler = terminate;
+    sigaction(SIGTERM, &sa, NULL);
+
+    // with SA_RESTART, so that requests in progress are not broken. poll(2)
+    // and the wait for the next request of a connection return anyway.
+    sa.sa_handler = request_reopen;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    // a client which closes the connection must not kill the worker; the
+    // write fails with EPIPE instead, and the next read ends the connection.
+    signal(SIGPIPE, SIG_IGN);
+
+    // counters are opened on this process, so after fork(2)
+    if (Board != NULL && Board->perf) {
+        Perf = new_PerfCounters(ex);
+        if (ex->ty != E_Okay) {
+            ex->ty = E_Okay;
+            delete_PerfCounters(Perf);
+            Perf = NULL;
+        }
+    }
+
+    while (!Terminated) {
+        reopen_log_if_requested(log);
+
+        struct pollfd pfd = {.fd = sv_sock->_fd, .events = POLLIN};
+        if (poll(&pfd, 1, LOG_FLUSH_INTERVAL * 1000) <= 0) {
+            AccessLog_flushIfDue(log, time(NULL));
+            continue;
+        }
+
+        Socket *sock = ServerSocket_accept(sv_sock, ex);
+        if (ex->ty != E_Okay) {
+            // another worker took the connection
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+                errno == ECONNABORTED) {
+                ex->ty = E_Okay;
+                delete_Socket(sock);
+                continue;
+            }
+            error("Error: ServerSock_accept: %s: %s", ex->msg,
+                  strerror(errno));
+        }
+        printf("open pid: %d, address: %s, port: %d\n", getpid(),
+               inet_ntoa(sock->addr->sin_addr), ntohs(sock->addr->sin_port));
+        WorkerSlot_setState(Slot, WS_KEEPALIVE);
+        handle_connection(sock, log, opt);
+        WorkerSlot_setState(Slot, WS_IDLE);
+        delete_Socket(sock);
+    }
+
+    if (Perf != NULL)
+        delete_PerfCounters(Perf);
+    delete_AccessLog(log);
+    free(ex);
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Waits for the first byte of the next request. A keep-alive connection may
+ * wait here without bound, so reads time out every LOG_FLUSH_INTERVAL while
+ * waiting, to flush the lines of the log that are due. A read with timeout is
+ * not restarted by SA_RESTART, so SIGUSR1 reopens the log here too.
+ *
+ * @param sock
+ * @param log
+ * @return the first byte, or EOF
+ */
+static int wait_request(Socket *sock, AccessLog *log) {
+    struct timeval interval = {.tv_sec = LOG_FLUSH_INTERVAL};
+    struct timeval none = {0};
+    int c;
+
+    // a request read ahead in the buffer of the stream is returned at once
+    setsockopt(sock->_fd, SOL_SOCKET, SO_RCVTIMEO, &interval,
+               sizeof(interval));
+    while ((c = fgetc(sock->ips)) == EOF && ferror(sock->ips) &&
+           (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) &&
+           !Terminated) {
+        clearerr(sock->ips);
+        reopen_log_if_requested(log);
+        AccessLog_flushIfDue(log, time(NULL));
+    }
+    // the rest of the request is read without timeout, as before
+    setsockopt(sock->_fd, SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+    return c;
+}
+
+static void handle_connection(Socket *sock, AccessLog *log, Option *opt) {
+    HttpMessage *req, *res;
+    Exception ex_ = {0}, *ex = &ex_; // of the current request
+
     bool cond = true;
     while (cond) {
+        PhaseTimes t = {0};
+        *ex = (Exception){0};
+        uint64_t samples[PP_NPHASES + 1][PE_NEVENTS]; // at phase boundaries
+
+        // waits for the first byte, not to count the idle time of keep-alive.
+        // EOF is of the client closed, or of SIGTERM while waiting.
+        int c = wait_request(sock, log);
+        if (c == EOF)
+            break;
+        ungetc(c, sock->ips);
+        t.received = monotonic_ns();
+        WorkerSlot_setState(Slot, WS_BUSY);
         time_t req_time;
         time(&req_time);
 
+        sample_perf(samples[PP_PARSE]);
         req = HttpMessage_parse(sock->ips, HM_REQ, ex, opt->debug);
+        t.parsed = monotonic_ns();
+        sample_perf(samples[PP_BUILD]);
 
         if (ex->ty == E_Okay)
             res = new_HttpResponse(req, opt, ex);
@@ -117,8 +347,24 @@ static void handle_connection(Socket *sock, FILE *log, Option *opt) {
             res = new_HttpResponse_for_bad_query(req, opt, ex);
         }
 
-        write_msg(req, res, sock->ops);
-        write_log(log, sock, &req_time, req, res);
+        t.built = monotonic_ns();
+        sample_perf(samples[PP_WRITE]);
+
+        off_t sent = write_msg(req, res, sock->ops, &t);
+        sample_perf(samples[PP_LOG]);
+        WorkerSlot_countRequest(Slot, res->status_code, sent);
+        WorkerSlot_recordLatency(Slot, t.last_sent - t.received,
+                                 t.first_sent - t.received, sent,
+                                 t.last_sent - t.first_sent);
+        write_log(log, sock, &req_time, &t, req, res);
+        if (Perf != NULL) {
+            sample_perf(samples[PP_NPHASES]);
+            for (int i = 0; i < PP_NPHASES; i++)
+                WorkerSlot_countPerf(Slot, i, samples[i], samples[i + 1]);
+        }
+        if (opt->debug)
+            print_phases(req, res, &t);
+        reopen_log_if_requested(log);
 
         if (strcmp(header_get(req, "Connection", ""), "close") == 0 ||
             strcmp(header_get(res, "Connection", ""), "close") == 0) {
@@ -126,15 +372,26 @@ static void handle_connection(Socket *sock, FILE *log, Option *opt) {
         }
 
     cleanup:
+        WorkerSlot_setState(Slot, WS_KEEPALIVE);
         delete_HttpMessage(req);
         delete_HttpMessage(res);
     }
-
-    free(ex);
 }
 
-static int file_read(File *file, char *dest); // extern ?
-static char *get_mime_type(char *fname);
+static off_t file_read(int fd, char *dest, off_t len);
+static ContentEncoding body_encoding(HttpMessage *, File *, const char *mime);
+static void put_etag(HttpMessage *, File *, ContentEncoding);
+static bool compress_body(HttpMessage *, HttpMessage *, File *,
+                          ContentEncoding);
+static bool range_body(HttpMessage *, HttpMessage *, File *,
+                       const char *mime);
+static void status_body(HttpMessage *, HttpMessage *);
+static bool not_modified(HttpMessage *, File *);
+static int open_body(File *file);
+static void set_error(HttpMessage *, HttpMessage *, const char *code,
+                      const char *phrase);
+static void write_dir_listing(ChunkedWriter *, void *arg);
+static void set_status(HttpMessage *, const char *code, const char *phrase);
 
 // TODO: 404 handle error if error.html is not found
 static HttpMessage *new_HttpResponse(HttpMessage *req, Option *opts,
@@ -143,54 +400,103 @@ static HttpMessage *new_HttpResponse(HttpMessage *req, Option *opts,
     File *file;
     char buf[20 + 1]; // log10(ULONG_MAX) < 20
 
+    // HTTP-Version
+    res->http_version = strdup(HTTP_VERSION);
+
+    // Date, Server
+    header_put(res, "Date", time_cache(time(NULL))->http_date);
+    header_put(res, "Server", SERVER_NAME);
+
     switch (req->method_ty) {
     case HMMT_GET:
     case HMMT_HEAD:
-        // HTTP-Version
-        res->http_version = strdup(HTTP_VERSION);
-
-        // Server
-        header_put(res, "Server", SERVER_NAME);
+        if (opts->status && Board != NULL &&
+            strcmp(req->filename, STATUS_URI) == 0) {
+            status_body(req, res);
+            break;
+        }
 
         // Status-Code, Reason-Phrase
-        file = new_File2(opts->document_root, req->filename);
-        if (file != NULL && file->ty == F_FILE) {
+        file = resolve_file(opts->document_root, req->filename);
+        if (file != NULL && file->ty == F_DIR && opts->autoindex) {
             res->status_code = strdup("200");
             res->reason_phrase = strdup("OK");
-        } else {
-            res->status_code = strdup("404");
-            res->reason_phrase = strdup("Not Found");
             header_put(res, "Content-Type", "text/html");
-            res->body = strdup("<html>\n"
-                               "<head><title>404 Not found</title></head>\n"
-                               "<body>\n"
-                               "<center><h1>404 Not found</h1></center>\n"
-                               "</body>\n"
-                               "</html>\n");
-            res->body_len = strlen(res->body);
-            if (req->method_ty == HMMT_HEAD) {
-                free(res->body);
-                res->body = NULL;
+            if (req->method_ty == HMMT_GET) {
+                DirListing *dl = malloc(sizeof(DirListing));
+                snprintf(dl->path, sizeof(dl->path), "%s", file->path);
+                snprintf(dl->uri, sizeof(dl->uri), "%s", req->filename);
+                HttpMessage_setProducer(res, write_dir_listing, dl);
             }
-            sprintf(buf, "%d", res->body_len);
-            header_put(res, "Content-Length", buf);
             return res;
         }
+        if (file == NULL || file->ty != F_FILE) {
+            // not found, or a directory without autoindex
+            set_error(req, res, "404", "Not Found");
+            return res;
+        }
+
+        // the body is opened before the headers are put, which are taken
+        // from the open file, so that they agree with the body sent even if
+        // the file has changed since it was looked up.
+        res->body_fd = open_body(file);
+        if (res->body_fd == -1) {
+            int err = errno;
+            // resolved again by the next request, not to answer the stale
+            // entry until it expires. file is deleted with the entry.
+            FileCache_remove(Files, file->path);
+            if (err == EACCES || err == EPERM)
+                set_error(req, res, "403", "Forbidden");
+            else if (err == ENOENT || err == ENOTDIR)
+                set_error(req, res, "404", "Not Found");
+            else
+                set_error(req, res, "500", "Internal Server Error");
+            return res;
+        }
+        if (file->ty != F_FILE) { // replaced by a directory
+            set_error(req, res, "404", "Not Found");
+            return res;
+        }
+        set_status(res, "200", "OK");
+
+        // Vary, as the encoding is negotiated, also by a 304 for the 200
+        const char *mime = mime_type(file->path);
+        ContentEncoding enc = CE_IDENTITY;
+        if (opts->compress) {
+            header_put(res, "Vary", "Accept-Encoding");
+            enc = body_encoding(req, file, mime);
+        }
+
+        // ETag, Last-Modified. a 304 carries the ETag of the variant of the
+        // 200, so that caches freshen the variant they hold.
+        if (not_modified(req, file)) {
+            set_status(res, "304", "Not Modified");
+            put_etag(res, file, enc);
+            header_put(res, "Last-Modified", file->last_modified);
+            break;
+        }
+        put_etag(res, file, CE_IDENTITY); // replaced by compress_body()
+        header_put(res, "Last-Modified", file->last_modified);
 
         // Content-Type
-        header_put(res, "Content-Type", get_mime_type(file->path));
+        header_put(res, "Content-Type", mime);
+
+        // Accept-Ranges, Content-Range, Content-Length, Body
+        header_put(res, "Accept-Ranges", "bytes");
+        if (range_body(req, res, file, mime))
+            break;
+
+        // Content-Encoding, Content-Length, Body
+        if (compress_body(req, res, file, enc))
+            break;
 
         // Content-Length
-        sprintf(buf, "%d", file->len);
+        sprintf(buf, "%jd", (intmax_t)file->len);
         header_put(res, "Content-Length", buf);
 
-        // Body (omit if POST method)
-        if (req->method_ty == HMMT_GET) {
-            res->body = malloc(file->len + 1);
-            res->body_len = file_read(file, res->body);
-        }
-
-        delete_File(file);
+        // Body (omit if POST method), streamed from the file by write_msg()
+        if (req->method_ty == HMMT_GET)
+            HttpMessage_appendRange(res, 0, file->len);
         break;
     default:
         // Not Allowed Request method
@@ -209,6 +515,7 @@ new_HttpResponse_for_bad_query(HttpMessage *req, Option *opts, Exception *ex) {
     res->http_version = strdup(HTTP_VERSION);
     res->status_code = strdup("400");
     res->reason_phrase = strdup("Bad Request");
+    header_put(res, "Date", time_cache(time(NULL))->http_date);
     header_put(res, "Server", SERVER_NAME);
     header_put(res, "Content-Type", "text/html");
     // TODO: system information, server name and os name
@@ -219,16 +526,30 @@ new_HttpResponse_for_bad_query(HttpMessage *req, Option *opts, Exception *ex) {
                        "</body>\n"
                        "</html>\n");
     res->body_len = strlen(res->body);
-    sprintf(buf, "%d", res->body_len);
+    sprintf(buf, "%jd", (intmax_t)res->body_len);
     header_put(res, "Content-Length", buf);
     header_put(res, "Connection", "close");
     return res;
 }
 
-static void header_put(HttpMessage *msg, char *key, char *value) {
+static void header_put(HttpMessage *msg, const char *key, const char *value) {
     Map_put(msg->header_map, strdup(key), strdup(value));
 }
 
+static void header_replace(HttpMessage *msg, const char *key,
+                           const char *value) {
+    Map *map = msg->header_map;
+
+    for (int i = 0; i < map->keys->len; i++) {
+        if (strcmp(map->keys->data[i], key) == 0) {
+            free(map->vals->data[i]);
+            map->vals->data[i] = strdup(value);
+            return;
+        }
+    }
+    header_put(msg, key, value);
+}
+
 static char *header_get(HttpMessage *msg, const char *key, char *default_val) {
     char *val;
 
@@ -240,105 +561,544 @@ static char *header_get(HttpMessage *msg, const char *key, char *default_val) {
     return val;
 }
 
-static File *new_File2(const char *parent_path, const char *child_path) {
-    File *file;
-    StringBuffer *sb = new_StringBuffer();
-    char *path;
+/**
+ * Resolves the file of the request in the document root, through the cache
+ * of the worker. The filename is canonicalized by HttpMessage_parse(), so
+ * equivalent URIs share an entry.
+ *
+ * @return the file, owned by the cache, or NULL if not found
+ * @param root the document root
+ * @param filename the canonical path in the request
+ */
+static File *resolve_file(const char *root, const char *filename) {
+    char path[PATH_MAX];
+    time_t now = time(NULL);
+
+    if (path_join(path, sizeof(path), root, filename) == -1)
+        return NULL;
+
+    if (Files == NULL)
+        Files = new_FileCache(FILE_CACHE_SIZE, FILE_CACHE_TTL);
+    FileEntry *entry = FileCache_get(Files, path, now);
+    WorkerSlot_countFileCache(Slot, entry != NULL);
+    if (entry == NULL)
+        entry = FileCache_put(Files, path, new_File(path), now);
+    return entry->file;
+}
+
+/**
+ * Returns the encoding of the body of a 200 for the request, the one the
+ * client accepts if the file is worth compressing.
+ *
+ * @return the encoding, or CE_IDENTITY if the body is sent as is
+ */
+static ContentEncoding body_encoding(HttpMessage *req, File *file,
+                                     const char *mime) {
+    // HEAD is answered with the identity, not to compress a body discarded
+    if (req->method_ty != HMMT_GET || file->len < COMPRESS_MIN_SIZE ||
+        file->len > COMPRESS_MAX_SIZE || !compressible_type(mime))
+        return CE_IDENTITY;
+    return accept_encoding(header_get(req, "Accept-Encoding", NULL));
+}
+
+/**
+ * Puts or replaces the ETag of the variant of the file, the entity-tag of
+ * the file suffixed with the encoding if compressed.
+ */
+static void put_etag(HttpMessage *res, File *file, ContentEncoding enc) {
+    char etag[sizeof(file->etag) + 8];
+
+    if (enc == CE_IDENTITY) {
+        header_replace(res, "ETag", file->etag);
+        return;
+    }
+    snprintf(etag, sizeof(etag), "%.*s-%s\"", (int)strlen(file->etag) - 1,
+             file->etag, ContentEncoding_name(enc));
+    header_replace(res, "ETag", etag);
+}
+
+/**
+ * Sets the compressed file to the body of the response in the encoding of
+ * body_encoding(). Compressed variants are taken from the cache of the worker
+ * if any.
+ *
+ * @return true if the response has the compressed body
+ */
+static bool compress_body(HttpMessage *req, HttpMessage *res, File *file,
+                          ContentEncoding enc) {
+    char buf[20 + 1]; // log10(ULONG_MAX) < 20
+
+    if (enc == CE_IDENTITY)
+        return false;
+
+    if (Cache == NULL)
+        Cache = new_ContentCache(COMPRESS_CACHE_SIZE);
+    CacheEntry *entry = ContentCache_get(Cache, file->path, file->mtime, enc);
+    WorkerSlot_countCache(Slot, entry != NULL);
+    if (entry == NULL) {
+        int len;
+        char *src = malloc(file->len + 1);
+        int src_len = file_read(res->body_fd, src, file->len);
+        char *data = compress_buf(src, src_len, enc, compress_level(), &len);
+        free(src);
+        if (data == NULL)
+            return false;
+        entry = ContentCache_put(Cache, file->path, file->mtime, enc, data,
+                                 len);
+        if (entry == NULL)
+            return false;
+    }
+
+    header_put(res, "Content-Encoding", ContentEncoding_name(enc));
+    put_etag(res, file, enc);
+    sprintf(buf, "%d", entry->len);
+    header_put(res, "Content-Length", buf);
+
+    res->body = malloc(entry->len);
+    memcpy(res->body, entry->data, entry->len);
+    res->body_len = entry->len;
+
+    return true;
+}
+
+/**
+ * Sets the aggregate of the scoreboard to the body, as JSON if the query has
+ * "format=json" or the client accepts application/json, otherwise in
+ * Prometheus text format.
+ */
+static void status_body(HttpMessage *req, HttpMessage *res) {
+    char buf[20 + 1]; // log10(ULONG_MAX) < 20
+    char *query = strchr(req->request_uri, '?');
+    bool json = (query != NULL && strstr(query, "format=json") != NULL) ||
+                strstr(header_get(req, "Accept", ""), "application/json") !=
+                    NULL;
+
+    set_status(res, "200", "OK");
+    header_put(res, "Content-Type",
+               json ? "application/json" : "text/plain; version=0.0.4");
+    header_put(res, "Cache-Control", "no-cache");
 
-    StringBuffer_append(sb, parent_path);
-    StringBuffer_append(sb, child_path);
-    path = StringBuffer_toString(sb);
+    res->body = Scoreboard_render(Board, json);
+    res->body_len = strlen(res->body);
+    sprintf(buf, "%jd", (intmax_t)res->body_len);
+    header_put(res, "Content-Length", buf);
+    if (req->method_ty == HMMT_HEAD) {
+        free(res->body);
+        res->body = NULL;
+    }
+}
+
+/**
+ * Sets the requested ranges of the file to the body of the response if the
+ * GET request has a valid Range header field. A single range is sent as is,
+ * multiple ranges are sent as multipart/byteranges. The ranges refer to the
+ * file descriptor and are not read into memory.
+ *
+ * @return true if the response is 206 Partial Content or 416 Range Not
+ * Satisfiable
+ */
+static bool range_body(HttpMessage *req, HttpMessage *res, File *file,
+                       const char *mime) {
+    char buf[256];
+    ByteRange ranges[MAX_RANGES];
+
+    char *range = header_get(req, "Range", NULL);
+    if (req->method_ty != HMMT_GET || range == NULL)
+        return false;
+
+    // If-Range requires the strong comparison
+    char *if_range = header_get(req, "If-Range", NULL);
+    if (if_range != NULL && strcmp(if_range, file->etag) != 0 &&
+        strcmp(if_range, file->last_modified) != 0)
+        return false;
+
+    int n = parse_ranges(range, file->len, ranges);
+    if (n == -1)
+        return false;
+
+    if (n == 0) {
+        set_status(res, "416", "Range Not Satisfiable");
+        sprintf(buf, "bytes */%jd", (intmax_t)file->len);
+        header_put(res, "Content-Range", buf);
+        header_put(res, "Content-Length", "0");
+        return true;
+    }
 
-    file = new_File(path);
+    set_status(res, "206", "Partial Content");
+
+    if (n == 1) {
+        sprintf(buf, "bytes %jd-%jd/%jd", (intmax_t)ranges[0].first,
+                (intmax_t)ranges[0].last, (intmax_t)file->len);
+        header_put(res, "Content-Range", buf);
+        HttpMessage_appendRange(res, ranges[0].first,
+                                ranges[0].last - ranges[0].first + 1);
+    } else {
+        header_replace(res, "Content-Type",
+                       "multipart/byteranges; boundary=" BYTERANGES_BOUNDARY);
+        for (int i = 0; i < n; i++) {
+            snprintf(buf, sizeof(buf),
+                     "\r\n--" BYTERANGES_BOUNDARY "\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Range: bytes %jd-%jd/%jd\r\n"
+                     "\r\n",
+                     mime, (intmax_t)ranges[i].first, (intmax_t)ranges[i].last,
+                     (intmax_t)file->len);
+            HttpMessage_appendText(res, buf);
+            HttpMessage_appendRange(res, ranges[i].first,
+                                    ranges[i].last - ranges[i].first + 1);
+        }
+        HttpMessage_appendText(res, "\r\n--" BYTERANGES_BOUNDARY "--\r\n");
+    }
 
-    free(path);
-    delete_StringBuffer(sb);
+    sprintf(buf, "%jd", (intmax_t)res->body_len);
+    header_put(res, "Content-Length", buf);
 
-    return file;
+    return true;
 }
 
-static char *get_mime_type(char *path) {
-    char *ext = extension(path);
-    if (ext == NULL)
-        return "text/plain";
+/**
+ * Evaluates If-None-Match, or If-Modified-Since if the request does not have
+ * If-None-Match.
+ *
+ * @return true if the response should be 304 Not Modified
+ */
+static bool not_modified(HttpMessage *req, File *file) {
+    time_t t;
+
+    char *if_none_match = header_get(req, "If-None-Match", NULL);
+    if (if_none_match != NULL)
+        return etag_match(if_none_match, file->etag);
 
-    char *mime = Map_get(MimeMap, ext);
+    char *if_modified_since = header_get(req, "If-Modified-Since", NULL);
+    if (if_modified_since != NULL && parse_http_date(if_modified_since, &t))
+        return file->mtime <= t;
 
-    free(ext);
-    if (mime == NULL)
-        return "text/plain";
+    return false;
+}
 
-    return mime;
+static void set_status(HttpMessage *res, const char *code,
+                       const char *phrase) {
+    free(res->status_code);
+    free(res->reason_phrase);
+    res->status_code = strdup(code);
+    res->reason_phrase = strdup(phrase);
 }
 
-static int file_read(File *file, char *dest) {
-    int fd = open(file->path, O_RDONLY);
-    int len = read(fd, dest, file->len);
-    close(fd);
+/**
+ * Sets the status and a short HTML body of the error to the response.
+ *
+ * @param req
+ * @param res
+ * @param code Status-Code
+ * @param phrase Reason-Phrase
+ */
+static void set_error(HttpMessage *req, HttpMessage *res, const char *code,
+                      const char *phrase) {
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf),
+                       "<html>\n"
+                       "<head><title>%s %s</title></head>\n"
+                       "<body>\n"
+                       "<center><h1>%s %s</h1></center>\n"
+                       "</body>\n"
+                       "</html>\n",
+                       code, phrase, code, phrase);
+
+    set_status(res, code, phrase);
+    header_put(res, "Content-Type", "text/html");
+    if (req->method_ty != HMMT_HEAD) {
+        res->body = strdup(buf);
+        res->body_len = len;
+    }
+    sprintf(buf, "%d", len);
+    header_put(res, "Content-Length", buf);
+}
+
+/**
+ * Reads the file from the start, up to len bytes.
+ *
+ * @return the bytes read
+ * @param fd the file descriptor
+ * @param dest the buffer of len bytes
+ * @param len the length of the file
+ */
+static off_t file_read(int fd, char *dest, off_t len) {
+    off_t off = 0;
+    ssize_t n;
+
+    while (off < len && (n = pread(fd, dest + off, len - off, off)) > 0)
+        off += n;
+
+    return off;
+}
+
+/**
+ * Opens the file to stream as the body by File_open(), and advises the
+ * kernel that the file is read sequentially so that it reads ahead
+ * aggressively.
+ *
+ * @return file descriptor, or -1 with errno if error occurred
+ */
+static int open_body(File *file) {
+    int fd = File_open(file);
+
+    if (fd != -1)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
-    return len;
+    return fd;
 }
 
 static char *formatted_time(struct tm *, long);
-static bool is_locked();
-static int lock();
-static void unlock();
 
-static void write_msg(HttpMessage *req, HttpMessage *res, FILE *f) {
+/**
+ * Writes the range of the file to the stream in chunks of STREAM_CHUNK_SIZE.
+ * Uses sendfile(2) to avoid copying the range to the user space, falls back
+ * to pread(2) if the stream does not support it. Memory used does not depend
+ * on the length of the range.
+ *
+ * @return bytes written
+ */
+static off_t write_range(FILE *f, int fd, off_t offset, off_t len) {
+    static char buf[STREAM_CHUNK_SIZE];
+    off_t written = 0;
+
+    fflush(f);
+    while (len > 0) {
+        ssize_t n = sendfile(fileno(f), fd, &offset,
+                             len < STREAM_CHUNK_SIZE ? len : STREAM_CHUNK_SIZE);
+        if (n <= 0)
+            break;
+        written += n;
+        len -= n;
+    }
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len < sizeof(buf) ? len : sizeof(buf),
+                          offset);
+        if (n <= 0)
+            break;
+        written += fwrite(buf, 1, n, f);
+        offset += n;
+        len -= n;
+    }
+    return written;
+}
+
+/**
+ * Writes the string escaped for HTML, or percent-encoded for the path of URL.
+ */
+static void write_escaped(ChunkedWriter *w, const char *str, bool url) {
+    for (const char *p = str; *p; p++) {
+        unsigned char c = *p;
+        if (url) {
+            if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+                ('0' <= c && c <= '9') || strchr("-._~/", c) != NULL)
+                ChunkedWriter_write(w, p, 1);
+            else
+                ChunkedWriter_printf(w, "%%%02X", c);
+            continue;
+        }
+        switch (c) {
+        case '&':
+            ChunkedWriter_printf(w, "&amp;");
+            break;
+        case '<':
+            ChunkedWriter_printf(w, "&lt;");
+            break;
+        case '>':
+            ChunkedWriter_printf(w, "&gt;");
+            break;
+        case '"':
+            ChunkedWriter_printf(w, "&quot;");
+            break;
+        default:
+            ChunkedWriter_write(w, p, 1);
+        }
+    }
+}
+
+/**
+ * Generates the listing of the directory entry by entry.
+ *
+ * @param w
+ * @param arg a pointer to DirListing
+ */
+static void write_dir_listing(ChunkedWriter *w, void *arg) {
+    DirListing *dl = arg;
+    bool root = strcmp(dl->uri, "/") == 0;
+    bool slash = dl->uri[strlen(dl->uri) - 1] == '/';
+
+    ChunkedWriter_printf(w, "<html>\n<head><title>Index of ");
+    write_escaped(w, dl->uri, false);
+    ChunkedWriter_printf(w, "</title></head>\n<body>\n<h1>Index of ");
+    write_escaped(w, dl->uri, false);
+    ChunkedWriter_printf(w, "</h1>\n<hr>\n<ul>\n");
+
+    DIR *dir = opendir(dl->path);
+    struct dirent *ent;
+    while (dir != NULL && (ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 ||
+            (root && strcmp(ent->d_name, "..") == 0))
+            continue;
+
+        ChunkedWriter_printf(w, "<li><a href=\"");
+        write_escaped(w, dl->uri, true);
+        if (!slash)
+            ChunkedWriter_write(w, "/", 1);
+        write_escaped(w, ent->d_name, true);
+        ChunkedWriter_printf(w, "%s\">", ent->d_type == DT_DIR ? "/" : "");
+        write_escaped(w, ent->d_name, false);
+        ChunkedWriter_printf(w, "%s</a></li>\n",
+                             ent->d_type == DT_DIR ? "/" : "");
+    }
+    if (dir != NULL)
+        closedir(dir);
+
+    ChunkedWriter_printf(w, "</ul>\n<hr>\n</body>\n</html>\n");
+}
+
+/// records the time the first byte of the response is written
+static void stamp_first_sent(PhaseTimes *t) {
+    if (t != NULL && t->first_sent == 0)
+        t->first_sent = monotonic_ns();
+}
+
+/**
+ * Writes the response. The body is written unless the request is HEAD.
+ *
+ * @param req
+ * @param res
+ * @param f
+ * @param t records first_sent and last_sent, or NULL
+ * @return bytes written
+ */
+static off_t write_msg(HttpMessage *req, HttpMessage *res, FILE *f,
+                       PhaseTimes *t) {
     assert(req->_ty == HM_REQ);
     assert(res->_ty == HM_RES);
+    off_t written = 0;
+
+    // the length of generated body is unknown, so use the chunked
+    // transfer-coding, or close the connection if the client is HTTP/1.0.
+    bool chunked = req->http_version != NULL &&
+                   strcmp(req->http_version, HTTP_VERSION) == 0;
+    if (res->body_producer != NULL &&
+        header_get(res, "Content-Length", NULL) == NULL) {
+        if (chunked)
+            header_put(res, "Transfer-Encoding", "chunked");
+        else
+            header_replace(res, "Connection", "close");
+    }
 
     // status_line
-    fprintf(f, "%s %s %s\r\n", res->http_version, res->status_code,
-            res->reason_phrase);
+    written += fprintf(f, "%s %s %s\r\n", res->http_version,
+                       res->status_code, res->reason_phrase);
 
     // headers
     Map *map = res->header_map;
     for (int i = 0; i < map->keys->len; i++) {
-        fprintf(f, "%s: %s\r\n", (char *)map->keys->data[i],
-                (char *)map->vals->data[i]);
+        written += fprintf(f, "%s: %s\r\n", (char *)map->keys->data[i],
+                           (char *)map->vals->data[i]);
     }
 
     // CRLF
-    fprintf(f, "\r\n");
-
-    if (req->method_ty != HMMT_HEAD)
-        for (int i = 0; i < res->body_len; i++) {
-            fputc(res->body[i], f);
+    written += fprintf(f, "\r\n");
+
+    if (req->method_ty != HMMT_HEAD && res->body != NULL)
+        written += fwrite(res->body, 1, res->body_len, f);
+
+    if (req->method_ty != HMMT_HEAD && res->body_parts != NULL)
+        for (int i = 0; i < res->body_parts->len; i++) {
+            BodyPart *part = res->body_parts->data[i];
+            if (part->buf != NULL)
+                written += fwrite(part->buf, 1, part->len, f);
+            else {
+                stamp_first_sent(t); // write_range() flushes first
+                written +=
+                    write_range(f, res->body_fd, part->offset, part->len);
+            }
         }
 
+    if (req->method_ty != HMMT_HEAD && res->body_producer != NULL) {
+        // sends the headers before generating the body
+        stamp_first_sent(t);
+        fflush(f);
+
+        ChunkedWriter *w = new_ChunkedWriter(f, chunked);
+        res->body_producer(w, res->body_arg);
+        ChunkedWriter_close(w);
+        written += w->written;
+        delete_ChunkedWriter(w);
+    }
+
+    stamp_first_sent(t);
     fflush(f);
-}
+    if (t != NULL)
+        t->last_sent = monotonic_ns();
 
-static int write_log(FILE *out, Socket *sock, time_t *req_time,
-                     HttpMessage *req, HttpMessage *res) {
-    struct tm req_tm;
-    int size;
-    localtime_r(req_time, &req_tm);
+    return written;
+}
 
-    do {
-        while (is_locked()) {
-            sleep(1);
-        }
-    } while (lock() == -1);
+static int write_log(AccessLog *log, Socket *sock, time_t *req_time,
+                     PhaseTimes *t, HttpMessage *req, HttpMessage *res) {
+    LogEntry e = {
+        .time = *req_time,
+        .remote_addr = inet_ntoa(sock->addr->sin_addr),
+        .time_local = time_cache(*req_time)->log_time,
+        .request = req->request_line,
+        .status = res->status_code,
+        .body_bytes_sent = header_get(res, "Content-Length", "\"-\""),
+        .http_referer = header_get(req, "Referer", "-"),
+        .http_user_agent = header_get(req, "User-Agent", "-"),
+        .request_time = t->last_sent - t->received,
+        .phases = *t,
+    };
+
+    return AccessLog_write(log, &e, *req_time);
+}
 
-    char *buf;
+/**
+ * Prints the durations of the phases of the request to stderr, for -d.
+ * send_first spans from the built response to its first byte written, unlike
+ * $first_byte_time of the access log, which spans from the request.
+ */
+static void print_phases(HttpMessage *req, HttpMessage *res, PhaseTimes *t) {
     // clang-format off
-    size = fprintf(out, "%s - - [%s] \"%s\" %s %s \"%s\" \"%s\"\n",
-                   inet_ntoa(sock->addr->sin_addr),
-                   buf = formatted_time(&req_tm, timezone),
-                   req->request_line,
-                   res->status_code,
-                   header_get(res, "Content-Length", "\"-\""),
-                   header_get(req, "Referer", "-"),
-                   header_get(req, "User-Agent", "-"));
+    fprintf(stderr,
+            "pid: %d, \"%s\" %s: parse %.6f build %.6f send_first %.6f "
+            "send %.6f total %.6f\n",
+            getpid(), req->request_line, res->status_code,
+            (t->parsed - t->received) / 1e9,
+            (t->built - t->parsed) / 1e9,
+            (t->first_sent - t->built) / 1e9,
+            (t->last_sent - t->first_sent) / 1e9,
+            (t->last_sent - t->received) / 1e9);
     // clang-format on
-    fflush(out);
+}
+
+/**
+ * Returns the strings of the time. They are rendered only if the second
+ * differs from the last call.
+ *
+ * @return the cache of this worker
+ * @param t the time
+ */
+static TimeCache *time_cache(time_t t) {
+    struct tm t_tm;
+
+    if (t == Now.sec && Now.log_time[0] != '\0')
+        return &Now;
 
-    unlock();
+    localtime_r(&t, &t_tm);
+    char *buf = formatted_time(&t_tm, timezone);
+    strcpy(Now.log_time, buf);
     free(buf);
 
-    return size;
+    gmtime_r(&t, &t_tm);
+    strftime(Now.http_date, sizeof(Now.http_date),
+             "%a, %d %b %Y %H:%M:%S GMT", &t_tm);
+
+    Now.sec = t;
+    return &Now;
 }
 
 /**
@@ -358,24 +1118,166 @@ static char *formatted_time(struct tm *t_tm, long timezone) {
     return buf;
 }
 
-static bool is_locked() {
-    int fd;
-    if ((fd = open("/var/lock/dali.pid", O_RDONLY)) != -1) {
-        close(fd);
-        return true;
+/// requests of the loopback, of the document root www
+static const char *const LoopbackCorpus[] = {
+    "GET /hello.html HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "User-Agent: curl/7.88.1\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+    "GET /hello.html?v=20201013 HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/86.0.4240.75 Safari/537.36\r\n"
+    "Accept: text/html,*/*;q=0.8\r\n"
+    "Referer: http://localhost:8088/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: ja,en-US;q=0.9,en;q=0.8\r\n"
+    "\r\n",
+    "HEAD /hello.html HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "User-Agent: Wget/1.20.3 (linux-gnu)\r\n"
+    "\r\n",
+    "GET /favicon.ico HTTP/1.1\r\n"
+    "Host: localhost:8088\r\n"
+    "User-Agent: curl/7.88.1\r\n"
+    "\r\n",
+};
+
+/// requests of every kind of response, for the test of steady-state memory
+static const char *const SteadyCorpus[] = {
+    "GET /hello.html HTTP/1.1\r\n"
+    "Range: bytes=0-4,-3\r\n"
+    "\r\n",
+    "GET /hello.html HTTP/1.1\r\n"
+    "If-Modified-Since: Fri, 31 Dec 9999 23:59:59 GMT\r\n"
+    "\r\n",
+    "GET / HTTP/1.1\r\n"
+    "\r\n",
+    "GET /hello.html HTTP/1.0\r\n"
+    "Accept-Encoding: gzip\r\n"
+    "\r\n",
+    "POST /hello.html HTTP/1.1\r\n"
+    "\r\n",
+    "GET /hello.html\r\n"
+    "\r\n",
+};
+
+typedef struct {
+    Option *opt;
+    AccessLog *log;
+    const char *const *corpus;
+    int ncorpus;
+} Loopback;
+
+/**
+ * Sends n requests of the corpus to handle_connection() over
+ * socketpair(2), LOOPBACK_BATCH requests per connection. The requests are
+ * written before, and the responses are read after, handle_connection()
+ * runs, as the buffers of the socket hold them, so that neither the network
+ * nor another thread is measured.
+ */
+static void bench_handle_connection(void *arg, long n) {
+    Loopback *lb = arg;
+    Exception *ex = calloc(1, sizeof(Exception));
+    static char buf[64 * 1024];
+
+    for (long i = 0; i < n;) {
+        int fds[2]; // the server, the client
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+            error("Error: socketpair: %s", strerror(errno));
+        for (int k = 0; k < LOOPBACK_BATCH && i < n; k++, i++) {
+            const char *req = lb->corpus[i % lb->ncorpus];
+            ssize_t len = strlen(req);
+            if (write(fds[1], req, len) != len)
+                error("Error: write: %s", strerror(errno));
+        }
+        shutdown(fds[1], SHUT_WR);
+
+        Socket *sock = new_ConnectedSocket(fds[0], ex);
+        sock->addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        handle_connection(sock, lb->log, lb->opt);
+        delete_Socket(sock);
+
+        ssize_t len;
+        while ((len = read(fds[1], buf, sizeof(buf))) > 0)
+            BenchSink += len;
+        close(fds[1]);
     }
+    free(ex);
+}
 
-    return false;
+/**
+ * SIGTERM while a keep-alive connection waits for the next request ends the
+ * connection, instead of the worker waiting for the client to close it.
+ */
+static void test_handle_connection_terminated() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = "www";
+    AccessLog *log = new_AccessLog("/dev/null", ex);
+    char buf[64];
+    int fds[2]; // the server, the client
+
+    expect(__LINE__, 0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    const char *req = "GET /hello.html HTTP/1.1\r\n\r\n";
+    expect(__LINE__, strlen(req), write(fds[1], req, strlen(req)));
+
+    // the client keeps the connection open
+    Terminated = 1;
+    Socket *sock = new_ConnectedSocket(fds[0], ex);
+    sock->addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    handle_connection(sock, log, opt);
+    delete_Socket(sock);
+    Terminated = 0;
+
+    expect(__LINE__, sizeof(buf), read(fds[1], buf, sizeof(buf)));
+    expect_bool(__LINE__, true, strncmp(buf, "HTTP/1.1 200 ", 13) == 0);
+    close(fds[1]);
+
+    delete_AccessLog(log);
+    free(opt);
+    free(ex);
 }
 
-static int lock() {
-    int fd = open("/var/lock/dali.pid", O_CREAT | O_EXCL);
-    close(fd);
-    return fd;
+/// bytes allocated with malloc(3) and in use
+static size_t malloc_in_use() {
+#if __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#else
+    // mallinfo2(3) is of glibc 2.33, e.g. not of Ubuntu 20.04. the int
+    // fields wrap above 2GB, far more than the tests use.
+    return (unsigned)mallinfo().uordblks;
+#endif
 }
 
-static void unlock() {
-    unlink("/var/lock/dali.pid");
+/**
+ * Memory in use does not grow with requests once caches are warm, so that
+ * workers run for weeks. The loopback is of every kind of response.
+ */
+static void test_handle_connection_steady() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    Loopback lb = {
+        .opt = calloc(1, sizeof(Option)),
+        .corpus = SteadyCorpus,
+        .ncorpus = sizeof(SteadyCorpus) / sizeof(*SteadyCorpus),
+    };
+    lb.opt->document_root = "www";
+    lb.opt->compress = true;
+    lb.log = new_AccessLog("/dev/null", ex);
+    expect(__LINE__, E_Okay, ex->ty);
+
+    // a leak of the smallest chunk would grow 160KB in 10000 requests, while
+    // chunks kept by the thread cache of malloc(3) count as in use.
+    bench_handle_connection(&lb, 1000);
+    size_t in_use = malloc_in_use();
+    bench_handle_connection(&lb, 10000);
+    expect_bool(__LINE__, true, malloc_in_use() < in_use + 4096);
+
+    delete_AccessLog(lb.log);
+    free(lb.opt);
+    free(ex);
 }
 
 static void test_formatted_time() {
@@ -405,10 +1307,24 @@ static void test_formatted_time() {
                formatted_time(&t_tm, -(9 * 60 * 60)));
 }
 
+static void test_time_cache() {
+    TimeCache *tc = time_cache(784111777);
+    expect_str(__LINE__, "Sun, 06 Nov 1994 08:49:37 GMT", tc->http_date);
+    expect(__LINE__, strlen("06/Nov/1994:08:49:37 +0000"),
+           strlen(tc->log_time));
+
+    // not rendered in the same second
+    tc->http_date[0] = 'X';
+    expect_str(__LINE__, "Xun, 06 Nov 1994 08:49:37 GMT",
+               time_cache(784111777)->http_date);
+    expect_str(__LINE__, "Sun, 06 Nov 1994 08:49:38 GMT",
+               time_cache(784111778)->http_date);
+}
+
 static void test_new_HttpResponse() {
     HttpMessage *res;
     HttpMessage *req = new_HttpMessage(HM_REQ);
-    Option *opt = malloc(sizeof(Option));
+    Option *opt = calloc(1, sizeof(Option));
     opt->document_root = strdup("www");
     Exception *ex = calloc(1, sizeof(Exception));
 
@@ -418,6 +1334,9 @@ static void test_new_HttpResponse() {
     res = new_HttpResponse(req, opt, ex);
     expect(__LINE__, HM_RES, res->_ty);
     expect_str(__LINE__, "405", res->status_code);
+    expect_str(__LINE__, HTTP_VERSION, res->http_version);
+    expect(__LINE__, strlen("Sun, 06 Nov 1994 08:49:37 GMT"),
+           strlen(header_get(res, "Date", "")));
 
     // GET not exist filename
     req->method = strdup("GET");
@@ -457,19 +1376,424 @@ static void test_new_HttpResponse() {
     expect_str(__LINE__, "200", res->status_code);
     expect_ptr(__LINE__, NULL, res->body);
 
+    // the file is looked up in the cache, and not cached twice
+    int len = Files->len;
+    long lookups = Files->hits + Files->misses;
+    res = new_HttpResponse(req, opt, ex);
+    expect(__LINE__, len, Files->len);
+    expect(__LINE__, lookups + 1, Files->hits + Files->misses);
+
     free(opt);
     free(ex);
 }
 
-static void test_file_read() {
-    File *file = new_File("LICENSE");
-
-    char *buf = malloc(file->len);
-    int len = file_read(file, buf);
-
-    expect(__LINE__, 'M', buf[0]);
-    expect(__LINE__, 1064, len);
+static void test_new_HttpResponse_compress() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = ".";
+    opt->compress = true;
+    Exception *ex = calloc(1, sizeof(Exception));
+
+    req->method_ty = HMMT_GET;
+    req->filename = strdup("/LICENSE");
+    header_put(req, "Accept-Encoding", "gzip, deflate");
+
+    // compressed
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, "gzip", header_get(res, "Content-Encoding", ""));
+    expect_str(__LINE__, "Accept-Encoding", header_get(res, "Vary", ""));
+    expect_bool(__LINE__, true, res->body_len < 1064);
+    expect(__LINE__, res->body_len,
+           atoi(header_get(res, "Content-Length", "")));
+    expect(__LINE__, 0x1f, (unsigned char)res->body[0]);
+    delete_HttpMessage(res);
+
+    // compressed variant is taken from the cache
+    long hits = Cache->hits;
+    res = new_HttpResponse(req, opt, ex);
+    expect(__LINE__, hits + 1, Cache->hits);
+    delete_HttpMessage(res);
+
+    // identity
+    delete_HttpMessage(req);
+    req = new_HttpMessage(HM_REQ);
+    req->method_ty = HMMT_GET;
+    req->filename = strdup("/LICENSE");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "", header_get(res, "Content-Encoding", ""));
+    expect_str(__LINE__, "Accept-Encoding", header_get(res, "Vary", ""));
+    expect(__LINE__, 1064, res->body_len);
+    delete_HttpMessage(res);
+
+    // HEAD is not compressed
+    req->method_ty = HMMT_HEAD;
+    header_put(req, "Accept-Encoding", "gzip");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "", header_get(res, "Content-Encoding", ""));
+    expect_str(__LINE__, "Accept-Encoding", header_get(res, "Vary", ""));
+    expect_str(__LINE__, "1064", header_get(res, "Content-Length", ""));
+    expect_ptr(__LINE__, NULL, res->body);
+    delete_HttpMessage(res);
+    req->method_ty = HMMT_GET;
+
+    // not compressible
+    opt->document_root = "www";
+    free(req->filename);
+    req->filename = strdup("/hello.html"); // smaller than COMPRESS_MIN_SIZE
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "", header_get(res, "Content-Encoding", ""));
+    expect_str(__LINE__, "Accept-Encoding", header_get(res, "Vary", ""));
+    delete_HttpMessage(res);
+
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
+}
+
+static void test_new_HttpResponse_range() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = ".";
+    opt->compress = true;
+    Exception *ex = calloc(1, sizeof(Exception));
+    FILE *f;
+    char buf[1024];
+
+    req->method_ty = HMMT_GET;
+    req->filename = strdup("/LICENSE");
+    header_put(req, "Accept-Encoding", "gzip");
+
+    // no Range
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "bytes", header_get(res, "Accept-Ranges", ""));
+    delete_HttpMessage(res);
+
+    // single range, not compressed
+    header_put(req, "Range", "bytes=0-10");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "206", res->status_code);
+    expect_str(__LINE__, "bytes 0-10/1064",
+               header_get(res, "Content-Range", ""));
+    expect_str(__LINE__, "11", header_get(res, "Content-Length", ""));
+    expect_str(__LINE__, "", header_get(res, "Content-Encoding", ""));
+    expect_ptr(__LINE__, NULL, res->body);
+
+    f = tmpfile();
+    PhaseTimes t = {0};
+    write_msg(req, res, f, &t);
+    expect_bool(__LINE__, true, 0 < t.first_sent);
+    expect_bool(__LINE__, true, t.first_sent <= t.last_sent);
+    rewind(f);
+    while (fgets(buf, sizeof(buf), f) != NULL && strcmp(buf, "\r\n") != 0)
+        ;
+    expect_str(__LINE__, "MIT License", fgets(buf, sizeof(buf), f));
+    fclose(f);
+    delete_HttpMessage(res);
+
+    // multiple ranges
+    header_put(req, "Range", "bytes=0-2,-4");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "206", res->status_code);
+    expect_str(__LINE__,
+               "multipart/byteranges; boundary=" BYTERANGES_BOUNDARY,
+               header_get(res, "Content-Type", ""));
+    expect(__LINE__, res->body_len,
+           atoi(header_get(res, "Content-Length", "")));
+
+    f = tmpfile();
+    write_msg(req, res, f, NULL);
+    long header_len = 0;
+    rewind(f);
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        header_len += strlen(buf);
+        if (strcmp(buf, "\r\n") == 0)
+            break;
+    }
+    fseek(f, 0, SEEK_END);
+    expect(__LINE__, res->body_len, ftell(f) - header_len);
+    fseek(f, header_len, SEEK_SET);
+    expect_str(__LINE__, "\r\n", fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "--" BYTERANGES_BOUNDARY "\r\n",
+               fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "Content-Type: text/plain\r\n",
+               fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "Content-Range: bytes 0-2/1064\r\n",
+               fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "\r\n", fgets(buf, sizeof(buf), f));
+    expect_str(__LINE__, "MIT\r\n", fgets(buf, sizeof(buf), f));
+    fclose(f);
+    delete_HttpMessage(res);
+
+    // not satisfiable
+    header_put(req, "Range", "bytes=1064-");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "416", res->status_code);
+    expect_str(__LINE__, "bytes */1064", header_get(res, "Content-Range", ""));
+    delete_HttpMessage(res);
+
+    // invalid Range is ignored
+    header_put(req, "Range", "lines=0-1");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    delete_HttpMessage(res);
+
+    // Range is ignored except GET
+    header_put(req, "Range", "bytes=0-1");
+    req->method_ty = HMMT_HEAD;
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    delete_HttpMessage(res);
+
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
+}
+
+static void test_new_HttpResponse_conditional() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = ".";
+    opt->compress = true;
+    Exception *ex = calloc(1, sizeof(Exception));
+    File *file = new_File("LICENSE");
+
+    req->method_ty = HMMT_GET;
+    req->filename = strdup("/LICENSE");
+
+    // validators
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, file->etag, header_get(res, "ETag", ""));
+    expect_str(__LINE__, file->last_modified,
+               header_get(res, "Last-Modified", ""));
+    delete_HttpMessage(res);
+
+    // If-Modified-Since
+    header_put(req, "If-Modified-Since", file->last_modified);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "304", res->status_code);
+    expect_ptr(__LINE__, NULL, res->body);
+    expect_str(__LINE__, "", header_get(res, "Content-Length", ""));
+    expect_str(__LINE__, "Accept-Encoding", header_get(res, "Vary", ""));
+    delete_HttpMessage(res);
+
+    header_put(req, "If-Modified-Since", "Thu, 01 Jan 1970 00:00:00 GMT");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    delete_HttpMessage(res);
+
+    // If-None-Match takes precedence over If-Modified-Since
+    header_put(req, "If-None-Match", file->etag);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "304", res->status_code);
+    delete_HttpMessage(res);
+
+    header_put(req, "If-None-Match", "\"other\"");
+    header_put(req, "If-Modified-Since", file->last_modified);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    delete_HttpMessage(res);
+
+    // the entity-tag of the compressed variant
+    header_put(req, "If-None-Match", "\"other\"");
+    header_put(req, "Accept-Encoding", "gzip");
+    res = new_HttpResponse(req, opt, ex);
+    char *etag = strdup(header_get(res, "ETag", ""));
+    expect_bool(__LINE__, true, strstr(etag, "-gzip\"") != NULL);
+    delete_HttpMessage(res);
+
+    header_put(req, "If-None-Match", etag);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "304", res->status_code);
+    expect_str(__LINE__, etag, header_get(res, "ETag", ""));
+    delete_HttpMessage(res);
+
+    // of the identity, as a 200 to HEAD is not compressed
+    req->method_ty = HMMT_HEAD;
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "304", res->status_code);
+    expect_str(__LINE__, file->etag, header_get(res, "ETag", ""));
+    delete_HttpMessage(res);
+    req->method_ty = HMMT_GET;
+    free(etag);
+
+    // If-Range
+    delete_HttpMessage(req);
+    req = new_HttpMessage(HM_REQ);
+    req->method_ty = HMMT_GET;
+    req->filename = strdup("/LICENSE");
+    header_put(req, "Range", "bytes=0-1");
+    header_put(req, "If-Range", file->etag);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "206", res->status_code);
+    delete_HttpMessage(res);
+
+    header_put(req, "If-Range", "\"other\"");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    delete_HttpMessage(res);
+
+    delete_HttpMessage(req);
     delete_File(file);
+    free(opt);
+    free(ex);
+}
+
+static void test_new_HttpResponse_large_file() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    Exception *ex = calloc(1, sizeof(Exception));
+    char path[] = "/tmp/dali_XXXXXX";
+    off_t size = 3LL * 1024 * 1024 * 1024; // 3 GiB, sparse
+
+    int fd = mkstemp(path);
+    ftruncate(fd, size);
+    close(fd);
+    opt->document_root = "/tmp";
+    req->method_ty = HMMT_GET;
+    req->filename = strdup(path + strlen("/tmp"));
+
+    // the body is not read into memory
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, "3221225472", header_get(res, "Content-Length", ""));
+    expect_bool(__LINE__, true, res->body_len == size);
+    expect_ptr(__LINE__, NULL, res->body);
+    expect_bool(__LINE__, true, res->body_fd != -1);
+    delete_HttpMessage(res);
+
+    // range beyond 2 GiB
+    header_put(req, "Range", "bytes=-10");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "206", res->status_code);
+    expect_str(__LINE__, "bytes 3221225462-3221225471/3221225472",
+               header_get(res, "Content-Range", ""));
+
+    FILE *f = tmpfile();
+    write_msg(req, res, f, NULL);
+    fseek(f, -10, SEEK_END);
+    expect(__LINE__, 0, fgetc(f));
+    fclose(f);
+    delete_HttpMessage(res);
+
+    unlink(path);
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
+}
+
+/// the file changes between requests, in the time it is cached
+static void test_new_HttpResponse_changed() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    Exception *ex = calloc(1, sizeof(Exception));
+    char path[] = "/tmp/dali_XXXXXX";
+
+    int fd = mkstemp(path);
+    expect(__LINE__, 0, ftruncate(fd, 5000));
+    close(fd);
+    opt->document_root = "/tmp";
+    req->method_ty = HMMT_GET;
+    req->filename = strdup(path + strlen("/tmp"));
+
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "5000", header_get(res, "Content-Length", ""));
+    delete_HttpMessage(res);
+
+    // truncated: the length of the open file
+    expect(__LINE__, 0, truncate(path, 10));
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, "10", header_get(res, "Content-Length", ""));
+    expect_bool(__LINE__, true, res->body_len == 10);
+    delete_HttpMessage(res);
+
+    // removed
+    unlink(path);
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "404", res->status_code);
+    expect(__LINE__, res->body_len,
+           atoi(header_get(res, "Content-Length", "")));
+    delete_HttpMessage(res);
+    // and not cached until the entry is stale
+    expect_ptr(__LINE__, NULL, FileCache_get(Files, path, time(NULL)));
+
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
+}
+
+static void test_new_HttpResponse_autoindex() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = "www";
+    Exception *ex = calloc(1, sizeof(Exception));
+    FILE *f;
+    char buf[1024];
+
+    req->method_ty = HMMT_GET;
+    req->http_version = strdup("HTTP/1.1");
+    req->filename = strdup("/");
+
+    // disabled
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "404", res->status_code);
+    delete_HttpMessage(res);
+
+    // chunked
+    opt->autoindex = true;
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, "", header_get(res, "Content-Length", ""));
+
+    f = tmpfile();
+    write_msg(req, res, f, NULL);
+    expect_str(__LINE__, "chunked", header_get(res, "Transfer-Encoding", ""));
+    rewind(f);
+    char *entry = "<li><a href=\"/hello.html\">hello.html</a></li>\n";
+    bool found = false;
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        if (strcmp(buf, entry) == 0)
+            found = true;
+    }
+    expect_bool(__LINE__, true, found);
+    fseek(f, -5, SEEK_END);
+    buf[fread(buf, 1, 5, f)] = '\0';
+    expect_str(__LINE__, "0\r\n\r\n", buf);
+    fclose(f);
+    delete_HttpMessage(res);
+
+    // HTTP/1.0 client
+    free(req->http_version);
+    req->http_version = strdup("HTTP/1.0");
+    res = new_HttpResponse(req, opt, ex);
+    f = tmpfile();
+    write_msg(req, res, f, NULL);
+    fclose(f);
+    expect_str(__LINE__, "", header_get(res, "Transfer-Encoding", ""));
+    expect_str(__LINE__, "close", header_get(res, "Connection", ""));
+    delete_HttpMessage(res);
+
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
+}
+
+static void test_file_read() {
+    int fd = open("LICENSE", O_RDONLY);
+    char buf[1064 + 1];
+
+    expect(__LINE__, 1064, file_read(fd, buf, sizeof(buf)));
+    expect(__LINE__, 'M', buf[0]);
+    expect(__LINE__, 10, file_read(fd, buf, 10)); // from the start again
+    close(fd);
 }
 
 static void test_write_log() {
@@ -489,18 +1813,23 @@ static void test_write_log() {
     header_put(res, "Content-Length", "199");
 
     time_t req_time = 1602737916;
-    FILE *log = tmpfile();
-    int len = write_log(log, sock, &req_time, req, res);
+    char path[] = "/tmp/dali_log_XXXXXX";
+    close(mkstemp(path));
+    AccessLog *log = new_AccessLog(path, ex);
+    PhaseTimes t = {.received = 1000000000, .last_sent = 1012000000};
+    int len = write_log(log, sock, &req_time, &t, req, res);
+    delete_AccessLog(log);
     delete_HttpMessage(req);
     delete_HttpMessage(res);
 
     //
     // read log
     //
-    rewind(log);
+    FILE *f = fopen(path, "r");
     char *buf = malloc(len - strlen("\n") + 1);
-    fgets(buf, len - strlen("\n") + 1, log);
-    fclose(log);
+    fgets(buf, len - strlen("\n") + 1, f);
+    fclose(f);
+    unlink(path);
 
     //
     // check
@@ -531,20 +1860,200 @@ static void test_write_log() {
     free(ex);
 }
 
-static void test_get_mime_type() {
-    // clang-format off
-    expect_str(__LINE__, "text/html",  get_mime_type("www/index.html"));
-    expect_str(__LINE__, "text/html",  get_mime_type("/index.html"));  
-    expect_str(__LINE__, "text/plain", get_mime_type("www/extless"));
-    expect_str(__LINE__, "text/plain", get_mime_type("a.unknownext"));
-    expect_str(__LINE__, "text/plain", get_mime_type(".dotfile"));
-    // clang-format on  
+static void test_new_HttpResponse_status() {
+    HttpMessage *res;
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    Option *opt = calloc(1, sizeof(Option));
+    opt->document_root = "www";
+    Exception *ex = calloc(1, sizeof(Exception));
+    char buf[256];
+
+    req->method_ty = HMMT_GET;
+    req->http_version = strdup("HTTP/1.1");
+    req->request_uri = strdup(STATUS_URI);
+    req->filename = strdup(STATUS_URI);
+
+    // without scoreboard
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "404", res->status_code);
+    delete_HttpMessage(res);
+
+    Board = new_Scoreboard(1, ex);
+    Slot = &Board->slots[0];
+    WorkerSlot_countRequest(Slot, "200", 123);
+
+    // without -s, the document root is looked up
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "404", res->status_code);
+    delete_HttpMessage(res);
+
+    // Prometheus text format
+    opt->status = true;
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_str(__LINE__, "text/plain; version=0.0.4",
+               header_get(res, "Content-Type", ""));
+    expect_bool(__LINE__, true,
+                strstr(res->body, "\ndali_requests_total 1\n") != NULL);
+
+    // bytes written are counted
+    FILE *f = tmpfile();
+    off_t written = write_msg(req, res, f, NULL);
+    expect(__LINE__, ftell(f), written);
+    fclose(f);
+    delete_HttpMessage(res);
+
+    // JSON
+    free(req->request_uri);
+    req->request_uri = strdup(STATUS_URI "?format=json");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "application/json",
+               header_get(res, "Content-Type", ""));
+    snprintf(buf, sizeof(buf), "%zu", strlen(res->body));
+    expect_str(__LINE__, buf, header_get(res, "Content-Length", ""));
+    delete_HttpMessage(res);
+
+    free(req->request_uri);
+    req->request_uri = strdup(STATUS_URI);
+    header_put(req, "Accept", "application/json");
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "application/json",
+               header_get(res, "Content-Type", ""));
+    delete_HttpMessage(res);
+
+    // HEAD
+    req->method_ty = HMMT_HEAD;
+    res = new_HttpResponse(req, opt, ex);
+    expect_str(__LINE__, "200", res->status_code);
+    expect_ptr(__LINE__, NULL, res->body);
+    delete_HttpMessage(res);
+
+    delete_Scoreboard(Board);
+    Board = NULL;
+    Slot = NULL;
+    delete_HttpMessage(req);
+    free(opt);
+    free(ex);
 }
 
 void run_all_test_server() {
-  test_get_mime_type();
   test_formatted_time();
+  test_time_cache();
   test_new_HttpResponse();
+  test_new_HttpResponse_compress();
+  test_new_HttpResponse_range();
+  test_new_HttpResponse_conditional();
+  test_new_HttpResponse_large_file();
+  test_new_HttpResponse_changed();
+  test_new_HttpResponse_autoindex();
+  test_new_HttpResponse_status();
   test_file_read();
   test_write_log();
+  test_handle_connection_terminated();
+  test_handle_connection_steady();
+}
+
+static void bench_formatted_time(void *arg, long n) {
+    time_t t = 1602589880;
+    struct tm t_tm;
+    gmtime_r(&t, &t_tm);
+
+    for (long i = 0; i < n; i++) {
+        char *buf = formatted_time(&t_tm, -(9 * 60 * 60));
+        BenchSink += buf[0];
+        free(buf);
+    }
+}
+
+/// writes a response of 1KiB with typical headers into a memory stream
+static void bench_write_msg(void *arg, long n) {
+    static char out[16 * 1024];
+    FILE *f = fmemopen(out, sizeof(out), "w");
+
+    HttpMessage *req = new_HttpMessage(HM_REQ);
+    req->method = strdup("GET");
+    req->method_ty = HMMT_GET;
+    req->http_version = strdup(HTTP_VERSION);
+
+    HttpMessage *res = new_HttpMessage(HM_RES);
+    res->http_version = strdup(HTTP_VERSION);
+    res->status_code = strdup("200");
+    res->reason_phrase = strdup("OK");
+    header_put(res, "Date", "Tue, 13 Oct 2020 11:51:20 GMT");
+    header_put(res, "Server", SERVER_NAME);
+    header_put(res, "Content-Type", "text/html");
+    header_put(res, "Content-Length", "1024");
+    header_put(res, "Last-Modified", "Tue, 13 Oct 2020 11:51:20 GMT");
+    header_put(res, "ETag", "\"5f85a2b8-400\"");
+    header_put(res, "Accept-Ranges", "bytes");
+    res->body = calloc(1024, 1);
+    res->body_len = 1024;
+
+    for (long i = 0; i < n; i++) {
+        rewind(f);
+        BenchSink += write_msg(req, res, f, NULL);
+    }
+
+    delete_HttpMessage(req);
+    delete_HttpMessage(res);
+    fclose(f);
+}
+
+/**
+ * Prints the rate of requests per second of CPU time, and cycles and
+ * instructions per request in user space if they are counted, of
+ * LOOPBACK_REQUESTS requests of the loopback.
+ */
+static void report_loopback(Loopback *lb) {
+    Exception *ex = calloc(1, sizeof(Exception));
+    uint64_t before[PE_NEVENTS], after[PE_NEVENTS];
+    struct timespec t0, t1;
+
+    PerfCounters *pc = new_PerfCounters(ex);
+    PerfCounters_read(pc, before);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t0);
+    bench_handle_connection(lb, LOOPBACK_REQUESTS);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t1);
+    PerfCounters_read(pc, after);
+
+    double cpu = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%-28s %10.0f requests/s/core", "loopback", LOOPBACK_REQUESTS / cpu);
+    PerfEvent events[] = {PE_CYCLES, PE_INSTRUCTIONS};
+    for (int i = 0; i < 2; i++) {
+        PerfEvent ev = events[i];
+        if (ex->ty == E_Okay && PerfCounters_counts(pc, ev))
+            printf(", %.0f %s/request",
+                   (double)(after[ev] - before[ev]) / LOOPBACK_REQUESTS,
+                   PerfEvent_name(ev));
+        else
+            printf(", - %s/request", PerfEvent_name(ev));
+    }
+    printf("\n");
+
+    delete_PerfCounters(pc);
+    free(ex);
+}
+
+void run_all_bench_server() {
+    bench("formatted_time", bench_formatted_time, NULL);
+    bench("write_msg", bench_write_msg, NULL);
+
+    // the whole pipeline: parse, new_HttpResponse, write_msg and write_log
+    Exception *ex = calloc(1, sizeof(Exception));
+    Loopback lb = {
+        .opt = calloc(1, sizeof(Option)),
+        .corpus = LoopbackCorpus,
+        .ncorpus = sizeof(LoopbackCorpus) / sizeof(*LoopbackCorpus),
+    };
+    lb.opt->document_root = "www";
+    lb.log = new_AccessLog("/dev/null", ex);
+    if (ex->ty != E_Okay)
+        error("Error: new_AccessLog: %s", ex->msg);
+
+    bench("handle_connection", bench_handle_connection, &lb);
+    report_loopback(&lb);
+
+    delete_AccessLog(lb.log);
+    free(lb.opt);
+    free(ex);
 }
@@ -0,0 +1,102 @@
+#!/bin/bash
+#
+# Starts the server on a generated document root, and loads it for a long
+# time with dali-bench, by turns with keep-alive and short-lived connections.
+# Fails if a worker exits, or if the resident set of a worker grows by more
+# than SOAK_RSS_KB after the first SOAK_WARMUP rounds, which warm up caches
+# and the heap.
+#
+# SOAK_PORT, SOAK_CONNECTIONS, SOAK_ROUNDS, SOAK_WARMUP and SOAK_DURATION, the
+# seconds of a pass, override the defaults. The defaults send millions of
+# requests.
+
+set -o nounset
+
+prog=./httpd
+bench=./dali-bench
+PORT=${SOAK_PORT:-8091}
+CONNECTIONS=${SOAK_CONNECTIONS:-8}
+ROUNDS=${SOAK_ROUNDS:-10}
+WARMUP=${SOAK_WARMUP:-2}
+DURATION=${SOAK_DURATION:-30}
+RSS_KB=${SOAK_RSS_KB:-256}
+
+function error() {
+    echo "$@" >&2
+    exit 1
+}
+
+root=$(mktemp -d) || error "$LINENO"
+trap 'kill $server 2>/dev/null; wait $server 2>/dev/null; rm -rf "$root"' EXIT
+
+# document root: every kind of response, files, a listing, compressed and
+# generated bodies
+mkdir -p "$root/www/dir"
+head -c 1024 /dev/zero | tr '\0' 'a' > "$root/www/index.html"
+head -c 8192 /dev/zero | tr '\0' 'b' > "$root/www/style.css"
+head -c 65536 /dev/zero > "$root/www/image.png"
+touch "$root/www/dir/a.txt" "$root/www/dir/b.txt"
+
+cat > "$root/urls" <<URLS
+# weight path
+50 /index.html
+20 /style.css
+10 /image.png
+10 /index.html?v=1
+5 /not_found
+4 /dir/
+1 /server-status
+URLS
+
+$prog -i -z -s -r "$root/www" -l "$root/access.log" -p $PORT > /dev/null 2>&1 &
+server=$!
+
+# waits for the server to listen
+for i in $(seq 50); do
+    (echo -n > /dev/tcp/127.0.0.1/$PORT) 2>/dev/null && break
+    sleep 0.1
+done
+
+# prints "PID RSS" of each worker, RSS in KiB. the anonymous part only, as
+# pages of libraries and the scoreboard count when they are touched first.
+function rss() {
+    for pid in $(pgrep -P $server); do
+        echo $pid $(awk '/^RssAnon:/ {print $2}' /proc/$pid/status)
+    done
+}
+
+opts="-p $PORT -c $CONNECTIONS -d $DURATION -u $root/urls"
+requests=0
+declare -A warm
+for round in $(seq $ROUNDS); do
+    for pass in keep-alive close; do
+        flags=""
+        [[ $pass == close ]] && flags="-C"
+        n=$($bench $opts $flags | awk '/^requests:/ {print $2 + 0}')
+        [[ -n $n ]] || error "$LINENO"
+        requests=$((requests + n))
+    done
+
+    # workers are not restarted, so a worker which exits fails the test
+    workers=0
+    growth=0
+    while read pid kb; do
+        workers=$((workers + 1))
+        if (( round <= WARMUP )); then
+            warm[$pid]=$kb
+        else
+            [[ -n ${warm[$pid]:-} ]] || error "worker $pid is new"
+            d=$((kb - warm[$pid]))
+            (( d > growth )) && growth=$d
+        fi
+    done < <(rss)
+    (( workers == ${#warm[@]} )) || error "$((${#warm[@]} - workers)) exited"
+
+    printf "round %3d: %10d requests, %d workers, rss growth %d KiB\n" \
+           $round $requests $workers $growth
+    (( growth <= RSS_KB )) || error "rss grows by $growth KiB"
+done
+
+echo "=============================="
+echo " Soak test passed."
+echo "=============================="
@@ -0,0 +1,368 @@
+#include "stats.h"
+#include "util.h"
+
+#include <math.h>   // lgamma(3)
+#include <stdlib.h> // qsort(3)
+#include <string.h> // strstr(3)
+
+//
+// microbenchmark
+//
+
+/// stores results of operations, not to be optimized away
+volatile uintptr_t BenchSink;
+
+/// bench() writes metrics to it, if not NULL
+FILE *BenchOutput;
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Measures the operation, and prints the median time per operation, the
+ * minimum, the relative standard deviation of BENCH_REPS batches and the
+ * allocations per operation. Writes the metrics "NAME" of ns/op and
+ * "NAME.allocs" of allocs/op to BenchOutput.
+ *
+ * The batch is doubled until it takes BENCH_BATCH_NS, which warms up caches
+ * and branch predictors as well. Allocations are counted only if the
+ * counting shim is linked, "-" otherwise.
+ *
+ * @param name
+ * @param fn
+ * @param arg the argument of fn
+ */
+void bench(const char *name, BenchFunc fn, void *arg) {
+    long n = 1;
+    for (;;) {
+        uint64_t start = monotonic_ns();
+        fn(arg, n);
+        if (monotonic_ns() - start >= BENCH_BATCH_NS)
+            break;
+        n *= 2;
+    }
+
+    Metric m = {.n = BENCH_REPS};
+    uint64_t allocs = malloc_count ? malloc_count() : 0;
+    for (int i = 0; i < BENCH_REPS; i++) {
+        uint64_t start = monotonic_ns();
+        fn(arg, n);
+        m.samples[i] = (double)(monotonic_ns() - start) / n;
+    }
+    if (malloc_count)
+        allocs = malloc_count() - allocs;
+
+    double mean = stats_mean(m.samples, BENCH_REPS);
+    double sd = sqrt(stats_variance(m.samples, BENCH_REPS));
+    double sorted[BENCH_REPS];
+    memcpy(sorted, m.samples, sizeof(sorted));
+    qsort(sorted, BENCH_REPS, sizeof(double), compare_double);
+
+    printf("%-28s %10.1f ns/op, min %10.1f, +-%5.1f%%, ", name,
+           sorted[BENCH_REPS / 2], sorted[0], mean > 0 ? 100 * sd / mean : 0);
+    if (malloc_count)
+        printf("%6.2f allocs/op\n", (double)allocs / n / BENCH_REPS);
+    else
+        printf("     - allocs/op\n");
+
+    if (BenchOutput == NULL)
+        return;
+    snprintf(m.name, sizeof(m.name), "%s", name);
+    snprintf(m.unit, sizeof(m.unit), "ns/op");
+    Metric_write(&m, BenchOutput);
+    if (malloc_count) {
+        Metric a = {.n = 1, .samples = {(double)allocs / n / BENCH_REPS}};
+        snprintf(a.name, sizeof(a.name), "%s.allocs", name);
+        snprintf(a.unit, sizeof(a.unit), "allocs/op");
+        Metric_write(&a, BenchOutput);
+    }
+}
+
+//
+// Metric
+//
+
+/**
+ * Writes the metric as a line of JSON. The name and the unit must not need
+ * escaping.
+ *
+ * @param m
+ * @param out
+ */
+void Metric_write(const Metric *m, FILE *out) {
+    fprintf(out, "{\"name\":\"%s\",\"unit\":\"%s\",\"better\":\"%s\","
+                 "\"samples\":[",
+            m->name, m->unit, m->higher_is_better ? "higher" : "lower");
+    for (int i = 0; i < m->n; i++)
+        fprintf(out, "%s%.9g", i > 0 ? "," : "", m->samples[i]);
+    fprintf(out, "]}\n");
+}
+
+/// copies the string value of the key in the line into dest
+static bool json_str(const char *line, const char *key, char *dest,
+                     int size) {
+    const char *p = strstr(line, key);
+    if (p == NULL || p[strlen(key)] != '"')
+        return false;
+    p += strlen(key) + 1;
+    const char *q = strchr(p, '"');
+    if (q == NULL || q - p >= size)
+        return false;
+    memcpy(dest, p, q - p);
+    dest[q - p] = '\0';
+    return true;
+}
+
+/**
+ * Reads a metric written by Metric_write().
+ *
+ * @return false at the end of the file or on error
+ * @param m
+ * @param in
+ * @param ex a pointer to Exception, E_Failure if a line is malformed
+ */
+bool Metric_read(Metric *m, FILE *in, Exception *ex) {
+    static char line[METRIC_SAMPLES_MAX * 32 + 1024];
+    char better[8];
+
+    do {
+        if (fgets(line, sizeof(line), in) == NULL)
+            return false;
+    } while (line[0] == '\n');
+
+    m->n = 0;
+    const char *p = strstr(line, "\"samples\":[");
+    if (!json_str(line, "\"name\":", m->name, sizeof(m->name)) ||
+        !json_str(line, "\"unit\":", m->unit, sizeof(m->unit)) ||
+        !json_str(line, "\"better\":", better, sizeof(better)) ||
+        p == NULL) {
+        ex->ty = E_Failure;
+        ex->msg = "malformed metric";
+        return false;
+    }
+    m->higher_is_better = strcmp(better, "higher") == 0;
+
+    p += strlen("\"samples\":[");
+    while (*p != ']' && m->n < METRIC_SAMPLES_MAX) {
+        char *end;
+        m->samples[m->n++] = strtod(p, &end);
+        if (end == p || (*end != ',' && *end != ']')) {
+            ex->ty = E_Failure;
+            ex->msg = "malformed samples";
+            return false;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+//
+// statistics
+//
+
+/**
+ * Returns the mean of the samples.
+ *
+ * @return the mean, 0 if no sample
+ * @param x
+ * @param n the number of samples
+ */
+double stats_mean(const double *x, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += x[i];
+    return n > 0 ? sum / n : 0;
+}
+
+/**
+ * Returns the unbiased variance of the samples.
+ *
+ * @return the variance, 0 if less than 2 samples
+ * @param x
+ * @param n the number of samples
+ */
+double stats_variance(const double *x, int n) {
+    if (n < 2)
+        return 0;
+    double mean = stats_mean(x, n), sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += (x[i] - mean) * (x[i] - mean);
+    return sum / (n - 1);
+}
+
+/// the continued fraction of the incomplete beta function, by Lentz's method
+static double beta_cf(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1, d = 1 - (a + b) * x / (a + 1);
+    if (fabs(d) < tiny)
+        d = tiny;
+    d = 1 / d;
+    double h = d;
+
+    for (int m = 1; m <= 300; m++) {
+        double aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1 + aa * d;
+        c = 1 + aa / c;
+        d = 1 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        h *= d * c;
+
+        aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1 + aa * d;
+        c = 1 + aa / c;
+        d = 1 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1) < 1e-12)
+            break;
+    }
+    return h;
+}
+
+/// the regularized incomplete beta function I_x(a, b)
+static double beta_inc(double a, double b, double x) {
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) +
+                       b * log(1 - x));
+    if (x < (a + 1) / (a + b + 2))
+        return front * beta_cf(a, b, x) / a;
+    return 1 - front * beta_cf(b, a, 1 - x) / b;
+}
+
+/**
+ * Returns the cumulative distribution function of Student's t distribution.
+ *
+ * @return P(T <= t)
+ * @param t
+ * @param df the degrees of freedom
+ */
+double stats_t_cdf(double t, double df) {
+    double tail = beta_inc(df / 2, 0.5, df / (df + t * t)) / 2;
+    return t > 0 ? 1 - tail : tail;
+}
+
+/**
+ * Tests whether the means of two samples differ, without assuming equal
+ * variances (Welch's t-test).
+ *
+ * @return the t statistic, the degrees of freedom and the two-sided p-value.
+ * p is 1 if either has less than 2 samples, or if both have no variance and
+ * the same mean, 0 if both have no variance but different means.
+ * @param a
+ * @param na the number of samples of a
+ * @param b
+ * @param nb the number of samples of b
+ */
+WelchTest stats_welch(const double *a, int na, const double *b, int nb) {
+    WelchTest w = {0, 0, 1};
+    if (na < 2 || nb < 2)
+        return w;
+
+    double va = stats_variance(a, na) / na, vb = stats_variance(b, nb) / nb;
+    double diff = stats_mean(a, na) - stats_mean(b, nb);
+    if (va + vb == 0) {
+        w.p = diff == 0 ? 1 : 0;
+        return w;
+    }
+
+    w.t = diff / sqrt(va + vb);
+    w.df = (va + vb) * (va + vb) /
+           (va * va / (na - 1) + vb * vb / (nb - 1));
+    w.p = 2 * stats_t_cdf(-fabs(w.t), w.df);
+    return w;
+}
+
+/// |x - y| < 1e-4
+static bool near(double x, double y) {
+    return fabs(x - y) < 1e-4;
+}
+
+static void test_stats() {
+    double a[] = {1, 2, 3, 4, 5};
+    double b[] = {6, 7, 8, 9, 10};
+    double c[] = {3, 3, 3};
+
+    expect_bool(__LINE__, true, near(3, stats_mean(a, 5)));
+    expect_bool(__LINE__, true, near(2.5, stats_variance(a, 5)));
+    expect_bool(__LINE__, true, near(0, stats_variance(a, 1)));
+    expect_bool(__LINE__, true, near(0, stats_mean(a, 0)));
+
+    // values of the t distribution
+    expect_bool(__LINE__, true, near(0.5, stats_t_cdf(0, 5)));
+    expect_bool(__LINE__, true, near(0.963306, stats_t_cdf(2, 10)));
+    expect_bool(__LINE__, true, near(0.036694, stats_t_cdf(-2, 10)));
+    expect_bool(__LINE__, true, near(0.975, stats_t_cdf(1.959964, 1e6)));
+
+    WelchTest w = stats_welch(a, 5, b, 5);
+    expect_bool(__LINE__, true, near(-5, w.t));
+    expect_bool(__LINE__, true, near(8, w.df));
+    expect_bool(__LINE__, true, near(0.001053, w.p));
+
+    w = stats_welch(b, 5, a, 5);
+    expect_bool(__LINE__, true, near(5, w.t));
+
+    // the same samples
+    w = stats_welch(a, 5, a, 5);
+    expect_bool(__LINE__, true, near(1, w.p));
+
+    // no variance
+    w = stats_welch(c, 3, c, 3);
+    expect_bool(__LINE__, true, near(1, w.p));
+    w = stats_welch(c, 3, b, 5);
+    expect_bool(__LINE__, true, w.p < 0.01);
+
+    // too few samples
+    w = stats_welch(a, 1, b, 5);
+    expect_bool(__LINE__, true, near(1, w.p));
+}
+
+static void test_Metric() {
+    Exception *ex = calloc(1, sizeof(Exception));
+    Metric m = {.name = "write_msg", .unit = "ns/op", .n = 3,
+                .samples = {1.5, 2, 1e9}};
+    Metric t = {.name = "throughput", .unit = "requests/s",
+                .higher_is_better = true, .n = 1, .samples = {0.1}};
+    Metric r;
+
+    FILE *f = tmpfile();
+    Metric_write(&m, f);
+    fprintf(f, "\n");
+    Metric_write(&t, f);
+    fprintf(f, "{\"name\":\"broken\"}\n");
+    rewind(f);
+
+    expect_bool(__LINE__, true, Metric_read(&r, f, ex));
+    expect_str(__LINE__, "write_msg", r.name);
+    expect_str(__LINE__, "ns/op", r.unit);
+    expect_bool(__LINE__, false, r.higher_is_better);
+    expect(__LINE__, 3, r.n);
+    expect_bool(__LINE__, true, near(1e9, r.samples[2]));
+
+    expect_bool(__LINE__, true, Metric_read(&r, f, ex)); // skips blank lines
+    expect_str(__LINE__, "throughput", r.name);
+    expect_bool(__LINE__, true, r.higher_is_better);
+    expect(__LINE__, 1, r.n);
+    expect_bool(__LINE__, true, r.samples[0] == 0.1); // exact
+
+    expect_bool(__LINE__, false, Metric_read(&r, f, ex));
+    expect(__LINE__, E_Failure, ex->ty);
+
+    ex->ty = E_Okay;
+    expect_bool(__LINE__, false, Metric_read(&r, f, ex)); // EOF
+    expect(__LINE__, E_Okay, ex->ty);
+
+    fclose(f);
+    free(ex);
+}
+
+void run_all_test_stats() {
+    test_stats();
+    test_Metric();
+}
@@ -0,0 +1,66 @@
+/** @file
+ * provides microbenchmarks, results of benchmarks and statistics of their
+ * samples.
+ *
+ * A result is written as a JSON object per line, e.g.
+ *
+ *     {"name":"url_decode","unit":"ns/op","better":"lower","samples":[...]}
+ *
+ * so that results of runs are compared with dali-benchcmp.
+ */
+#pragma once
+
+#include "util.h"
+
+#include <stdint.h> // uintptr_t
+#include <stdio.h>  // FILE
+
+// clang-format off
+#define BENCH_BATCH_NS     (10 * 1000 * 1000) ///< least duration of a batch
+#define BENCH_REPS         11                 ///< batches measured
+#define METRIC_NAME_MAX    128
+#define METRIC_UNIT_MAX    32
+#define METRIC_SAMPLES_MAX 256
+// clang-format on
+
+/// runs the operation n times
+typedef void (*BenchFunc)(void *arg, long n);
+
+void bench(const char *name, BenchFunc fn, void *arg);
+extern volatile uintptr_t BenchSink;
+extern FILE *BenchOutput;
+
+/// defined by the counting shim, malloc_count.c, if it is linked
+uint64_t malloc_count() __attribute__((weak));
+
+/** @struct Metric
+ * @brief Samples of a measurement. A metric of a single sample is exact,
+ * e.g. allocations per operation.
+ *
+ * \li Metric_write() writes a line of JSON.
+ * \li Metric_read() reads a line of JSON.
+ */
+typedef struct {
+    char name[METRIC_NAME_MAX];
+    char unit[METRIC_UNIT_MAX];
+    bool higher_is_better;
+    int n;
+    double samples[METRIC_SAMPLES_MAX];
+} Metric;
+
+void Metric_write(const Metric *, FILE *out);
+bool Metric_read(Metric *, FILE *in, Exception *ex);
+
+/// the result of stats_welch()
+typedef struct {
+    double t;  ///< the t statistic, negative if the mean of a is less
+    double df; ///< the degrees of freedom
+    double p;  ///< the two-sided p-value
+} WelchTest;
+
+double stats_mean(const double *x, int n);
+double stats_variance(const double *x, int n);
+double stats_t_cdf(double t, double df);
+WelchTest stats_welch(const double *a, int na, const double *b, int nb);
+
+void run_all_test_stats();
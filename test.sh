@@ -19,6 +19,9 @@ $prog -p $PORT &
 # Normal request
 curl -s --head 127.0.0.1:${PORT}/hello.html | head -1 | grep 200 > /dev/null || error "$LINENO"
 
+# Range
+curl -s --range 0-4 127.0.0.1:${PORT}/hello.html -o /dev/null -w '%{http_code}' | grep 206 > /dev/null || error "$LINENO"
+
 # Not Found
 curl -s --head 127.0.0.1:${PORT}/not_found  | head -1 | grep 404 > /dev/null || error "$LINENO"
 
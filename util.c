@@ -1,9 +1,11 @@
 #include "util.h"
 
+#include <ctype.h>  // tolower(3)
 #include <stdarg.h> // va_start(3)
 #include <stdio.h>  // fprintf(3)
 #include <stdlib.h> // free(3)
 #include <string.h> // strcmp(3)
+#include <time.h>   // clock_gettime(3)
 
 char *ErrorMsg;
 
@@ -286,6 +288,41 @@ int *intdup(int n) {
     return num;
 }
 
+/**
+ * Hashes the bytes case-insensitively, by FNV-1a of the bytes in lower case
+ * with the seed mixed into the offset basis, and a finalizer which spreads
+ * the low bits. Different seeds give independent hashes, for perfect hashing.
+ *
+ * @return the hash
+ * @param s the bytes, not necessarily terminated
+ * @param len the number of the bytes
+ * @param seed
+ */
+uint32_t strcase_hash(const char *s, size_t len, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)tolower((unsigned char)s[i]);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+/**
+ * Reads the monotonic clock, which is not affected by changes of the system
+ * time.
+ *
+ * @return nanoseconds since an unspecified point
+ */
+uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 //
 // for testing
 //
@@ -14,10 +14,14 @@
  *
  * Functions
  * \li intdup() - duplicate an integer
+ * \li strcase_hash() - hash bytes case-insensitively
+ * \li monotonic_ns() - read the monotonic clock
  */
 #pragma once
 
 #include <stdbool.h>     // bool
+#include <stddef.h>      // size_t
+#include <stdint.h>      // uint64_t
 #include <stdnoreturn.h> // noreturn
 
 /* util.c */
@@ -120,6 +124,8 @@ void StringBuffer_appendChar(StringBuffer *sb, char c);
 char *StringBuffer_toString(StringBuffer *);
 
 int *intdup(int);
+uint32_t strcase_hash(const char *s, size_t len, uint32_t seed);
+uint64_t monotonic_ns();
 
 noreturn void error(char *, ...);
 
@@ -133,3 +139,4 @@ void expect_bool(int line, bool expected, bool actual);
 
 /* util_test.c */
 void run_all_test_util();
+void run_all_bench_util();
@@ -1,3 +1,4 @@
+#include "stats.h"
 #include "util.h"
 
 #include <stdio.h>  // fopen(3)
@@ -129,6 +130,24 @@ static void test_sizeof() {
     free(buf);
 }
 
+static void test_strcase_hash() {
+    expect_bool(__LINE__, true,
+                strcase_hash("html", 4, 1) == strcase_hash("HTML", 4, 1));
+    expect_bool(__LINE__, true,
+                strcase_hash("html", 4, 1) == strcase_hash("html.gz", 4, 1));
+    expect_bool(__LINE__, true,
+                strcase_hash("html", 4, 1) != strcase_hash("html", 4, 2));
+    expect_bool(__LINE__, true,
+                strcase_hash("html", 4, 1) != strcase_hash("htm", 3, 1));
+}
+
+static void test_monotonic_ns() {
+    uint64_t t1 = monotonic_ns();
+    uint64_t t2 = monotonic_ns();
+    expect_bool(__LINE__, true, t1 > 0);
+    expect_bool(__LINE__, true, t1 <= t2);
+}
+
 void run_all_test_util() {
     test_ArgsIter();
     test_Vector();
@@ -136,4 +155,43 @@ void run_all_test_util() {
     test_StringBuffer();
     test_strcmp();
     test_sizeof();
+    test_strcase_hash();
+    test_monotonic_ns();
+}
+
+static char *Keys[] = {"Host",           "User-Agent",      "Accept",
+                       "Accept-Encoding", "Accept-Language", "Connection",
+                       "Referer",         "If-None-Match"};
+
+/// fills a map with headers of a typical request, and looks them up
+static void bench_Map(void *arg, long n) {
+    for (long i = 0; i < n; i++) {
+        Map *map = new_Map();
+        for (int j = 0; j < 8; j++)
+            Map_put(map, strdup(Keys[j]), strdup(Keys[j]));
+        for (int j = 0; j < 8; j++)
+            BenchSink += (uintptr_t)Map_get(map, Keys[j]);
+        BenchSink += (uintptr_t)Map_get(map, "Range"); // not found
+        delete_Map(map);
+    }
+}
+
+/// builds a line of the size of a typical access log line
+static void bench_StringBuffer(void *arg, long n) {
+    for (long i = 0; i < n; i++) {
+        StringBuffer *sb = new_StringBuffer();
+        for (int j = 0; j < 8; j++) {
+            StringBuffer_append(sb, Keys[j]);
+            StringBuffer_appendChar(sb, ' ');
+        }
+        char *str = StringBuffer_toString(sb);
+        BenchSink += str[0];
+        free(str);
+        delete_StringBuffer(sb);
+    }
+}
+
+void run_all_bench_util() {
+    bench("Map_put/Map_get", bench_Map, NULL);
+    bench("StringBuffer", bench_StringBuffer, NULL);
 }